@@ -0,0 +1,486 @@
+﻿// wmf-bench: 识别核心的微基准
+//
+// 覆盖钩子回调路径（OnMouseMove/OnButtonDown/OnButtonUp 入队）、工作线程的
+// ProcessMouseMove 与 RecognizeGesture、形状模板匹配、配置加载，以及队列交接延迟。
+// 钩子回调超过 LowLevelHooksTimeout 会被 Windows 移除，这里的数字用于跟踪回归。
+//
+// 输出 JSON:
+//   wmf-bench --benchmark_format=json --benchmark_out=bench.json
+
+#include "ActionSink.h"
+#include "ConfigManager.h"
+#include "GestureRecognizer.h"
+#include "LatencyTrace.h"
+#include "ShapeMatcher.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 基准测试访问识别器/配置管理器内部方法的入口（见各类中的 friend 声明）
+ */
+struct BenchmarkAccess {
+    static void ProcessButtonDown(GestureRecognizer& recognizer, MouseButton button, const Point& position, int64_t timeUs) {
+        recognizer.ProcessButtonDown(button, position, timeUs);
+    }
+
+    static void ProcessMouseMove(GestureRecognizer& recognizer, const Point& position, const Point& delta, int64_t timeUs) {
+        recognizer.ProcessMouseMove(position, delta, timeUs);
+    }
+
+    static SectorClassifier::Sector RecognizeGesture(const GestureRecognizer& recognizer, const Point& delta,
+                                                     GestureType previous) {
+        return recognizer.RecognizeGesture(*recognizer.table_.Get(), delta, previous);
+    }
+
+    static bool ParseJson(ConfigManager& config, const nlohmann::json& j) {
+        return config.ParseJson(j);
+    }
+};
+
+} // namespace WinMouseFix
+
+using namespace WinMouseFix;
+
+namespace {
+
+/**
+ * @brief 丢弃所有动作的输出端
+ */
+class NullSink : public ActionSink {
+public:
+    void ExecuteAction(const ActionProgram&, int64_t) override { benchmark::ClobberMemory(); }
+    void SimulateScroll(int, int) override { benchmark::ClobberMemory(); }
+};
+
+InputEvent MakeEvent(InputEvent::Type type, MouseButton button, int x, int y) {
+    InputEvent event;
+    event.type = type;
+    event.button = button;
+    event.position = Point(x, y);
+    return event;
+}
+
+/**
+ * @brief 生成每个按钮带 rulesPerButton 条规则的配置
+ */
+nlohmann::json MakeConfigJson(int rulesPerButton) {
+    static const char* const buttons[] = {"BUTTON_4", "BUTTON_5", "BUTTON_MIDDLE"};
+    static const char* const gestures[] = {"SWIPE_UP", "SWIPE_DOWN", "SWIPE_LEFT", "SWIPE_RIGHT"};
+    static const char* const actions[] = {"TASK_VIEW", "SHOW_DESKTOP", "SWITCH_DESKTOP_LEFT", "SWITCH_DESKTOP_RIGHT"};
+
+    nlohmann::json j;
+    j["gestures"] = nlohmann::json::array();
+    for (const char* button : buttons) {
+        for (int i = 0; i < rulesPerButton; ++i) {
+            nlohmann::json item;
+            item["triggerButton"] = button;
+            item["gestureType"] = gestures[i % 4];
+            item["actionType"] = actions[i % 4];
+            item["threshold"] = 60 + i;
+            j["gestures"].push_back(item);
+        }
+    }
+    return j;
+}
+
+/**
+ * @brief BUTTON_4 上 ruleCount 条规则，只包含 上/下/左，向右移动时不会触发
+ *
+ * 规则编译为查找表后重复的规则被合并，每个采样的开销不应随 ruleCount 增长。
+ */
+std::vector<GestureConfig> MakeNonMatchingRules(int ruleCount) {
+    static const GestureType gestures[] = {GestureType::SWIPE_UP, GestureType::SWIPE_DOWN, GestureType::SWIPE_LEFT};
+    std::vector<GestureConfig> configs;
+    for (int i = 0; i < ruleCount; ++i) {
+        GestureConfig config;
+        config.triggerButton = MouseButton::BUTTON_4;
+        config.gestureType = gestures[i % 3];
+        config.actionType = ActionType::TASK_VIEW;
+        config.threshold = 30;
+        configs.push_back(config);
+    }
+    return configs;
+}
+
+/**
+ * @brief BUTTON_4 上 4 个或 8 个方向的规则；向右的阈值很大，向右移动时每个采样都识别方向但不触发
+ */
+std::vector<GestureConfig> MakeDirectionRules(int directions) {
+    static const GestureType gestures[] = {
+        GestureType::SWIPE_RIGHT, GestureType::SWIPE_UP, GestureType::SWIPE_LEFT, GestureType::SWIPE_DOWN,
+        GestureType::SWIPE_UP_LEFT, GestureType::SWIPE_UP_RIGHT, GestureType::SWIPE_DOWN_LEFT, GestureType::SWIPE_DOWN_RIGHT,
+    };
+    std::vector<GestureConfig> configs;
+    for (int i = 0; i < directions; ++i) {
+        GestureConfig config;
+        config.triggerButton = MouseButton::BUTTON_4;
+        config.gestureType = gestures[i];
+        config.actionType = ActionType::TASK_VIEW;
+        config.threshold = (i == 0) ? 100000 : 30;
+        config.angleHysteresis = 5;
+        configs.push_back(config);
+    }
+    return configs;
+}
+
+std::vector<GestureConfig> DefaultRules() {
+    ConfigManager config;
+    config.CreateDefaultConfig();
+    return config.GetGestureConfigs();
+}
+
+// ---------------------------------------------------------------------------
+// 钩子线程入队
+// ---------------------------------------------------------------------------
+
+void BM_OnMouseMove(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(DefaultRules());
+    recognizer.OnInputEvent(MakeEvent(InputEvent::BUTTON_DOWN, MouseButton::BUTTON_5, 0, 0));
+
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(recognizer.OnMouseMove(Point(i & 1023, (i >> 3) & 255)));
+        ++i;
+    }
+
+    recognizer.OnInputEvent(MakeEvent(InputEvent::BUTTON_UP, MouseButton::BUTTON_5, 0, 0));
+    recognizer.WaitForIdle();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OnMouseMove);
+
+void BM_OnButtonDownUp(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(DefaultRules());
+    const Point position(100, 100);
+
+    int pairs = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(recognizer.OnButtonDown(MouseButton::BUTTON_4, position));
+        benchmark::DoNotOptimize(recognizer.OnButtonUp(MouseButton::BUTTON_4, position));
+
+        // 按钮通道不丢弃事件，周期性地（不计时）等工作线程追上
+        if (++pairs == 64) {
+            state.PauseTiming();
+            recognizer.WaitForIdle();
+            pairs = 0;
+            state.ResumeTiming();
+        }
+    }
+
+    recognizer.WaitForIdle();
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_OnButtonDownUp);
+
+void BM_ButtonStateChord(benchmark::State& state) {
+    ButtonState buttons;
+    const uint32_t chord = ButtonState::Bit(MouseButton::BUTTON_4) | ButtonState::Bit(MouseButton::BUTTON_5);
+
+    int i = 0;
+    for (auto _ : state) {
+        // 按下/释放侧键 5，同时查询组合键与按下顺序
+        MouseButton button = (i & 1) ? MouseButton::BUTTON_5 : MouseButton::BUTTON_4;
+        if (buttons.IsPressed(button)) {
+            buttons.SetReleased(button, i);
+        } else {
+            buttons.SetPressed(button, Point(i, i), i);
+        }
+        benchmark::DoNotOptimize(buttons.IsChord(chord));
+        benchmark::DoNotOptimize(buttons.GetPressOrder(0));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ButtonStateChord);
+
+// ---------------------------------------------------------------------------
+// 工作线程识别
+// ---------------------------------------------------------------------------
+
+void BM_ProcessMouseMove(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(MakeNonMatchingRules(static_cast<int>(state.range(0))));
+    BenchmarkAccess::ProcessButtonDown(recognizer, MouseButton::BUTTON_4, Point(0, 0), 0);
+
+    int i = 0;
+    for (auto _ : state) {
+        // 始终在起点右侧 100 像素附近：超过阈值、识别为向右、没有匹配规则
+        Point position(100 + (i & 7), (i & 3) - 1);
+        BenchmarkAccess::ProcessMouseMove(recognizer, position, Point(1, 0), 1000 + i * 1000);
+        ++i;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["rules"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(BM_ProcessMouseMove)->RangeMultiplier(4)->Range(1, 256);
+
+/**
+ * @brief 4 方向与 8 方向（含斜向）规则的每采样开销：方向扇区查表只有整数运算，两者应当持平
+ */
+void BM_ProcessMouseMoveDirections(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(MakeDirectionRules(static_cast<int>(state.range(0))));
+    BenchmarkAccess::ProcessButtonDown(recognizer, MouseButton::BUTTON_4, Point(0, 0), 0);
+
+    int i = 0;
+    for (auto _ : state) {
+        Point position(100 + (i & 7), (i & 15) - 8);
+        BenchmarkAccess::ProcessMouseMove(recognizer, position, Point(1, 0), 1000 + i * 1000);
+        ++i;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["directions"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(BM_ProcessMouseMoveDirections)->Arg(4)->Arg(8);
+
+/**
+ * @brief BUTTON_4 上一条长度为 strokes 的左右交替序列；每个采样的开销应与序列长度无关
+ */
+void BM_ProcessMouseMoveSequence(benchmark::State& state) {
+    const int strokes = static_cast<int>(state.range(0));
+    GestureConfig config;
+    config.triggerButton = MouseButton::BUTTON_4;
+    config.gestureType = GestureType::SEQUENCE;
+    config.actionType = ActionType::TASK_VIEW;
+    config.threshold = 40;
+    for (int k = 0; k < strokes; ++k) {
+        config.sequence.push_back((k & 1) ? GestureType::SWIPE_RIGHT : GestureType::SWIPE_LEFT);
+    }
+
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(std::vector<GestureConfig>(1, config));
+
+    // 每个笔画 5 个 10 像素的采样；走完整条序列后重新按下，前缀树始终处在有效路径上
+    const int samplesPerSequence = strokes * 5;
+    int i = 0;
+    for (auto _ : state) {
+        int sample = i % samplesPerSequence;
+        if (sample == 0) {
+            BenchmarkAccess::ProcessButtonDown(recognizer, MouseButton::BUTTON_4, Point(0, 0), i * 1000);
+        }
+        int stroke = sample / 5;
+        int step = sample % 5 + 1;
+        Point position((stroke & 1) ? -50 + step * 10 : -step * 10, 0);
+        BenchmarkAccess::ProcessMouseMove(recognizer, position, Point(10, 0), 1000 + i * 1000);
+        ++i;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["strokes"] = static_cast<double>(strokes);
+}
+BENCHMARK(BM_ProcessMouseMoveSequence)->Arg(2)->Arg(8)->Arg(32);
+
+/**
+ * @brief 滚动模式下每个采样的开销（加速查表 + 余量累积 + 输出）；参数为 0 时不加速
+ */
+void BM_ProcessMouseMoveScroll(benchmark::State& state) {
+    GestureConfig config;
+    config.triggerButton = MouseButton::BUTTON_5;
+    config.gestureType = GestureType::TWO_FINGER_SCROLL;
+    config.actionType = ActionType::SCROLL_SIMULATION;
+    config.threshold = 0;
+    config.scrollAcceleration = static_cast<double>(state.range(0));
+    config.scrollOutputRate = 0;  // 基准测试不运行工作线程的定时器，每个采样直接输出
+
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(std::vector<GestureConfig>(1, config));
+    BenchmarkAccess::ProcessButtonDown(recognizer, MouseButton::BUTTON_5, Point(0, 0), 0);
+
+    int i = 0;
+    for (auto _ : state) {
+        // 1000 Hz 采样，每个采样 1~4 像素
+        Point delta((i & 1), 1 + (i & 3));
+        BenchmarkAccess::ProcessMouseMove(recognizer, Point(0, i), delta, 1000 + i * 1000);
+        ++i;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessMouseMoveScroll)->Arg(0)->Arg(1);
+
+void BM_RecognizeGesture(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(MakeDirectionRules(static_cast<int>(state.range(0))));
+    BenchmarkAccess::ProcessButtonDown(recognizer, MouseButton::BUTTON_4, Point(0, 0), 0);
+
+    std::vector<Point> deltas;
+    for (int i = 0; i < 256; ++i) {
+        deltas.push_back(Point((i * 37) % 301 - 150, (i * 91) % 301 - 150));
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const Point& delta = deltas[i++ & 255];
+        benchmark::DoNotOptimize(BenchmarkAccess::RecognizeGesture(recognizer, delta, GestureType::SWIPE_RIGHT));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["directions"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(BM_RecognizeGesture)->Arg(4)->Arg(8);
+
+/**
+ * @brief 释放时的形状匹配：模板数增长时的耗时（64 个模板的预算为 200 微秒）
+ *
+ * 模板是带随机偏移的内置形状，彼此相近，提前放弃的效果比实际配置差。
+ */
+void BM_ShapeMatch(benchmark::State& state) {
+    static const char* const names[] = {"L", "V", "CARET", "ZIGZAG", "CIRCLE"};
+    const int templateCount = static_cast<int>(state.range(0));
+
+    ShapeMatcher matcher;
+    std::vector<Point> points;
+    for (int i = 0; i < templateCount; ++i) {
+        ShapeMatcher::GetBuiltinTemplate(names[i % 5], points);
+        for (size_t k = 0; k < points.size(); ++k) {
+            points[k].x += static_cast<int>((i * 7 + k * 13) % 11) - 5;
+            points[k].y += static_cast<int>((i * 5 + k * 17) % 11) - 5;
+        }
+        matcher.AddTemplate(points.data(), points.size());
+    }
+
+    // 放大两倍并加上抖动的 ZIGZAG 笔画，每段 10 个采样
+    ShapeMatcher::GetBuiltinTemplate("ZIGZAG", points);
+    std::vector<Point> stroke;
+    for (size_t k = 1; k < points.size(); ++k) {
+        for (int i = 0; i < 10; ++i) {
+            int x = 2 * (points[k - 1].x + (points[k].x - points[k - 1].x) * i / 10);
+            int y = 2 * (points[k - 1].y + (points[k].y - points[k - 1].y) * i / 10);
+            stroke.push_back(Point(x + (i % 3) - 1, y + ((i + 1) % 3) - 1));
+        }
+    }
+    stroke.push_back(Point(points.back().x * 2, points.back().y * 2));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matcher.Match(stroke.data(), stroke.size()));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["templates"] = static_cast<double>(templateCount);
+}
+BENCHMARK(BM_ShapeMatch)->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kMicrosecond);
+
+// ---------------------------------------------------------------------------
+// 配置加载
+// ---------------------------------------------------------------------------
+
+void BM_ParseJson(benchmark::State& state) {
+    nlohmann::json j = MakeConfigJson(static_cast<int>(state.range(0)));
+    ConfigManager config;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BenchmarkAccess::ParseJson(config, j));
+    }
+    state.counters["rules"] = static_cast<double>(j["gestures"].size());
+}
+BENCHMARK(BM_ParseJson)->Arg(2)->Arg(4096);
+
+void BM_LoadFromFile(benchmark::State& state) {
+    const std::string path = "wmf_bench_config_" + std::to_string(state.range(0)) + ".json";
+    {
+        std::ofstream file(path);
+        file << MakeConfigJson(static_cast<int>(state.range(0))).dump(2);
+    }
+
+    ConfigManager config;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(config.LoadFromFile(path));
+    }
+    state.counters["rules"] = static_cast<double>(config.GetGestureConfigs().size());
+    std::remove(path.c_str());
+}
+BENCHMARK(BM_LoadFromFile)->Arg(2)->Arg(4096);
+
+// ---------------------------------------------------------------------------
+// 端到端：队列交接与动作分发
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief 单个事件从入队到工作线程处理完毕的往返延迟（包括唤醒休眠中的工作线程）
+ */
+void BM_QueueHandoffLatency(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(DefaultRules());
+
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(state.max_iterations));
+
+    bool down = true;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        if (down) {
+            recognizer.OnButtonDown(MouseButton::BUTTON_MIDDLE, Point(0, 0));
+        } else {
+            recognizer.OnButtonUp(MouseButton::BUTTON_MIDDLE, Point(0, 0));
+        }
+        recognizer.WaitForIdle();
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        down = !down;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        return samples[static_cast<size_t>(p * (samples.size() - 1))];
+    };
+    state.counters["p50_ns"] = percentile(0.50);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+}
+BENCHMARK(BM_QueueHandoffLatency)->Iterations(20000);
+
+/**
+ * @brief 完整的一次滑动手势：按下、移动、触发动作、释放
+ */
+void BM_GestureToAction(benchmark::State& state) {
+    NullSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(DefaultRules());
+
+    for (auto _ : state) {
+        recognizer.OnButtonDown(MouseButton::BUTTON_4, Point(500, 500));
+        for (int i = 1; i <= 12; ++i) {
+            recognizer.OnMouseMove(Point(500, 500 - i * 10));
+        }
+        recognizer.OnButtonUp(MouseButton::BUTTON_4, Point(500, 380));
+        recognizer.WaitForIdle();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GestureToAction);
+
+/**
+ * @brief 延迟直方图记录一个样本（每个埋点的额外开销）
+ */
+void BM_LatencyRecord(benchmark::State& state) {
+    LatencyHistogram histogram;
+    int64_t value = 1;
+    for (auto _ : state) {
+        histogram.Record(value);
+        value = (value * 7 + 13) & 0xFFFFF;
+    }
+    benchmark::DoNotOptimize(histogram.GetCount());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatencyRecord);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,1796 @@
+﻿// wmf-headless: 在没有 Windows 的机器上驱动手势识别核心
+//
+// 用法:
+//   wmf-headless [--config <config.json>] [--script <file>|-] [--sync] [--repeat N] [--uinput]
+//   wmf-headless --selftest
+//
+//   --uinput 经动作执行器把动作注入 /dev/uinput 虚拟设备（仅 Linux）
+//
+// 脚本格式（每行一个事件，# 开头为注释，时间戳可省略）:
+//   down BUTTON_4 100 100 [time]
+//   move 100 40 [time]
+//   up   BUTTON_4 100 40 [time]
+
+#include "ActionExecutor.h"
+#include "CaptureInputSink.h"
+#include "ConfigManager.h"
+#include "ConfigWatcher.h"
+#include "GestureRecognizer.h"
+#include "InputTrace.h"
+#include "LatencyTrace.h"
+#include "MacroProgram.h"
+#include "RecordingSink.h"
+#ifdef WMF_HAVE_UINPUT
+#include "UinputSink.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WinMouseFix;
+
+namespace {
+
+struct Options {
+    std::string configPath;
+    std::string scriptPath;
+    bool sync = false;
+    int repeat = 1;
+    bool uinput = false;
+    bool selftest = false;
+};
+
+void PrintUsage() {
+    std::cerr << "usage: wmf-headless [--config <file>] [--script <file>|-] [--sync] [--repeat N] [--uinput]\n"
+              << "       wmf-headless --selftest\n";
+}
+
+bool ParseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            options.configPath = argv[++i];
+        } else if (arg == "--script" && i + 1 < argc) {
+            options.scriptPath = argv[++i];
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--sync") {
+            options.sync = true;
+        } else if (arg == "--uinput") {
+            options.uinput = true;
+        } else if (arg == "--selftest") {
+            options.selftest = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseScript(std::istream& in, const ConfigManager& names, std::vector<InputEvent>& events) {
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream ss(line);
+        std::string kind;
+        ss >> kind;
+        if (kind.empty()) {
+            continue;
+        }
+
+        InputEvent event;
+        if (kind == "down" || kind == "up") {
+            std::string button;
+            ss >> button >> event.position.x >> event.position.y;
+            event.type = (kind == "down") ? InputEvent::BUTTON_DOWN : InputEvent::BUTTON_UP;
+            event.button = names.StringToMouseButton(button);
+        } else if (kind == "move") {
+            ss >> event.position.x >> event.position.y;
+            event.type = InputEvent::MOVE;
+        } else {
+            std::cerr << "line " << lineNo << ": unknown event '" << kind << "'\n";
+            return false;
+        }
+        if (ss.fail()) {
+            std::cerr << "line " << lineNo << ": malformed event\n";
+            return false;
+        }
+        ss >> event.timestamp;
+        events.push_back(event);
+    }
+    return true;
+}
+
+/**
+ * @brief 将事件序列送入识别器，返回每个事件的阻止判定
+ */
+std::vector<bool> Feed(GestureRecognizer& recognizer, const std::vector<InputEvent>& events, bool sync) {
+    std::vector<bool> blocked;
+    blocked.reserve(events.size());
+    for (const auto& event : events) {
+        recognizer.WaitForQueueSpace();
+        blocked.push_back(recognizer.OnInputEvent(event));
+        if (sync) {
+            recognizer.WaitForIdle();
+        }
+    }
+    recognizer.WaitForIdle();
+    return blocked;
+}
+
+// ---------------------------------------------------------------------------
+// 自检场景（使用默认配置）
+// ---------------------------------------------------------------------------
+
+InputEvent Down(MouseButton button, int x, int y) {
+    InputEvent event;
+    event.type = InputEvent::BUTTON_DOWN;
+    event.button = button;
+    event.position = Point(x, y);
+    return event;
+}
+
+InputEvent Up(MouseButton button, int x, int y) {
+    InputEvent event = Down(button, x, y);
+    event.type = InputEvent::BUTTON_UP;
+    return event;
+}
+
+/**
+ * @brief 按下按钮，从 (x0,y0) 分 steps 步直线拖到 (x1,y1)，再释放
+ */
+std::vector<InputEvent> Drag(MouseButton button, int x0, int y0, int x1, int y1, int steps) {
+    std::vector<InputEvent> events;
+    events.push_back(Down(button, x0, y0));
+    for (int i = 1; i <= steps; ++i) {
+        InputEvent move;
+        move.type = InputEvent::MOVE;
+        move.position = Point(x0 + (x1 - x0) * i / steps, y0 + (y1 - y0) * i / steps);
+        events.push_back(move);
+    }
+    events.push_back(Up(button, x1, y1));
+    return events;
+}
+
+/**
+ * @brief 给事件设置钩子时间：每个移动间隔 stepUs 微秒，释放与最后一个移动同时
+ */
+std::vector<InputEvent> Timed(std::vector<InputEvent> events, int64_t stepUs) {
+    const size_t moves = events.size() - 2;
+    // 时间放在过去，排队延迟统计保持为正
+    const int64_t start = MonotonicMicros() - stepUs * static_cast<int64_t>(moves + 1);
+    for (size_t i = 0; i < events.size(); ++i) {
+        events[i].hookTimeUs = start + static_cast<int64_t>(std::min(i, moves)) * stepUs;
+    }
+    return events;
+}
+
+/**
+ * @brief 同 Drag，但每步间隔 stepUs 微秒（设置事件的钩子时间），用于速度相关的检测
+ */
+std::vector<InputEvent> TimedDrag(MouseButton button, int x0, int y0, int x1, int y1, int steps, int64_t stepUs) {
+    return Timed(Drag(button, x0, y0, x1, y1, steps), stepUs);
+}
+
+/**
+ * @brief 按下按钮，沿折线 corners 每段分 stepsPerSegment 步移动，再释放
+ */
+std::vector<InputEvent> Stroke(MouseButton button, const std::vector<Point>& corners, int stepsPerSegment) {
+    std::vector<InputEvent> events;
+    events.push_back(Down(button, corners[0].x, corners[0].y));
+    for (size_t c = 1; c < corners.size(); ++c) {
+        const Point& from = corners[c - 1];
+        const Point& to = corners[c];
+        for (int i = 1; i <= stepsPerSegment; ++i) {
+            InputEvent move;
+            move.type = InputEvent::MOVE;
+            move.position = Point(from.x + (to.x - from.x) * i / stepsPerSegment,
+                                  from.y + (to.y - from.y) * i / stepsPerSegment);
+            events.push_back(move);
+        }
+    }
+    events.push_back(Up(button, corners.back().x, corners.back().y));
+    return events;
+}
+
+struct Scenario {
+    const char* name;
+    std::vector<InputEvent> events;
+    std::vector<ActionType> expectedActions;  // 不含滚动
+    int expectedScrollSign;                   // 滚动 Y 总量的符号，0 表示不应滚动
+    bool expectUpBlocked;
+    bool sync = true;                         // false 时不等工作线程，检验释放判定的有界等待
+};
+
+/**
+ * @brief 只检查动作序列的场景（同步送入，不含滚动检查）
+ */
+struct ActionCase {
+    const char* name;
+    std::vector<InputEvent> events;
+    std::vector<ActionType> expected;
+};
+
+int RunActionCases(GestureRecognizer& recognizer, RecordingSink& sink, const ConfigManager& names,
+                   const std::vector<ActionCase>& cases) {
+    int failures = 0;
+    for (const auto& c : cases) {
+        sink.Clear();
+        Feed(recognizer, c.events, true);
+        std::vector<ActionType> actions;
+        for (const auto& record : sink.GetRecords()) {
+            actions.push_back(record.action);
+        }
+        bool ok = actions == c.expected;
+        std::cout << (ok ? "[ OK ] " : "[FAIL] ") << c.name;
+        if (!ok) {
+            std::cout << " (actions:";
+            for (ActionType action : actions) {
+                std::cout << ' ' << names.ActionTypeToString(action);
+            }
+            std::cout << ')';
+            ++failures;
+        }
+        std::cout << '\n';
+    }
+    return failures;
+}
+
+/**
+ * @brief 快速轻扫：速度足够时在阈值之前触发，慢速或方向偏斜时不触发
+ */
+int RunFlickChecks(const ConfigManager& names, RecordingSink& sink) {
+    ConfigManager config;
+    config.CreateDefaultConfig();
+    std::vector<GestureConfig> rules = config.GetGestureConfigs();
+    for (auto& rule : rules) {
+        if (rule.triggerButton == MouseButton::BUTTON_4) {
+            rule.flickSpeed = 1500;
+        }
+    }
+
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(rules);
+
+    const std::vector<ActionCase> cases = {
+        // 40 像素 / 20 毫秒 = 2000 像素/秒，未达到 60 像素阈值
+        {"flick up before threshold", TimedDrag(MouseButton::BUTTON_4, 500, 500, 500, 460, 4, 5000),
+         {ActionType::TASK_VIEW}},
+        {"flick right before threshold", TimedDrag(MouseButton::BUTTON_4, 500, 500, 540, 502, 4, 5000),
+         {ActionType::SWITCH_DESKTOP_LEFT}},
+        // 40 像素 / 400 毫秒：太慢，也未达到阈值
+        {"slow short drag", TimedDrag(MouseButton::BUTTON_4, 500, 500, 500, 460, 4, 100000),
+         {}},
+        // 方向偏离轴线约 44 度
+        {"diagonal flick", TimedDrag(MouseButton::BUTTON_4, 500, 500, 540, 462, 4, 5000),
+         {}},
+    };
+
+    return RunActionCases(recognizer, sink, names, cases);
+}
+
+/**
+ * @brief 录制的侧键 4 直线拖动：每步 stepMs 毫秒，移动 (dx, dy)
+ */
+std::vector<TraceRecord> RecordedDrag(int dx, int dy, int steps, uint32_t stepMs) {
+    // 起点时间接近 32 位回绕，回放时的间隔仍然正确
+    uint32_t time = 0xFFFFFFF0u;
+    std::vector<TraceRecord> records(1, {TraceMessage::XBUTTON_DOWN, 500, 500, 0x10000, 0, time});
+    for (int i = 1; i <= steps; ++i) {
+        time += stepMs;
+        records.push_back({TraceMessage::MOUSE_MOVE, 500 + dx * i, 500 + dy * i, 0, 0, time});
+    }
+    records.push_back({TraceMessage::XBUTTON_UP, 500 + dx * steps, 500 + dy * steps, 0x10000, 0, time});
+    return records;
+}
+
+/**
+ * @brief 像 wmf-replay 一样回放录制的记录：paced 按录制节奏送入，否则以最快速度送入；
+ *        返回惯性滚动结束后的全部输出，stats 非空时取回队列统计
+ */
+std::vector<RecordingSink::Record> ReplayRecords(const std::vector<GestureConfig>& rules,
+                                                 const std::vector<TraceRecord>& records, bool paced,
+                                                 GestureRecognizer::QueueStats* stats = nullptr) {
+    RecordingSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(rules);
+    recognizer.SetLiveEventTimes(paced);
+
+    const uint32_t startTime = records.front().time;
+    const int64_t spanUs = static_cast<int64_t>(records.back().time - startTime) * 1000;
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t baseUs = paced ? MonotonicMicros() : MonotonicMicros() - spanUs;
+    for (const auto& record : records) {
+        InputEvent event;
+        if (!TraceRecordToInputEvent(record, startTime, baseUs, event)) {
+            continue;
+        }
+        if (paced) {
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(record.time - startTime));
+        }
+        recognizer.WaitForQueueSpace();
+        recognizer.OnInputEvent(event);
+    }
+    recognizer.WaitForIdle();
+
+    // 惯性滚动在工作线程中按帧继续，结束后再读取输出
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (recognizer.IsMomentumActive() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (stats) {
+        *stats = recognizer.GetQueueStats();
+    }
+    return sink.GetRecords();
+}
+
+/**
+ * @brief 回放时事件带着录制时的时间：最快速度回放与按节奏回放的轻扫判定相同，
+ *        松开后的惯性滚动同样逐帧衰减，不会在第一帧一次滚完
+ */
+int RunReplayTimingChecks() {
+    ConfigManager config;
+    config.CreateDefaultConfig();
+    std::vector<GestureConfig> rules = config.GetGestureConfigs();
+    for (auto& rule : rules) {
+        if (rule.triggerButton == MouseButton::BUTTON_4) {
+            rule.flickSpeed = 1500;
+        }
+    }
+
+    // 40 像素 / 20 毫秒是轻扫；40 像素 / 200 毫秒太慢，最快速度回放时也不能被当成轻扫
+    const std::vector<TraceRecord> fast = RecordedDrag(0, -10, 4, 5);
+    const std::vector<TraceRecord> slow = RecordedDrag(0, -10, 4, 50);
+    auto actions = [&rules](const std::vector<TraceRecord>& records, bool paced) {
+        std::vector<ActionType> result;
+        for (const auto& record : ReplayRecords(rules, records, paced)) {
+            result.push_back(record.action);
+        }
+        return result;
+    };
+    const std::vector<ActionType> flick(1, ActionType::TASK_VIEW);
+    const bool ok = actions(fast, false) == flick && actions(fast, true) == flick &&
+                    actions(slow, false).empty() && actions(slow, true).empty();
+
+    // 侧键 4 滚动规则：每 2 毫秒 10 像素后松开，惯性约 0.3 秒衰减完。录制在松开 2 秒后还有一条
+    // 滚轮记录，最快速度回放时松开的事件时间落在 2 秒之前，惯性仍要按帧推进
+    GestureConfig scroll;
+    scroll.triggerButton = MouseButton::BUTTON_4;
+    scroll.gestureType = GestureType::TWO_FINGER_SCROLL;
+    scroll.actionType = ActionType::SCROLL_SIMULATION;
+    scroll.threshold = 0;
+    scroll.scrollFriction = 20.0;
+    const std::vector<GestureConfig> scrollRules(1, scroll);
+    std::vector<TraceRecord> fling = RecordedDrag(0, 10, 10, 2);
+    fling.push_back({TraceMessage::MOUSE_WHEEL, 500, 600, 120u << 16, 0, fling.back().time + 2000});
+    const int dragTotal = 100 * ScrollProfile::kUnitsPerPixel;
+    auto coasts = [&](bool paced) {
+        const std::vector<RecordingSink::Record> records = ReplayRecords(scrollRules, fling, paced);
+        int total = 0;
+        for (const auto& record : records) {
+            total += record.scrollY;
+        }
+        const auto span = records.empty() ? std::chrono::steady_clock::duration()
+                                          : records.back().time - records.front().time;
+        return total > dragTotal + 50 * ScrollProfile::kUnitsPerPixel && span >= std::chrono::milliseconds(100);
+    };
+    const bool momentum = coasts(false) && coasts(true);
+
+    // 最快速度回放的事件时间不是入队时刻，不计入排队延迟；按节奏回放照常统计
+    GestureRecognizer::QueueStats maxSpeed;
+    GestureRecognizer::QueueStats paced;
+    ReplayRecords(rules, fast, false, &maxSpeed);
+    ReplayRecords(rules, fast, true, &paced);
+    const bool latency = maxSpeed.latencySamples == 0 && paced.latencySamples == fast.size();
+
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "replay keeps recorded timing\n";
+    std::cout << (momentum ? "[ OK ] " : "[FAIL] ") << "replayed fling coasts frame by frame\n";
+    std::cout << (latency ? "[ OK ] " : "[FAIL] ") << "max-speed replay skips queue latency\n";
+    return (ok ? 0 : 1) + (momentum ? 0 : 1) + (latency ? 0 : 1);
+}
+
+/**
+ * @brief 8 方向：配置了斜向手势的按钮按 45 度扇区识别，带角度容差与方向滞回
+ */
+int RunDirectionChecks(const ConfigManager& names, RecordingSink& sink) {
+    struct Rule {
+        GestureType gesture;
+        ActionType action;
+        int threshold;
+        int tolerance;
+    };
+    const Rule table[] = {
+        {GestureType::SWIPE_UP_RIGHT, ActionType::SHOW_DESKTOP, 60, 0},
+        {GestureType::SWIPE_DOWN_LEFT, ActionType::SWITCH_DESKTOP_LEFT, 60, 15},
+        {GestureType::SWIPE_RIGHT, ActionType::SWITCH_DESKTOP_RIGHT, 100, 0},
+        {GestureType::SWIPE_LEFT, ActionType::TASK_VIEW, 40, 0},
+    };
+    std::vector<GestureConfig> rules;
+    for (const Rule& rule : table) {
+        GestureConfig config;
+        config.triggerButton = MouseButton::BUTTON_5;
+        config.gestureType = rule.gesture;
+        config.actionType = rule.action;
+        config.threshold = rule.threshold;
+        config.angleTolerance = rule.tolerance;
+        config.angleHysteresis = 10;
+        rules.push_back(config);
+    }
+
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(rules);
+
+    const MouseButton b5 = MouseButton::BUTTON_5;
+    const std::vector<ActionCase> cases = {
+        {"diagonal up-right", Drag(b5, 500, 500, 570, 430, 7), {ActionType::SHOW_DESKTOP}},
+        // 偏离左下扇区中心约 18 度，超出 15 度容差
+        {"diagonal outside tolerance", Drag(b5, 500, 500, 455, 589, 10), {}},
+        // 先在向右扇区内（约 18 度）越过最小阈值，之后偏到约 27 度：滞回保持向右
+        {"direction hysteresis", Stroke(b5, {Point(500, 500), Point(560, 480), Point(600, 450)}, 6),
+         {ActionType::SWITCH_DESKTOP_RIGHT}},
+    };
+    return RunActionCases(recognizer, sink, names, cases);
+}
+
+/**
+ * @brief 预测式提前提交：方向明确时在阈值之前触发，对角线拖动和提交前反向都不触发
+ */
+int RunEarlyCommitChecks(const ConfigManager& names, RecordingSink& sink) {
+    ConfigManager config;
+    config.CreateDefaultConfig();
+    std::vector<GestureConfig> rules = config.GetGestureConfigs();
+    for (auto& rule : rules) {
+        if (rule.triggerButton == MouseButton::BUTTON_4) {
+            rule.commitConfidence = 0.8;
+            rule.commitDistance = 20;
+        }
+    }
+
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(rules);
+
+    // 先向左移 12 像素，再折返向右拖过阈值
+    std::vector<InputEvent> reversal = Drag(MouseButton::BUTTON_4, 500, 500, 488, 500, 3);
+    reversal.pop_back();
+    std::vector<InputEvent> back = Drag(MouseButton::BUTTON_4, 488, 500, 580, 500, 23);
+    reversal.insert(reversal.end(), back.begin() + 1, back.end());
+
+    const std::vector<ActionCase> cases = {
+        // 向上 30 像素，未达到 60 像素阈值
+        {"early commit up", Drag(MouseButton::BUTTON_4, 500, 500, 500, 470, 6), {ActionType::TASK_VIEW}},
+        // 偏离轴线约 44 度，越过阈值也不触发
+        {"diagonal drag", Drag(MouseButton::BUTTON_4, 500, 500, 555, 447, 10), {}},
+        {"reversal cancels", reversal, {}},
+    };
+
+    return RunActionCases(recognizer, sink, names, cases);
+}
+
+/**
+ * @brief 形状手势：内置与配置文件中的模板在释放时识别，不像任何形状的直线按滑动处理
+ */
+int RunShapeChecks(const ConfigManager& names, RecordingSink& sink) {
+    const std::string path = "wmf_selftest_shapes.json";
+    std::ofstream(path, std::ios::trunc) << R"({
+        "shapes": {"CHECK": [[0, 50], [30, 100], [100, 0]]},
+        "gestures": [
+            {"triggerButton": "BUTTON_5", "gestureType": "SHAPE", "shape": "L", "actionType": "TASK_VIEW"},
+            {"triggerButton": "BUTTON_5", "gestureType": "SHAPE", "shape": "CIRCLE", "actionType": "SHOW_DESKTOP"},
+            {"triggerButton": "BUTTON_5", "gestureType": "SHAPE", "shape": "CHECK", "actionType": "SWITCH_DESKTOP_RIGHT"},
+            {"triggerButton": "BUTTON_5", "gestureType": "SWIPE_UP", "actionType": "SWITCH_DESKTOP_LEFT", "threshold": 60}
+        ]})";
+    ConfigManager config;
+    bool loaded = config.LoadFromFile(path);
+    std::remove(path.c_str());
+    if (!loaded || config.GetSkippedCount() != 0) {
+        std::cout << "[FAIL] shape config (" << config.GetLastError() << ")\n";
+        return 1;
+    }
+
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+
+    std::vector<Point> circle;
+    for (int i = 0; i <= 24; ++i) {
+        double angle = 2 * 3.14159265358979323846 * i / 24;
+        circle.push_back(Point(500 + static_cast<int>(80 * cos(angle)), 500 + static_cast<int>(80 * sin(angle))));
+    }
+
+    const MouseButton b5 = MouseButton::BUTTON_5;
+    const std::vector<ActionCase> cases = {
+        {"shape L", Stroke(b5, {Point(500, 300), Point(503, 500), Point(620, 498)}, 10), {ActionType::TASK_VIEW}},
+        {"shape circle", Stroke(b5, circle, 2), {ActionType::SHOW_DESKTOP}},
+        {"shape from config", Stroke(b5, {Point(400, 450), Point(460, 520), Point(600, 330)}, 10),
+         {ActionType::SWITCH_DESKTOP_RIGHT}},
+        // 直线不像任何形状，按最终位移当作滑动
+        {"straight stroke falls back to swipe", Drag(b5, 500, 500, 500, 380, 12), {ActionType::SWITCH_DESKTOP_LEFT}},
+    };
+    return RunActionCases(recognizer, sink, names, cases);
+}
+
+/**
+ * @brief 多笔画序列：按笔画边界推进前缀树，释放时匹配完整序列，没有匹配的序列时按滑动处理
+ */
+int RunSequenceChecks(const ConfigManager& names, RecordingSink& sink) {
+    const std::string path = "wmf_selftest_sequences.json";
+    std::ofstream(path, std::ios::trunc) << R"({
+        "gestures": [
+            {"triggerButton": "BUTTON_5", "gestureType": "SEQUENCE", "sequence": ["SWIPE_UP", "SWIPE_RIGHT"],
+             "actionType": "TASK_VIEW", "threshold": 40},
+            {"triggerButton": "BUTTON_5", "gestureType": "SEQUENCE", "sequence": ["SWIPE_LEFT", "SWIPE_RIGHT", "SWIPE_LEFT"],
+             "actionType": "SHOW_DESKTOP", "threshold": 40},
+            {"triggerButton": "BUTTON_5", "gestureType": "SEQUENCE", "sequence": ["SWIPE_LEFT", "SWIPE_RIGHT"],
+             "actionType": "SWITCH_DESKTOP_LEFT", "threshold": 40},
+            {"triggerButton": "BUTTON_5", "gestureType": "SWIPE_UP", "actionType": "SWITCH_DESKTOP_RIGHT", "threshold": 60}
+        ]})";
+    ConfigManager config;
+    bool loaded = config.LoadFromFile(path);
+    std::remove(path.c_str());
+    if (!loaded || config.GetSkippedCount() != 0) {
+        std::cout << "[FAIL] sequence config (" << config.GetLastError() << ")\n";
+        return 1;
+    }
+
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+
+    const MouseButton b5 = MouseButton::BUTTON_5;
+    const std::vector<ActionCase> cases = {
+        {"sequence up-right", Stroke(b5, {Point(500, 500), Point(500, 400), Point(600, 400)}, 10),
+         {ActionType::TASK_VIEW}},
+        {"sequence left-right-left",
+         Stroke(b5, {Point(500, 500), Point(400, 500), Point(500, 500), Point(400, 500)}, 10),
+         {ActionType::SHOW_DESKTOP}},
+        // 是更长序列的前缀，同时本身也是一条序列
+        {"sequence prefix", Stroke(b5, {Point(500, 500), Point(400, 500), Point(500, 500)}, 10),
+         {ActionType::SWITCH_DESKTOP_LEFT}},
+        {"single stroke falls back to swipe", Drag(b5, 500, 500, 500, 400, 10), {ActionType::SWITCH_DESKTOP_RIGHT}},
+        {"unknown sequence", Stroke(b5, {Point(500, 500), Point(500, 400), Point(400, 400), Point(400, 500)}, 10),
+         {}},
+    };
+    return RunActionCases(recognizer, sink, names, cases);
+}
+
+/**
+ * @brief 拖动连发：触发后每再移动一步执行一次，往回一步执行相反方向的动作，连发受最小间隔限制
+ */
+int RunRepeatChecks(const ConfigManager& names, RecordingSink& sink) {
+    std::vector<GestureConfig> rules(2);
+    rules[0].triggerButton = MouseButton::BUTTON_4;
+    rules[0].gestureType = GestureType::SWIPE_RIGHT;
+    rules[0].actionType = ActionType::SWITCH_DESKTOP_RIGHT;
+    rules[0].threshold = 60;
+    rules[0].repeatStep = 80;
+    rules[0].repeatInterval = 100;
+    rules[1] = rules[0];
+    rules[1].gestureType = GestureType::SWIPE_LEFT;
+    rules[1].actionType = ActionType::SWITCH_DESKTOP_LEFT;
+
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(rules);
+
+    const MouseButton b4 = MouseButton::BUTTON_4;
+    const ActionType right = ActionType::SWITCH_DESKTOP_RIGHT;
+    const ActionType left = ActionType::SWITCH_DESKTOP_LEFT;
+    const std::vector<ActionCase> cases = {
+        // 560 处触发，640、720、800 处各连发一次
+        {"repeat every step", TimedDrag(b4, 500, 500, 800, 500, 30, 20000), {right, right, right, right}},
+        // 720 处折返：640、560、480 处各执行一次反向动作
+        {"repeat reverses",
+         Timed(Stroke(b4, {Point(500, 500), Point(720, 500), Point(480, 500)}, 22), 20000),
+         {right, right, right, left, left, left}},
+        // 30 毫秒内拖完，连发都被最小间隔挡住
+        {"repeat rate limited", TimedDrag(b4, 500, 500, 800, 500, 30, 1000), {right}},
+    };
+    return RunActionCases(recognizer, sink, names, cases);
+}
+
+/**
+ * @brief 平滑滚动：慢速逐像素不丢失，方向、各轴增益和加速曲线按规则配置
+ */
+int RunScrollChecks(RecordingSink& sink) {
+    GestureConfig base;
+    base.triggerButton = MouseButton::BUTTON_5;
+    base.gestureType = GestureType::TWO_FINGER_SCROLL;
+    base.actionType = ActionType::SCROLL_SIMULATION;
+    base.threshold = 0;
+
+    // 返回滚动总量
+    auto run = [&sink](const GestureConfig& rule, const std::vector<InputEvent>& events) {
+        GestureRecognizer recognizer(&sink);
+        recognizer.LoadConfig(std::vector<GestureConfig>(1, rule));
+        sink.Clear();
+        Feed(recognizer, events, true);
+        Point total;
+        for (const auto& record : sink.GetRecords()) {
+            total = total + Point(record.scrollX, record.scrollY);
+        }
+        return total;
+    };
+
+    const MouseButton b5 = MouseButton::BUTTON_5;
+    const int unit = ScrollProfile::kUnitsPerPixel;
+    GestureConfig inverted = base;
+    inverted.scrollNatural = false;
+    GestureConfig gain = base;
+    gain.scrollGainX = 2.0;
+    gain.scrollGainY = 0.5;
+    GestureConfig accelerated = base;
+    accelerated.scrollAcceleration = 1.0;
+
+    struct Check {
+        const char* name;
+        Point actual;
+        Point expected;
+    };
+    const Check checks[] = {
+        // 每 20 毫秒 1 像素
+        {"scroll pixel precise", run(base, TimedDrag(b5, 500, 500, 500, 510, 10, 20000)), Point(0, 10 * unit)},
+        {"scroll inverted", run(inverted, TimedDrag(b5, 500, 500, 500, 510, 10, 20000)), Point(0, -10 * unit)},
+        {"scroll axis gain", run(gain, TimedDrag(b5, 500, 500, 510, 510, 10, 20000)), Point(-20 * unit, 5 * unit)},
+    };
+
+    int failures = 0;
+    for (const Check& check : checks) {
+        bool ok = check.actual.x == check.expected.x && check.actual.y == check.expected.y;
+        std::cout << (ok ? "[ OK ] " : "[FAIL] ") << check.name;
+        if (!ok) {
+            std::cout << " (scroll " << check.actual.x << ' ' << check.actual.y << ')';
+            ++failures;
+        }
+        std::cout << '\n';
+    }
+
+    // 同样 100 像素：慢速约为线性滚动量，快速至少是它的两倍
+    int slow = run(accelerated, TimedDrag(b5, 500, 500, 500, 600, 100, 20000)).y;
+    int fast = run(accelerated, TimedDrag(b5, 500, 500, 500, 600, 10, 1000)).y;
+    bool ok = slow >= 100 * unit && slow < 110 * unit && fast >= 2 * slow;
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "scroll acceleration";
+    if (!ok) {
+        std::cout << " (slow " << slow << ", fast " << fast << ')';
+        ++failures;
+    }
+    std::cout << '\n';
+    return failures;
+}
+
+/**
+ * @brief 惯性滚动：快速松开后继续滚动并逐帧衰减，按下按钮或反向移动立即停止，停稳后松开不产生惯性
+ */
+int RunMomentumChecks(RecordingSink& sink) {
+    GestureConfig rule;
+    rule.triggerButton = MouseButton::BUTTON_5;
+    rule.gestureType = GestureType::TWO_FINGER_SCROLL;
+    rule.actionType = ActionType::SCROLL_SIMULATION;
+    rule.threshold = 0;
+    rule.scrollFriction = 20.0;
+
+    const MouseButton b5 = MouseButton::BUTTON_5;
+    const int dragTotal = 100 * ScrollProfile::kUnitsPerPixel;
+    // 每 2 毫秒 10 像素向下，松开时约 5000 像素/秒
+    std::vector<InputEvent> fling = TimedDrag(b5, 500, 500, 500, 600, 10, 2000);
+    // 同样的拖动，但停住 100 毫秒后才松开
+    std::vector<InputEvent> settled = fling;
+    for (size_t i = 0; i + 1 < settled.size(); ++i) {
+        settled[i].hookTimeUs -= 100000;
+    }
+    InputEvent press = Down(MouseButton::BUTTON_LEFT, 500, 600);
+    InputEvent opposite;
+    opposite.type = InputEvent::MOVE;
+    opposite.position = Point(500, 590);
+
+    // 送入事件，再送入 cancel（如果有），返回工作线程处理完后惯性是否仍在进行，以及惯性结束后的滚动总量
+    struct Outcome {
+        bool activeAfterCancel;
+        int scrollY;
+    };
+    auto run = [&](const std::vector<InputEvent>& events, const InputEvent* cancel) {
+        GestureRecognizer recognizer(&sink);
+        recognizer.LoadConfig(std::vector<GestureConfig>(1, rule));
+        sink.Clear();
+        Feed(recognizer, events, true);
+        if (cancel) {
+            Feed(recognizer, std::vector<InputEvent>(1, *cancel), true);
+        }
+        Outcome outcome = {recognizer.IsMomentumActive(), 0};
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (recognizer.IsMomentumActive() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        for (const auto& record : sink.GetRecords()) {
+            outcome.scrollY += record.scrollY;
+        }
+        if (cancel && cancel->type == InputEvent::BUTTON_DOWN) {
+            recognizer.OnInputEvent(Up(MouseButton::BUTTON_LEFT, 500, 600));
+            recognizer.WaitForIdle();
+        }
+        return outcome;
+    };
+
+    const Outcome coasted = run(fling, nullptr);
+    const Outcome pressed = run(fling, &press);
+    const Outcome reversed = run(fling, &opposite);
+    const Outcome still = run(settled, nullptr);
+
+    struct Check {
+        const char* name;
+        bool ok;
+    };
+    const Check checks[] = {
+        {"momentum after fling", coasted.scrollY > dragTotal + 50 * ScrollProfile::kUnitsPerPixel},
+        {"momentum cancelled by press", !pressed.activeAfterCancel && pressed.scrollY < coasted.scrollY},
+        {"momentum cancelled by opposite motion", !reversed.activeAfterCancel && reversed.scrollY < coasted.scrollY},
+        {"no momentum after settling", !still.activeAfterCancel && still.scrollY == dragTotal},
+    };
+    int failures = 0;
+    for (const Check& check : checks) {
+        std::cout << (check.ok ? "[ OK ] " : "[FAIL] ") << check.name;
+        if (!check.ok) {
+            std::cout << " (coasted " << coasted.scrollY << ", pressed " << pressed.scrollY << ", reversed "
+                      << reversed.scrollY << ", settled " << still.scrollY << ')';
+            ++failures;
+        }
+        std::cout << '\n';
+    }
+    return failures;
+}
+
+/**
+ * @brief 批量滚动输出：按输出频率合并采样的滚动量，两个方向一次发出，总量不变
+ */
+int RunScrollOutputChecks(RecordingSink& sink) {
+    GestureConfig rule;
+    rule.triggerButton = MouseButton::BUTTON_5;
+    rule.gestureType = GestureType::TWO_FINGER_SCROLL;
+    rule.actionType = ActionType::SCROLL_SIMULATION;
+    rule.threshold = 0;
+
+    struct Outcome {
+        GestureRecognizer::QueueStats stats;
+        Point total;
+    };
+    auto run = [&sink](const GestureConfig& config, const std::vector<InputEvent>& events) {
+        GestureRecognizer recognizer(&sink);
+        recognizer.LoadConfig(std::vector<GestureConfig>(1, config));
+        sink.Clear();
+        Feed(recognizer, events, true);
+        Outcome outcome = {recognizer.GetQueueStats(), Point()};
+        for (const auto& record : sink.GetRecords()) {
+            outcome.total = outcome.total + Point(record.scrollX, record.scrollY);
+        }
+        return outcome;
+    };
+
+    // 100 个采样沿对角线移动，送入速度远快于输出频率
+    const std::vector<InputEvent> drag = TimedDrag(MouseButton::BUTTON_5, 500, 500, 600, 600, 100, 1000);
+    GestureConfig batching = rule;
+    batching.scrollOutputRate = 120;
+    const Outcome unbatched = run(rule, drag);
+    const Outcome batched = run(batching, drag);
+
+    struct Check {
+        const char* name;
+        bool ok;
+    };
+    const Check checks[] = {
+        {"scroll output per sample", unbatched.stats.scrollFlushes == unbatched.stats.scrollSamples &&
+                                     unbatched.stats.scrollMessages == 2 * unbatched.stats.scrollFlushes},
+        {"scroll output batched", batched.stats.scrollSamples == unbatched.stats.scrollSamples &&
+                                  batched.stats.scrollFlushes * 4 < batched.stats.scrollSamples &&
+                                  batched.stats.scrollMessages <= 2 * batched.stats.scrollFlushes},
+        {"scroll batch keeps total", batched.total.x == unbatched.total.x && batched.total.y == unbatched.total.y},
+    };
+    int failures = 0;
+    for (const Check& check : checks) {
+        std::cout << (check.ok ? "[ OK ] " : "[FAIL] ") << check.name;
+        if (!check.ok) {
+            std::cout << " (samples " << batched.stats.scrollSamples << ", flushes " << unbatched.stats.scrollFlushes
+                      << " -> " << batched.stats.scrollFlushes << ", messages " << unbatched.stats.scrollMessages
+                      << " -> " << batched.stats.scrollMessages << ')';
+            ++failures;
+        }
+        std::cout << '\n';
+    }
+    return failures;
+}
+
+/**
+ * @brief 轴锁定：上下滚动时的左右手抖不产生水平滚动，转向另一方向后重新锁定
+ */
+int RunAxisLockChecks(RecordingSink& sink) {
+    GestureConfig rule;
+    rule.triggerButton = MouseButton::BUTTON_5;
+    rule.gestureType = GestureType::TWO_FINGER_SCROLL;
+    rule.actionType = ActionType::SCROLL_SIMULATION;
+    rule.threshold = 0;
+    rule.scrollAxisLock = true;
+    GestureConfig free = rule;
+    free.scrollAxisLock = false;
+
+    struct Outcome {
+        GestureRecognizer::QueueStats stats;
+        Point total;
+    };
+    auto run = [&sink](const GestureConfig& config, const std::vector<InputEvent>& events) {
+        GestureRecognizer recognizer(&sink);
+        recognizer.LoadConfig(std::vector<GestureConfig>(1, config));
+        sink.Clear();
+        Feed(recognizer, events, true);
+        Outcome outcome = {recognizer.GetQueueStats(), Point()};
+        for (const auto& record : sink.GetRecords()) {
+            outcome.total = outcome.total + Point(record.scrollX, record.scrollY);
+        }
+        return outcome;
+    };
+
+    const MouseButton b5 = MouseButton::BUTTON_5;
+    const int unit = ScrollProfile::kUnitsPerPixel;
+    // 每毫秒向下 3 像素，水平方向来回抖动 1 像素
+    std::vector<InputEvent> jitter = TimedDrag(b5, 500, 500, 500, 800, 100, 1000);
+    for (size_t i = 1; i + 1 < jitter.size(); ++i) {
+        jitter[i].position.x += static_cast<int>(i & 1);
+    }
+    // 向下 60 像素后转向右 60 像素
+    std::vector<InputEvent> turn = Timed(Stroke(b5, {Point(500, 500), Point(500, 560), Point(560, 560)}, 20), 1000);
+
+    const Outcome locked = run(rule, jitter);
+    const Outcome unlocked = run(free, jitter);
+    const Outcome turned = run(rule, turn);
+
+    struct Check {
+        const char* name;
+        bool ok;
+    };
+    const Check checks[] = {
+        {"scroll axis lock drops jitter", locked.total.x == 0 && locked.total.y == 300 * unit &&
+                                          locked.stats.scrollMessages == locked.stats.scrollFlushes},
+        {"scroll axis lock fewer messages", locked.stats.scrollMessages * 3 < unlocked.stats.scrollMessages * 2},
+        {"scroll axis lock follows turn", turned.total.y == 60 * unit && turned.total.x <= -30 * unit},
+    };
+    int failures = 0;
+    for (const Check& check : checks) {
+        std::cout << (check.ok ? "[ OK ] " : "[FAIL] ") << check.name;
+        if (!check.ok) {
+            std::cout << " (locked " << locked.total.x << ' ' << locked.total.y << " in "
+                      << locked.stats.scrollMessages << " messages, free " << unlocked.total.x << ' '
+                      << unlocked.total.y << " in " << unlocked.stats.scrollMessages << " messages, turn "
+                      << turned.total.x << ' ' << turned.total.y << ')';
+            ++failures;
+        }
+        std::cout << '\n';
+    }
+    return failures;
+}
+
+/**
+ * @brief 动作执行器：提交不阻塞，每个动作按下、释放各一次批量发出，排队的相同动作合并为一次连发，
+ *        防抖丢弃重复请求，配置中的热键在加载时解析
+ */
+int RunExecutorChecks() {
+    CaptureInputSink output;
+    ActionExecutor::Timing timing;
+    timing.keyGapUs = 2000;
+    timing.holdUs = 5000;
+
+    auto program = [](ActionType action) {
+        return CompileActionProgram(action, GetBuiltinChord(action));
+    };
+    auto downs = [&output](uint16_t key) {
+        int count = 0;
+        for (const auto& record : output.Snapshot()) {
+            count += (record.kind == CaptureInputSink::Record::KEY && record.key == key && record.down) ? 1 : 0;
+        }
+        return count;
+    };
+
+    // 单个动作：Ctrl、Win、Right 一次按下，保持后一次逆序释放
+    bool order = false;
+    bool spacing = false;
+    bool handoff = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        const int64_t start = MonotonicMicros();
+        executor.ExecuteAction(program(ActionType::SWITCH_DESKTOP_RIGHT), 0);
+        const int64_t submitUs = MonotonicMicros() - start;
+        executor.WaitForIdle();
+
+        const auto records = output.Snapshot();
+        const uint16_t keys[] = {VirtualKey::CONTROL, VirtualKey::LWIN, VirtualKey::RIGHT,
+                                 VirtualKey::RIGHT, VirtualKey::LWIN, VirtualKey::CONTROL};
+        order = records.size() == 6 && output.GetBatchCount() == 2;
+        for (size_t i = 0; order && i < records.size(); ++i) {
+            order = records[i].key == keys[i] && records[i].down == (i < 3);
+        }
+        spacing = order && records[3].timeUs - records[2].timeUs >= timing.holdUs;
+        handoff = order && submitUs < records.back().timeUs - records.front().timeUs;
+    }
+
+    // 任务视图执行期间排队的两次切换桌面合并为一次连发，两次滚动合并为一次输出；
+    // 滚动不等排在前面的连发，但也不在任务视图的按键按住期间发出
+    output.Clear();
+    bool coalesced = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        executor.ExecuteAction(program(ActionType::TASK_VIEW), 0);
+        executor.ExecuteAction(program(ActionType::SWITCH_DESKTOP_RIGHT), 0);
+        executor.ExecuteAction(program(ActionType::SWITCH_DESKTOP_RIGHT), 0);
+        executor.SimulateScroll(0, 120);
+        executor.SimulateScroll(0, 120);
+        executor.WaitForIdle();
+
+        const ActionExecutor::Stats stats = executor.GetStats();
+        const auto records = output.Snapshot();
+        // 任务视图 2 批，连发 4 批（按下、主键释放、主键按下、释放），滚动通常 1 批
+        // （执行线程恰好在两次提交之间取走时为 2 批）
+        bool held = false;
+        bool scrollOk = true;
+        bool burstStarted = false;
+        int scrollY = 0;
+        uint64_t scrollBatches = 0;
+        for (const auto& record : records) {
+            if (record.kind == CaptureInputSink::Record::SCROLL) {
+                scrollOk = scrollOk && !held && !burstStarted;
+                scrollY += record.scrollY;
+                ++scrollBatches;
+            } else if (record.key == VirtualKey::TAB) {
+                held = record.down;
+            } else if (record.key == VirtualKey::CONTROL) {
+                burstStarted = true;
+            }
+        }
+        coalesced = output.GetBatchCount() == 6 + scrollBatches && downs(VirtualKey::TAB) == 1 &&
+                    downs(VirtualKey::CONTROL) == 1 && downs(VirtualKey::RIGHT) == 2 && stats.bursts == 2 &&
+                    stats.coalesced == 1 + (2 - scrollBatches) && scrollOk && scrollY == 240;
+    }
+
+    // 防抖只作用于配置了 actionDebounce 的规则
+    output.Clear();
+    bool debounced = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        GestureConfig rule;
+        rule.actionType = ActionType::SHOW_DESKTOP;
+        rule.actionDebounce = 1000;
+        const ActionProgram desktop = CompileActionProgram(rule);
+        executor.ExecuteAction(desktop, 0);
+        executor.ExecuteAction(desktop, 0);
+        executor.ExecuteAction(program(ActionType::TASK_VIEW), 0);
+        executor.ExecuteAction(program(ActionType::TASK_VIEW), 0);
+        executor.WaitForIdle();
+        debounced = downs('D') == 1 && downs(VirtualKey::TAB) == 2 && executor.GetStats().debounced == 1;
+    }
+
+    // 防抖按规则计时：两条不同的自定义热键规则紧接着触发都会执行，同一规则的重复仍被丢弃
+    output.Clear();
+    bool debouncePerRule = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        GestureConfig first;
+        first.actionType = ActionType::CUSTOM_HOTKEY;
+        first.actionDebounce = 1000;
+        ParseHotkey("Ctrl+Shift+T", first.hotkey);
+        GestureConfig second = first;
+        ParseHotkey("Ctrl+Shift+N", second.hotkey);
+        const ActionProgram reopen = CompileActionProgram(first);
+        const ActionProgram window = CompileActionProgram(second);
+        executor.ExecuteAction(reopen, 0);
+        executor.ExecuteAction(window, 0);
+        executor.ExecuteAction(reopen, 0);
+        executor.WaitForIdle();
+        debouncePerRule = downs('T') == 1 && downs('N') == 1 && executor.GetStats().debounced == 1;
+    }
+
+    // 配置中的自定义热键：加载时解析，手势触发后经执行器发出
+    output.Clear();
+    bool hotkey = false;
+    {
+        const std::string path = "wmf_selftest_hotkey.json";
+        std::ofstream(path, std::ios::trunc) << R"({"gestures": [
+            {"triggerButton": "BUTTON_4", "gestureType": "SWIPE_UP", "actionType": "CUSTOM_HOTKEY", "hotkey": "ctrl + Shift+t"},
+            {"triggerButton": "BUTTON_4", "gestureType": "SWIPE_DOWN", "actionType": "CUSTOM_HOTKEY", "hotkey": "Ctrl+Nope"}
+        ]})";
+        ConfigManager config;
+        bool loaded = config.LoadFromFile(path);
+        std::remove(path.c_str());
+
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        GestureRecognizer recognizer(&executor);
+        recognizer.LoadConfig(config.GetGestureConfigs());
+        Feed(recognizer, Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12), true);
+        executor.WaitForIdle();
+
+        const auto records = output.Snapshot();
+        hotkey = loaded && config.GetSkippedCount() == 1 && config.GetGestureConfigs().size() == 1 &&
+                 FormatHotkey(config.GetGestureConfigs()[0].hotkey) == "Ctrl+Shift+T" &&
+                 records.size() == 6 && output.GetBatchCount() == 2 && records[0].key == VirtualKey::CONTROL &&
+                 records[1].key == VirtualKey::SHIFT && records[2].key == 'T' && records[2].down;
+    }
+
+    KeyChord chord;
+    const bool parsed = ParseHotkey("Win+Tab", chord) && chord.modifierCount == 1 && chord.key == VirtualKey::TAB &&
+                        ParseHotkey("Alt+F4", chord) && chord.key == VirtualKey::F1 + 3 &&
+                        ParseHotkey("Win", chord) && chord.modifierCount == 0 && chord.key == VirtualKey::LWIN &&
+                        !ParseHotkey("Ctrl+A+B", chord) && !ParseHotkey("Ctrl+Ctrl+A", chord) &&
+                        !ParseHotkey("Ctrl+", chord) && !ParseHotkey("", chord);
+
+    // 捕获端容量用完后丢弃并计数，已发布的记录不受影响
+    bool capture = false;
+    {
+        CaptureInputSink small(4);
+        const KeyEvent keys[] = {{'A', true}, {'A', false}, {'B', true}};
+        small.SendKeys(keys, 3);
+        small.SendKeys(keys, 3);
+        capture = small.GetCount() == 4 && small.GetDrops() == 2 && small.GetBatchCount() == 2 &&
+                  small.Get(3).key == 'A' && small.Get(3).down && small.Get(3).batch == 1;
+    }
+
+    struct Check {
+        const char* name;
+        bool ok;
+    };
+    const Check checks[] = {
+        {"executor key order", order},
+        {"executor key spacing", spacing},
+        {"executor submit does not block", handoff},
+        {"executor coalesces queued actions", coalesced},
+        {"executor debounce", debounced},
+        {"executor debounce is per rule", debouncePerRule},
+        {"hotkey parsing", parsed},
+        {"custom hotkey from config", hotkey},
+        {"capture sink overflow", capture},
+    };
+    int failures = 0;
+    for (const Check& check : checks) {
+        std::cout << (check.ok ? "[ OK ] " : "[FAIL] ") << check.name << '\n';
+        failures += check.ok ? 0 : 1;
+    }
+    return failures;
+}
+
+/**
+ * @brief 宏：加载时编译，执行器按截止时间解释执行，可中途取消，结束或取消时释放按下的键
+ */
+int RunMacroChecks() {
+    CaptureInputSink output;
+    ActionExecutor::Timing timing;
+    timing.keyGapUs = 2000;
+    timing.holdUs = 5000;
+    typedef CaptureInputSink::Record Record;
+
+    auto macro = [](const std::vector<std::string>& steps) {
+        GestureConfig config;
+        config.actionType = ActionType::MACRO;
+        auto code = std::make_shared<MacroCode>();
+        std::string error;
+        if (CompileMacro(steps, *code, error)) {
+            config.macroCode = code;
+        }
+        return CompileActionProgram(config);
+    };
+    auto invalid = [](const std::string& step) {
+        MacroCode code;
+        std::string error;
+        return !CompileMacro(std::vector<std::string>(1, step), code, error) && !error.empty();
+    };
+
+    const bool compiled = invalid("wait 60001") && invalid("down Ctrl+A") && invalid("click Foo") &&
+                          invalid("jump 3") && invalid("text") && invalid("wheel 0") && invalid("text \xff") &&
+                          macro({"key Ctrl+C"}).IsMacro() && macro({"key Ctrl+C"}).macro->size() == 10;
+
+    // 全部步骤：按键分两批（保持在中间），等待，文本（含代理对），滚轮，点击，最后自动释放仍按下的 Shift
+    bool order = false;
+    bool waited = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        executor.ExecuteAction(macro({"key Ctrl+C", "wait 10", "text H\xc3\xa9\xf0\x9f\x98\x80",
+                                      "wheel -120", "click Left", "down Shift"}), 0);
+        executor.WaitForIdle();
+
+        const auto records = output.Snapshot();
+        const Record expected[] = {
+            {Record::KEY, VirtualKey::CONTROL, true, 0, 0, 0, 0}, {Record::KEY, 'C', true, 0, 0, 0, 0},
+            {Record::KEY, 'C', false, 0, 0, 1, 0}, {Record::KEY, VirtualKey::CONTROL, false, 0, 0, 1, 0},
+            {Record::TEXT, 'H', false, 0, 0, 2, 0}, {Record::TEXT, 0xE9, false, 0, 0, 2, 0},
+            {Record::TEXT, 0xD83D, false, 0, 0, 2, 0}, {Record::TEXT, 0xDE00, false, 0, 0, 2, 0},
+            {Record::SCROLL, 0, false, 0, -120, 3, 0},
+            {Record::BUTTON, static_cast<uint16_t>(MouseButton::BUTTON_LEFT), true, 0, 0, 4, 0},
+            {Record::BUTTON, static_cast<uint16_t>(MouseButton::BUTTON_LEFT), false, 0, 0, 5, 0},
+            {Record::KEY, VirtualKey::SHIFT, true, 0, 0, 6, 0}, {Record::KEY, VirtualKey::SHIFT, false, 0, 0, 7, 0},
+        };
+        order = records.size() == sizeof(expected) / sizeof(expected[0]);
+        for (size_t i = 0; order && i < records.size(); ++i) {
+            order = records[i].kind == expected[i].kind && records[i].key == expected[i].key &&
+                    records[i].down == expected[i].down && records[i].scrollY == expected[i].scrollY &&
+                    records[i].batch == expected[i].batch;
+        }
+        waited = order && records[2].timeUs - records[1].timeUs >= timing.holdUs &&
+                 records[4].timeUs - records[3].timeUs >= 10000;
+    }
+
+    // 取消：长等待中途取消立即结束，已按下的 Ctrl 被释放，后面的步骤不执行
+    output.Clear();
+    bool cancelled = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        const int64_t start = MonotonicMicros();
+        executor.ExecuteAction(macro({"down Ctrl", "wait 5000", "key A"}), 0);
+        while (output.GetCount() == 0) {
+            std::this_thread::yield();
+        }
+        executor.CancelMacro();
+        executor.WaitForIdle();
+
+        const auto records = output.Snapshot();
+        const ActionExecutor::Stats stats = executor.GetStats();
+        cancelled = MonotonicMicros() - start < 1000000 && records.size() == 2 &&
+                    records[1].key == VirtualKey::CONTROL && !records[1].down &&
+                    stats.macros == 1 && stats.macrosCancelled == 1;
+    }
+
+    // 宏运行期间再次触发同一个宏视为取消
+    output.Clear();
+    bool retriggered = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        const ActionProgram program = macro({"down Ctrl", "wait 5000", "up Ctrl"});
+        executor.ExecuteAction(program, 0);
+        while (output.GetCount() == 0) {
+            std::this_thread::yield();
+        }
+        executor.ExecuteAction(program, 0);
+        executor.WaitForIdle();
+
+        const ActionExecutor::Stats stats = executor.GetStats();
+        retriggered = output.GetCount() == 2 && stats.macros == 1 && stats.macrosCancelled == 1;
+    }
+
+    // 宏等待期间执行线程照常工作：排队的动作和滚动不等宏的等待结束，后面的宏在等待槽中排队，
+    // 排在其他请求之后的再次触发同样中止宏
+    output.Clear();
+    bool serving = false;
+    {
+        ActionExecutor executor(&output);
+        executor.SetTiming(timing);
+        const ActionProgram program = macro({"key A", "wait 60000", "key B"});
+        const int64_t start = MonotonicMicros();
+        executor.ExecuteAction(program, 0);
+        while (output.GetCount() < 2) {
+            std::this_thread::yield();
+        }
+        executor.ExecuteAction(CompileActionProgram(ActionType::TASK_VIEW, GetBuiltinChord(ActionType::TASK_VIEW)), 0);
+        executor.SimulateScroll(0, -120);
+        // Win+Tab 的四个按键事件和一次滚动在宏的等待期间发出
+        while (output.GetCount() < 7 && MonotonicMicros() - start < 1000000) {
+            std::this_thread::yield();
+        }
+        const bool served = output.GetCount() == 7;
+
+        executor.ExecuteAction(macro({"key C"}), 0);
+        executor.ExecuteAction(CompileActionProgram(ActionType::SHOW_DESKTOP, GetBuiltinChord(ActionType::SHOW_DESKTOP)), 0);
+        executor.ExecuteAction(program, 0);
+        executor.WaitForIdle();
+
+        int desktops = 0;
+        int queued = 0;
+        bool skipped = true;
+        for (const Record& record : output.Snapshot()) {
+            desktops += (record.kind == Record::KEY && record.key == 'D' && record.down) ? 1 : 0;
+            queued += (record.kind == Record::KEY && record.key == 'C' && record.down) ? 1 : 0;
+            skipped = skipped && record.key != 'B';
+        }
+        const ActionExecutor::Stats stats = executor.GetStats();
+        serving = served && MonotonicMicros() - start < 1000000 && skipped && desktops == 1 && queued == 1 &&
+                  stats.macros == 2 && stats.macrosCancelled == 1;
+    }
+
+    // 配置中的宏：加载时编译，无效的步骤使规则被跳过，保存时写回步骤原文
+    bool fromConfig = false;
+    {
+        const std::string path = "wmf_selftest_macro.json";
+        std::ofstream(path, std::ios::trunc) << R"({"gestures": [
+            {"triggerButton": "BUTTON_4", "gestureType": "SWIPE_UP", "actionType": "MACRO", "macro": ["key Ctrl+L", "text example.com\n"]},
+            {"triggerButton": "BUTTON_4", "gestureType": "SWIPE_DOWN", "actionType": "MACRO", "macro": ["wait forever"]}
+        ]})";
+        ConfigManager config;
+        bool loaded = config.LoadFromFile(path);
+        std::remove(path.c_str());
+        fromConfig = loaded && config.GetSkippedCount() == 1 && config.GetGestureConfigs().size() == 1 &&
+                     config.GetGestureConfigs()[0].macroSteps.size() == 2 &&
+                     config.GetGestureConfigs()[0].macroCode != nullptr;
+    }
+
+    struct Check {
+        const char* name;
+        bool ok;
+    };
+    const Check checks[] = {
+        {"macro compile", compiled},
+        {"macro step order", order},
+        {"macro waits", waited},
+        {"macro cancel releases keys", cancelled},
+        {"macro retrigger cancels", retriggered},
+        {"executor serves requests while a macro waits", serving},
+        {"macro from config", fromConfig},
+    };
+    int failures = 0;
+    for (const Check& check : checks) {
+        std::cout << (check.ok ? "[ OK ] " : "[FAIL] ") << check.name << '\n';
+        failures += check.ok ? 0 : 1;
+    }
+    return failures;
+}
+
+/**
+ * @brief 延迟直方图：桶边界覆盖原值、百分位误差在子桶精度内；启用时一次手势经过每个阶段
+ */
+int RunLatencyChecks() {
+    bool buckets = true;
+    LatencyHistogram histogram;
+    for (int64_t value = 0; value < 5000000; value = value * 5 / 4 + 1) {
+        const int index = LatencyHistogram::BucketIndex(value);
+        buckets = buckets && LatencyHistogram::BucketLowerBound(index) <= value &&
+                  value <= LatencyHistogram::BucketUpperBound(index);
+    }
+    for (int64_t value = 1; value <= 100000; ++value) {
+        histogram.Record(value);
+    }
+    const LatencyHistogram::Summary summary = histogram.GetSummary();
+    const bool percentiles = buckets && summary.count == 100000 && summary.minNs == 1 && summary.maxNs == 100000 &&
+                             std::abs(summary.p50Ns - 50000) <= 50000 / 32 &&
+                             std::abs(summary.p99Ns - 99000) <= 99000 / 32 && summary.p999Ns <= summary.maxNs;
+
+    bool stages = true;
+#if WMF_LATENCY_TRACE
+    {
+        LatencyTrace::Reset();
+        CaptureInputSink output;
+        ActionExecutor executor(&output);
+        ActionExecutor::Timing timing;
+        timing.keyGapUs = 2000;
+        timing.holdUs = 2000;
+        executor.SetTiming(timing);
+        GestureRecognizer recognizer(&executor);
+        ConfigManager config;
+        config.CreateDefaultConfig();
+        recognizer.LoadConfig(config.GetGestureConfigs());
+        Feed(recognizer, Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12), true);
+        executor.WaitForIdle();
+
+        auto count = [](LatencyStage stage) { return LatencyTrace::Get(stage).GetCount(); };
+        stages = count(LatencyStage::QUEUE_WAIT) >= 12 && count(LatencyStage::RECOGNITION) == 1 &&
+                 count(LatencyStage::ACTION_QUEUE) == 1 && count(LatencyStage::INJECTION) == 2 &&
+                 count(LatencyStage::END_TO_END) == 1 &&
+                 LatencyTrace::Get(LatencyStage::END_TO_END).GetSummary().maxNs >=
+                     LatencyTrace::Get(LatencyStage::ACTION_QUEUE).GetSummary().minNs &&
+                 LatencyTrace::Format().find("end to end") != std::string::npos;
+    }
+#endif
+
+    std::cout << (percentiles ? "[ OK ] " : "[FAIL] ") << "latency histogram buckets\n";
+    std::cout << (stages ? "[ OK ] " : "[FAIL] ") << "latency stages from hook to injection\n";
+    return (percentiles ? 0 : 1) + (stages ? 0 : 1);
+}
+
+/**
+ * @brief 组合键：侧键 4 按住时按下左键，钩子线程即时看到组合，左键不被阻止
+ */
+int RunChordCheck(GestureRecognizer& recognizer) {
+    const uint32_t chord = ButtonState::Bit(MouseButton::BUTTON_4) | ButtonState::Bit(MouseButton::BUTTON_LEFT);
+    const ButtonState& buttons = recognizer.GetButtonState();
+
+    bool blocked4 = recognizer.OnInputEvent(Down(MouseButton::BUTTON_4, 500, 500));
+    bool blockedLeft = recognizer.OnInputEvent(Down(MouseButton::BUTTON_LEFT, 500, 500));
+    bool ok = blocked4 && !blockedLeft && buttons.IsChord(chord) &&
+              buttons.GetPressOrder(0) == MouseButton::BUTTON_4 &&
+              buttons.GetLastPressed() == MouseButton::BUTTON_LEFT;
+
+    ok = !recognizer.OnInputEvent(Up(MouseButton::BUTTON_LEFT, 500, 500)) && ok;
+    ok = buttons.GetPressedMask() == ButtonState::Bit(MouseButton::BUTTON_4) && ok;
+    recognizer.OnInputEvent(Up(MouseButton::BUTTON_4, 500, 500));
+    recognizer.WaitForIdle();
+    ok = buttons.GetPressedCount() == 0 && ok;
+
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "chord BUTTON_4 + LEFT\n";
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief 组合键触发："BUTTON_4+LEFT" 的规则只在按住侧键 4 时按下左键拖动触发，两个按钮都被阻止；
+ *        左键单独作为触发按钮的规则被拒绝，普通点击不受影响
+ */
+int RunChordTriggerChecks() {
+    const std::string path = "wmf_selftest_chord.json";
+    {
+        std::ofstream file(path);
+        file << R"({"gestures": [
+            {"triggerButton": "BUTTON_4", "gestureType": "SWIPE_UP", "actionType": "TASK_VIEW", "threshold": 60},
+            {"triggerButton": "BUTTON_4+LEFT", "gestureType": "SWIPE_UP", "actionType": "SHOW_DESKTOP", "threshold": 60},
+            {"triggerButton": "LEFT", "gestureType": "SWIPE_UP", "actionType": "SWITCH_DESKTOP_LEFT"}]})";
+    }
+    ConfigManager config;
+    bool loaded = config.LoadFromFile(path) && config.GetSkippedCount() == 1 && config.GetGestureConfigs().size() == 2;
+    config.SaveToFile(path);
+    ConfigManager saved;
+    loaded = saved.LoadFromFile(path) && saved.GetGestureConfigs().size() == 2 &&
+             saved.GetGestureConfigs()[1].holdButton == MouseButton::BUTTON_4 &&
+             saved.GetGestureConfigs()[1].triggerButton == MouseButton::BUTTON_LEFT && loaded;
+    std::remove(path.c_str());
+
+    RecordingSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+
+    // 按住侧键 4，左键按下拖动后释放，再释放侧键 4
+    std::vector<InputEvent> events(1, Down(MouseButton::BUTTON_4, 500, 500));
+    const std::vector<InputEvent> drag = Drag(MouseButton::BUTTON_LEFT, 500, 500, 500, 380, 12);
+    events.insert(events.end(), drag.begin(), drag.end());
+    events.push_back(Up(MouseButton::BUTTON_4, 500, 380));
+    std::vector<bool> blocked = Feed(recognizer, events, true);
+    bool chord = blocked.front() && blocked[1] && blocked[blocked.size() - 2] && blocked.back() &&
+                 sink.GetRecords().size() == 1 && sink.GetRecords()[0].action == ActionType::SHOW_DESKTOP;
+
+    // 单独的侧键 4 仍按自己的规则触发；单独的左键点击不被阻止
+    sink.Clear();
+    Feed(recognizer, Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12), true);
+    chord = sink.GetRecords().size() == 1 && sink.GetRecords()[0].action == ActionType::TASK_VIEW && chord;
+    sink.Clear();
+    blocked = Feed(recognizer, Drag(MouseButton::BUTTON_LEFT, 500, 500, 500, 380, 12), true);
+    chord = !blocked.front() && !blocked.back() && sink.GetRecords().empty() && chord;
+
+    std::cout << (loaded ? "[ OK ] " : "[FAIL] ") << "chord trigger config\n";
+    std::cout << (chord ? "[ OK ] " : "[FAIL] ") << "chord trigger BUTTON_4+LEFT\n";
+    return (loaded ? 0 : 1) + (chord ? 0 : 1);
+}
+
+/**
+ * @brief 在动作输出中阻塞工作线程，模拟工作线程长时间停顿
+ */
+class StallSink : public ActionSink {
+public:
+    void ExecuteAction(const ActionProgram&, int64_t) override { Stall(); }
+
+    void SimulateScroll(int, int deltaY) override {
+        Stall();
+        std::lock_guard<std::mutex> lock(mutex_);
+        scrollY_ += deltaY;
+    }
+
+    void Hold() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        held_ = true;
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        held_ = false;
+        cv_.notify_all();
+    }
+
+    bool IsStalled() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stalled_;
+    }
+
+    int GetScrollY() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return scrollY_;
+    }
+
+private:
+    void Stall() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stalled_ = held_;
+        cv_.wait(lock, [this] { return !held_; });
+        stalled_ = false;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool held_ = false;
+    bool stalled_ = false;
+    int scrollY_ = 0;
+};
+
+/**
+ * @brief 工作线程停顿时按钮通道被填满：丢失的释放由工作线程按钩子线程的按钮状态补齐，
+ *        手势不会一直处于激活状态
+ */
+int RunButtonOverflowCheck(const ConfigManager& config) {
+    StallSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+    sink.Hold();
+
+    // 侧键 4 上滑触发动作，工作线程停在动作输出中
+    std::vector<InputEvent> events = Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12);
+    const InputEvent up = events.back();
+    events.pop_back();
+    for (const InputEvent& event : events) {
+        recognizer.OnInputEvent(event);
+    }
+    const int64_t start = MonotonicMicros();
+    while (!sink.IsStalled() && MonotonicMicros() - start < 1000000) {
+        std::this_thread::yield();
+    }
+    const bool stalled = sink.IsStalled();
+
+    // 停顿期间的左键点击填满按钮通道，之后侧键 4 的释放丢失
+    for (int i = 0; i < 200; ++i) {
+        recognizer.OnInputEvent(Down(MouseButton::BUTTON_LEFT, 500, 380));
+        recognizer.OnInputEvent(Up(MouseButton::BUTTON_LEFT, 500, 380));
+    }
+    recognizer.OnInputEvent(up);
+    sink.Release();
+    recognizer.WaitForIdle();
+
+    const GestureRecognizer::QueueStats stats = recognizer.GetQueueStats();
+    const bool ok = stalled && stats.buttonDrops > 0 && stats.buttonResyncs > 0 && !recognizer.HasActiveGesture();
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "lost button release is resynced\n";
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief 工作线程停顿时移动通道被填满、随后停止移动：合并记录交给工作线程，
+ *        不等下一个钩子事件，最后的位移也能变成滚动
+ */
+int RunMoveHandoffCheck() {
+    GestureConfig rule;
+    rule.triggerButton = MouseButton::BUTTON_5;
+    rule.gestureType = GestureType::TWO_FINGER_SCROLL;
+    rule.actionType = ActionType::SCROLL_SIMULATION;
+    rule.threshold = 0;
+
+    StallSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(std::vector<GestureConfig>(1, rule));
+    sink.Hold();
+
+    // 按住侧键 5 逐像素下移，直到工作线程停在第一次滚动输出中，再移动 100 像素后停下（不释放）
+    recognizer.OnInputEvent(Down(MouseButton::BUTTON_5, 500, 500));
+    InputEvent move;
+    move.type = InputEvent::MOVE;
+    move.position = Point(500, 500);
+    const int64_t start = MonotonicMicros();
+    while (!sink.IsStalled() && MonotonicMicros() - start < 1000000) {
+        move.position.y++;
+        recognizer.OnInputEvent(move);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const bool stalled = sink.IsStalled();
+    for (int i = 0; i < 100; ++i) {
+        move.position.y++;
+        recognizer.OnInputEvent(move);
+    }
+    sink.Release();
+
+    const int expected = (move.position.y - 500) * ScrollProfile::kUnitsPerPixel;
+    while (sink.GetScrollY() != expected && MonotonicMicros() - start < 2000000) {
+        std::this_thread::yield();
+    }
+    const int scrolled = sink.GetScrollY();
+    const bool ok = stalled && scrolled == expected && recognizer.GetQueueStats().movesCoalesced > 0;
+    recognizer.OnInputEvent(Up(MouseButton::BUTTON_5, move.position.x, move.position.y));
+    recognizer.WaitForIdle();
+
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "coalesced move reaches the worker after movement stops";
+    if (!ok) {
+        std::cout << " (scroll " << scrolled << ", expected " << expected << ')';
+    }
+    std::cout << '\n';
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief 释放阻止判定的等待默认关闭，由配置的 blockDecisionTimeoutUs 开启（有上限）并能保存
+ */
+int RunBlockDecisionConfigCheck() {
+    const std::string path = "wmf_selftest_block.json";
+    ConfigManager config;
+    config.CreateDefaultConfig();
+    bool ok = config.GetBlockDecisionTimeoutUs() == 0;
+
+    config.SetBlockDecisionTimeoutUs(1500);
+    config.SaveToFile(path);
+    ConfigManager loaded;
+    ok = loaded.LoadFromFile(path) && loaded.GetBlockDecisionTimeoutUs() == 1500 && ok;
+    {
+        std::ofstream file(path);
+        file << R"({"blockDecisionTimeoutUs": 999999, "gestures": [
+            {"triggerButton": "BUTTON_4", "gestureType": "SWIPE_UP", "actionType": "TASK_VIEW", "threshold": 60}]})";
+    }
+    ok = loaded.LoadFromFile(path) && loaded.GetBlockDecisionTimeoutUs() == 10000 && ok;
+    std::remove(path.c_str());
+
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "block decision wait is opt-in\n";
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief 热重载：修改配置文件后新规则生效；无效的配置被拒绝并保留原有规则
+ */
+int RunReloadChecks(GestureRecognizer& recognizer, RecordingSink& sink) {
+    const std::string path = "wmf_selftest_config.json";
+    ConfigManager defaults;
+    defaults.CreateDefaultConfig();
+    defaults.SaveToFile(path);
+    recognizer.LoadConfig(defaults.GetGestureConfigs());
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int notifications = 0;
+
+    ConfigWatcher watcher;
+    watcher.SetPollInterval(std::chrono::milliseconds(20));
+    watcher.Start(
+        path,
+        [&recognizer](const std::vector<GestureConfig>& configs) { recognizer.LoadConfig(configs); },
+        [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++notifications;
+            cv.notify_one();
+        });
+
+    auto rewriteAndWait = [&](const char* content) {
+        int expected;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            expected = notifications + 1;
+        }
+        std::ofstream(path, std::ios::trunc) << content;
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(5), [&] { return notifications >= expected; });
+    };
+
+    auto swipeUpActions = [&]() {
+        sink.Clear();
+        Feed(recognizer, Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12), true);
+        std::vector<ActionType> actions;
+        for (const auto& record : sink.GetRecords()) {
+            actions.push_back(record.action);
+        }
+        return actions;
+    };
+
+    int failures = 0;
+    const std::vector<ActionType> showDesktop = {ActionType::SHOW_DESKTOP};
+
+    bool reloaded = rewriteAndWait(
+        R"({"gestures": [{"triggerButton": "BUTTON_4", "gestureType": "SWIPE_UP", "actionType": "SHOW_DESKTOP", "threshold": 60}]})");
+    bool ok = reloaded && watcher.GetLastResult().success && swipeUpActions() == showDesktop;
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "hot reload applies new rules\n";
+    failures += ok ? 0 : 1;
+
+    reloaded = rewriteAndWait(
+        R"({"gestures": [{"triggerButton": "BUTTON_4", "gestureType": "SWIPE_UPWARD", "actionType": "TASK_VIEW"}]})");
+    ConfigWatcher::ReloadResult result = watcher.GetLastResult();
+    ok = reloaded && !result.success && !result.error.empty() && swipeUpActions() == showDesktop;
+    std::cout << (ok ? "[ OK ] " : "[FAIL] ") << "hot reload rejects invalid config\n";
+    failures += ok ? 0 : 1;
+
+    watcher.Stop();
+    std::remove(path.c_str());
+    recognizer.LoadConfig(defaults.GetGestureConfigs());
+    return failures;
+}
+
+int RunSelftest() {
+    ConfigManager config;
+    config.CreateDefaultConfig();
+
+    RecordingSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+    // 放宽等待时限，避免测试机负载高时误判
+    recognizer.SetBlockDecisionTimeout(std::chrono::milliseconds(100));
+
+    const Scenario scenarios[] = {
+        {"swipe up", Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12),
+         {ActionType::TASK_VIEW}, 0, true},
+        {"swipe down", Drag(MouseButton::BUTTON_4, 500, 500, 505, 620, 12),
+         {ActionType::SHOW_DESKTOP}, 0, true},
+        {"swipe left", Drag(MouseButton::BUTTON_4, 500, 500, 380, 490, 12),
+         {ActionType::SWITCH_DESKTOP_RIGHT}, 0, true},
+        {"swipe right", Drag(MouseButton::BUTTON_4, 500, 500, 620, 510, 12),
+         {ActionType::SWITCH_DESKTOP_LEFT}, 0, true},
+        {"click without gesture", Drag(MouseButton::BUTTON_4, 500, 500, 510, 505, 4),
+         {}, 0, false},
+        {"scroll down", Drag(MouseButton::BUTTON_5, 500, 500, 500, 700, 40),
+         {}, 1, true},
+        {"scroll up", Drag(MouseButton::BUTTON_5, 500, 500, 500, 300, 40),
+         {}, -1, true},
+        {"unconfigured button", Drag(MouseButton::BUTTON_MIDDLE, 500, 500, 500, 300, 12),
+         {}, 0, false},
+        {"swipe up, unsynchronized", Drag(MouseButton::BUTTON_4, 500, 500, 500, 380, 12),
+         {ActionType::TASK_VIEW}, 0, true, false},
+        {"scroll, unsynchronized", Drag(MouseButton::BUTTON_5, 500, 500, 500, 700, 40),
+         {}, 1, true, false},
+    };
+
+    int failures = 0;
+    for (const auto& scenario : scenarios) {
+        sink.Clear();
+        std::vector<bool> blocked = Feed(recognizer, scenario.events, scenario.sync);
+
+        std::vector<ActionType> actions;
+        int scrollY = 0;
+        for (const auto& record : sink.GetRecords()) {
+            if (record.action == ActionType::SCROLL_SIMULATION) {
+                scrollY += record.scrollY;
+            } else {
+                actions.push_back(record.action);
+            }
+        }
+
+        int scrollSign = (scrollY > 0) - (scrollY < 0);
+        bool ok = actions == scenario.expectedActions &&
+                  scrollSign == scenario.expectedScrollSign &&
+                  blocked.back() == scenario.expectUpBlocked;
+
+        std::cout << (ok ? "[ OK ] " : "[FAIL] ") << scenario.name;
+        if (!ok) {
+            std::cout << " (actions:";
+            for (ActionType action : actions) {
+                std::cout << ' ' << config.ActionTypeToString(action);
+            }
+            std::cout << ", scrollY: " << scrollY
+                      << ", up blocked: " << (blocked.back() ? "yes" : "no") << ')';
+            ++failures;
+        }
+        std::cout << '\n';
+    }
+
+    failures += RunFlickChecks(config, sink);
+    failures += RunEarlyCommitChecks(config, sink);
+    failures += RunDirectionChecks(config, sink);
+    failures += RunShapeChecks(config, sink);
+    failures += RunSequenceChecks(config, sink);
+    failures += RunRepeatChecks(config, sink);
+    failures += RunScrollChecks(sink);
+    failures += RunMomentumChecks(sink);
+    failures += RunScrollOutputChecks(sink);
+    failures += RunAxisLockChecks(sink);
+    failures += RunExecutorChecks();
+    failures += RunMacroChecks();
+    failures += RunLatencyChecks();
+    failures += RunChordCheck(recognizer);
+    failures += RunChordTriggerChecks();
+    failures += RunReplayTimingChecks();
+    failures += RunButtonOverflowCheck(config);
+    failures += RunMoveHandoffCheck();
+    failures += RunBlockDecisionConfigCheck();
+    failures += RunReloadChecks(recognizer, sink);
+
+    std::cout << (failures == 0 ? "all scenarios passed" : "some scenarios failed") << '\n';
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+
+    if (options.selftest) {
+        return RunSelftest();
+    }
+
+    ConfigManager config;
+    if (options.configPath.empty()) {
+        config.CreateDefaultConfig();
+    } else if (!config.LoadFromFile(options.configPath)) {
+        std::cerr << "failed to load config: " << options.configPath << '\n';
+        return 1;
+    }
+
+    std::vector<InputEvent> events;
+    bool parsed;
+    if (options.scriptPath.empty() || options.scriptPath == "-") {
+        parsed = ParseScript(std::cin, config, events);
+    } else {
+        std::ifstream file(options.scriptPath);
+        if (!file.is_open()) {
+            std::cerr << "failed to open script: " << options.scriptPath << '\n';
+            return 1;
+        }
+        parsed = ParseScript(file, config, events);
+    }
+    if (!parsed) {
+        return 1;
+    }
+
+#ifdef WMF_HAVE_UINPUT
+    // --uinput: 识别器 -> 动作执行器 -> /dev/uinput，动作真正注入系统
+    if (options.uinput) {
+        UinputSink uinput;
+        if (!uinput.Open()) {
+            std::cerr << uinput.GetLastError() << '\n';
+            return 1;
+        }
+        ActionExecutor executor(&uinput);
+        GestureRecognizer recognizer(&executor);
+        recognizer.LoadConfig(config.GetGestureConfigs());
+        recognizer.SetBlockDecisionTimeout(std::chrono::microseconds(config.GetBlockDecisionTimeoutUs()));
+        for (int i = 0; i < options.repeat; ++i) {
+            Feed(recognizer, events, options.sync);
+        }
+        executor.WaitForIdle();
+        const ActionExecutor::Stats stats = executor.GetStats();
+        std::fprintf(stderr, "injected: %llu requests, %llu key events, %llu debounced\n",
+                     static_cast<unsigned long long>(stats.requests),
+                     static_cast<unsigned long long>(stats.keyEvents),
+                     static_cast<unsigned long long>(stats.debounced));
+        return 0;
+    }
+#else
+    if (options.uinput) {
+        std::cerr << "--uinput is only available on Linux\n";
+        return 1;
+    }
+#endif
+
+    RecordingSink sink;
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+    recognizer.SetBlockDecisionTimeout(std::chrono::microseconds(config.GetBlockDecisionTimeoutUs()));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.repeat; ++i) {
+        if (i > 0) {
+            sink.Clear();
+        }
+        Feed(recognizer, events, options.sync);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto& record : sink.GetRecords()) {
+        if (record.action == ActionType::SCROLL_SIMULATION) {
+            std::cout << "scroll " << record.scrollX << ' ' << record.scrollY << '\n';
+        } else {
+            std::cout << "action " << config.ActionTypeToString(record.action) << '\n';
+        }
+    }
+
+    const double total = static_cast<double>(events.size()) * options.repeat;
+    GestureRecognizer::QueueStats stats = recognizer.GetQueueStats();
+    std::fprintf(stderr,
+                 "events: %.0f, elapsed: %.3f ms, %.0f events/s\n"
+                 "move drops: %llu (coalesced %llu), move high water: %zu, button high water: %zu\n"
+                 "queue latency: mean %.1f us, max %lld us\n"
+                 "scroll: %llu samples, %llu flushes, %llu wheel messages\n",
+                 total, elapsed * 1000.0, elapsed > 0 ? total / elapsed : 0.0,
+                 static_cast<unsigned long long>(stats.moveDrops),
+                 static_cast<unsigned long long>(stats.movesCoalesced),
+                 stats.moveHighWater, stats.buttonHighWater,
+                 stats.meanQueueLatencyUs, static_cast<long long>(stats.maxQueueLatencyUs),
+                 static_cast<unsigned long long>(stats.scrollSamples),
+                 static_cast<unsigned long long>(stats.scrollFlushes),
+                 static_cast<unsigned long long>(stats.scrollMessages));
+    return 0;
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "ActionSink.h"
+#include <chrono>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 记录所有动作请求的输出端（无头驱动与回放工具共用）
+ *
+ * 在识别器工作线程中写入；调用方只在 WaitForIdle() 之后读取。
+ * 指定 next 时记录后把请求原样转发（例如转给 ActionExecutor 真正执行）。
+ */
+class RecordingSink : public ActionSink {
+public:
+    struct Record {
+        ActionType action;  // 滚动记为 SCROLL_SIMULATION
+        int scrollX;
+        int scrollY;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    explicit RecordingSink(ActionSink* next = nullptr)
+        : next_(next) {
+    }
+
+    void ExecuteAction(const ActionProgram& program, int64_t eventTimeUs) override {
+        records_.push_back({program.action, 0, 0, std::chrono::steady_clock::now()});
+        if (next_) {
+            next_->ExecuteAction(program, eventTimeUs);
+        }
+    }
+
+    void SimulateScroll(int deltaX, int deltaY) override {
+        records_.push_back({ActionType::SCROLL_SIMULATION, deltaX, deltaY, std::chrono::steady_clock::now()});
+        if (next_) {
+            next_->SimulateScroll(deltaX, deltaY);
+        }
+    }
+
+    const std::vector<Record>& GetRecords() const { return records_; }
+    void Clear() { records_.clear(); }
+
+private:
+    ActionSink* next_;
+    std::vector<Record> records_;
+};
+
+} // namespace WinMouseFix
@@ -0,0 +1,287 @@
+﻿// wmf-replay: 把录制的二进制轨迹回放给手势识别核心
+//
+// 用法:
+//   wmf-replay <trace.wmft> [--config <config.json>] [--paced | --sync] [--repeat N] [--inject]
+//              [--latency <file>] [--dump]
+//
+//   默认以最快速度回放；--paced 按录制时的时间间隔回放；
+//   --sync 每个事件后等待识别完成，可把动作归属到触发它的事件并测量端到端延迟；
+//   --inject 动作经动作执行器发到内存捕获端，与 --sync 一起使用时测量事件到首个按键注入的延迟；
+//   --latency 把各阶段的延迟直方图（LatencyTrace）写入文件；
+//   --dump 只打印解码后的原始记录。
+//
+// 轨迹由 win-mouse-fix.exe --record <file> 录制。
+
+#include "ActionExecutor.h"
+#include "CaptureInputSink.h"
+#include "ConfigManager.h"
+#include "GestureRecognizer.h"
+#include "InputTrace.h"
+#include "LatencyTrace.h"
+#include "RecordingSink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WinMouseFix;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string tracePath;
+    std::string configPath;
+    std::string latencyPath;
+    bool paced = false;
+    bool sync = false;
+    bool inject = false;
+    bool dump = false;
+    int repeat = 1;
+};
+
+bool ParseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            options.configPath = argv[++i];
+        } else if (arg == "--latency" && i + 1 < argc) {
+            options.latencyPath = argv[++i];
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--paced") {
+            options.paced = true;
+        } else if (arg == "--sync") {
+            options.sync = true;
+        } else if (arg == "--inject") {
+            options.inject = true;
+        } else if (arg == "--dump") {
+            options.dump = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.tracePath.empty()) {
+            options.tracePath = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.tracePath.empty() && !(options.paced && options.sync);
+}
+
+double Percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void PrintLatency(const char* name, std::vector<double>& samples) {
+    if (samples.empty()) {
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-24s p50 %8.0f ns  p99 %8.0f ns  p999 %8.0f ns  max %8.0f ns  (n=%zu)\n",
+                name, Percentile(samples, 0.50), Percentile(samples, 0.99),
+                Percentile(samples, 0.999), samples.back(), samples.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        std::fprintf(stderr, "usage: wmf-replay <trace.wmft> [--config <file>] [--paced | --sync] [--repeat N] [--inject] [--latency <file>] [--dump]\n");
+        return 2;
+    }
+
+    std::vector<TraceRecord> records;
+    if (!ReadTraceFile(options.tracePath, records)) {
+        std::fprintf(stderr, "failed to read trace: %s\n", options.tracePath.c_str());
+        return 1;
+    }
+
+    if (options.dump) {
+        for (const auto& r : records) {
+            std::printf("%10u  msg=0x%04x  pt=(%d,%d)  data=0x%08x  flags=0x%x\n",
+                        r.time, r.message, r.x, r.y, r.mouseData, r.flags);
+        }
+        return 0;
+    }
+
+    ConfigManager config;
+    if (options.configPath.empty()) {
+        config.CreateDefaultConfig();
+    } else if (!config.LoadFromFile(options.configPath)) {
+        std::fprintf(stderr, "failed to load config: %s\n", options.configPath.c_str());
+        return 1;
+    }
+
+    // 先按相对第一条记录的间隔转换，每一遍回放再加上该遍的起始时间
+    std::vector<InputEvent> events;
+    events.reserve(records.size());
+    for (const auto& record : records) {
+        InputEvent event;
+        if (TraceRecordToInputEvent(record, records.front().time, 0, event)) {
+            events.push_back(event);
+        }
+    }
+    if (events.empty()) {
+        std::fprintf(stderr, "trace contains no events the recognizer handles\n");
+        return 1;
+    }
+    const int64_t firstUs = events.front().hookTimeUs;
+    const int64_t spanUs = events.back().hookTimeUs - firstUs + 1000;
+
+    // --inject: 识别器 -> 执行器 -> 捕获端，识别器的输出仍经 RecordingSink 转发以便归属
+    CaptureInputSink capture;
+    ActionExecutor executor(&capture);
+
+    RecordingSink sink(options.inject ? &executor : nullptr);
+    GestureRecognizer recognizer(&sink);
+    recognizer.LoadConfig(config.GetGestureConfigs());
+    recognizer.SetBlockDecisionTimeout(std::chrono::microseconds(config.GetBlockDecisionTimeoutUs()));
+    // 只有按节奏回放时事件时间才接近实际的入队时刻
+    recognizer.SetLiveEventTimes(options.paced);
+
+    std::vector<double> hookCost;         // OnInputEvent 调用耗时
+    std::vector<double> actionLatency;    // 触发事件入队到动作发出（仅 --sync）
+    std::vector<double> injectLatency;    // 触发事件入队到首个按键注入（仅 --sync --inject）
+    hookCost.reserve(events.size() * options.repeat);
+
+    // 每个动作归属的事件下标（仅 --sync 有意义）
+    std::vector<size_t> actionEvent;
+    Clock::time_point start = Clock::now();
+    // 不按节奏回放时把所有遍的事件时间都放在过去，按录制间隔依次排开
+    const int64_t replayBaseUs = MonotonicMicros() - spanUs * options.repeat;
+
+    for (int pass = 0; pass < options.repeat; ++pass) {
+        sink.Clear();
+        capture.Clear();
+        actionEvent.clear();
+        Clock::time_point passStart = Clock::now();
+        // 识别器看到的事件时间与录制时的间隔一致（速度、连发间隔、惯性等），与回放速度无关
+        const int64_t passBaseUs = (options.paced
+            ? std::chrono::duration_cast<std::chrono::microseconds>(passStart.time_since_epoch()).count()
+            : replayBaseUs + pass * spanUs) - firstUs;
+
+        for (size_t i = 0; i < events.size(); ++i) {
+            InputEvent event = events[i];
+            event.hookTimeUs += passBaseUs;
+            if (options.paced) {
+                // 时间戳按 32 位回绕，差值仍然正确
+                uint32_t offset = event.timestamp - events[0].timestamp;
+                std::this_thread::sleep_until(passStart + std::chrono::milliseconds(offset));
+            } else {
+                recognizer.WaitForQueueSpace();
+            }
+
+            size_t before = sink.GetRecords().size();
+            size_t capturedBefore = capture.GetCount();
+            Clock::time_point t0 = Clock::now();
+            recognizer.OnInputEvent(event);
+            Clock::time_point t1 = Clock::now();
+            hookCost.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+            // 回放中 OnInputEvent 相当于钩子回调
+            WMF_LATENCY_RECORD(HOOK_CALLBACK,
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count(),
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(t1.time_since_epoch()).count());
+
+            if (options.sync) {
+                recognizer.WaitForIdle();
+                const auto& out = sink.GetRecords();
+                for (size_t k = before; k < out.size(); ++k) {
+                    actionEvent.push_back(i);
+                    if (out[k].action != ActionType::SCROLL_SIMULATION) {
+                        actionLatency.push_back(std::chrono::duration<double, std::nano>(out[k].time - t0).count());
+                    }
+                }
+                if (options.inject && out.size() > before) {
+                    executor.WaitForIdle();
+                    const int64_t t0Ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count();
+                    for (size_t k = capturedBefore; k < capture.GetCount(); ++k) {
+                        if (capture.Get(k).kind == CaptureInputSink::Record::KEY) {
+                            injectLatency.push_back(static_cast<double>(capture.Get(k).timeUs * 1000 - t0Ns));
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        recognizer.WaitForIdle();
+        executor.WaitForIdle();
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // 动作列表（最后一遍）
+    int scrollX = 0;
+    int scrollY = 0;
+    size_t scrollCount = 0;
+    const auto& out = sink.GetRecords();
+    for (size_t k = 0; k < out.size(); ++k) {
+        if (out[k].action == ActionType::SCROLL_SIMULATION) {
+            scrollX += out[k].scrollX;
+            scrollY += out[k].scrollY;
+            ++scrollCount;
+            continue;
+        }
+        if (options.sync) {
+            const InputEvent& trigger = events[actionEvent[k]];
+            std::printf("action %-22s at event #%zu  t=+%u ms  pt=(%d,%d)\n",
+                        config.ActionTypeToString(out[k].action).c_str(), actionEvent[k],
+                        trigger.timestamp - events[0].timestamp, trigger.position.x, trigger.position.y);
+        } else {
+            std::printf("action %s\n", config.ActionTypeToString(out[k].action).c_str());
+        }
+    }
+    if (scrollCount > 0) {
+        std::printf("scroll %zu calls, total (%d, %d)\n", scrollCount, scrollX, scrollY);
+    }
+
+    const double total = static_cast<double>(events.size()) * options.repeat;
+    std::printf("\nrecords: %zu, events: %zu, passes: %d\n", records.size(), events.size(), options.repeat);
+    std::printf("elapsed: %.3f ms, throughput: %.0f events/s\n", elapsed * 1000.0, total / elapsed);
+    PrintLatency("hook enqueue", hookCost);
+    PrintLatency("action latency", actionLatency);
+    PrintLatency("injection latency", injectLatency);
+
+    GestureRecognizer::QueueStats stats = recognizer.GetQueueStats();
+    std::printf("button drops: %llu (resynced %llu), move drops: %llu (coalesced %llu, records %llu), "
+                "move high water: %zu, button high water: %zu\n",
+                static_cast<unsigned long long>(stats.buttonDrops),
+                static_cast<unsigned long long>(stats.buttonResyncs),
+                static_cast<unsigned long long>(stats.moveDrops),
+                static_cast<unsigned long long>(stats.movesCoalesced),
+                static_cast<unsigned long long>(stats.coalescedRecords),
+                stats.moveHighWater, stats.buttonHighWater);
+    std::printf("stale block decisions: %llu\n", static_cast<unsigned long long>(stats.staleBlockDecisions));
+    std::printf("queue latency (event time to worker): mean %.1f us, max %lld us over %llu events\n",
+                stats.meanQueueLatencyUs, static_cast<long long>(stats.maxQueueLatencyUs),
+                static_cast<unsigned long long>(stats.latencySamples));
+    std::printf("scroll output: %llu samples, %llu flushes, %llu wheel messages\n",
+                static_cast<unsigned long long>(stats.scrollSamples),
+                static_cast<unsigned long long>(stats.scrollFlushes),
+                static_cast<unsigned long long>(stats.scrollMessages));
+    if (!options.paced) {
+        std::printf("event times follow the recording: queue latency and stages timed from the event "
+                    "are recorded only with --paced\n");
+    }
+    std::printf("\n%s", LatencyTrace::Format().c_str());
+    if (!options.latencyPath.empty() && !LatencyTrace::DumpToFile(options.latencyPath)) {
+        std::fprintf(stderr, "failed to write latency histograms: %s\n", options.latencyPath.c_str());
+    }
+    if (options.inject) {
+        const ActionExecutor::Stats injected = executor.GetStats();
+        std::printf("injected: %llu requests, %llu key events in %u batches (debounced %llu, coalesced %llu, drops %llu)\n",
+                    static_cast<unsigned long long>(injected.requests),
+                    static_cast<unsigned long long>(injected.keyEvents), capture.GetBatchCount(),
+                    static_cast<unsigned long long>(injected.debounced),
+                    static_cast<unsigned long long>(injected.coalesced),
+                    static_cast<unsigned long long>(injected.drops + capture.GetDrops()));
+    }
+    return 0;
+}
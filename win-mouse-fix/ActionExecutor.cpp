@@ -0,0 +1,395 @@
+﻿#include "ActionExecutor.h"
+#include "LatencyTrace.h"
+#include <algorithm>
+#include <chrono>
+
+namespace WinMouseFix {
+
+namespace {
+
+// 单写者计数器：只有一个线程写入，读取方可在任意线程
+inline void Increment(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+} // namespace
+
+ActionExecutor::ActionExecutor(InputSink* output)
+    : output_(output)
+    , pendingScroll_(0)
+    , scrollSubmitted_(0)
+    , scrollDrained_(0)
+    , segmentCount_(0)
+    , segmentIndex_(0)
+    , nextSegmentUs_(0)
+    , jobRequests_(0)
+    , jobEventUs_(0)
+    , macroEventUs_(0)
+    , queuedMacro_()
+    , hasQueuedMacro_(false)
+    , cancelRequested_(false)
+    , keyGapUs_(Timing().keyGapUs)
+    , holdUs_(Timing().holdUs)
+    , submitted_(0)
+    , completed_(0)
+    , requests_(0)
+    , debounced_(0)
+    , coalesced_(0)
+    , bursts_(0)
+    , keyEvents_(0)
+    , macros_(0)
+    , macrosCancelled_(0)
+    , running_(true)
+    , executorWaiting_(false) {
+    executorThread_ = std::thread(&ActionExecutor::ExecutorThreadFunc, this);
+}
+
+ActionExecutor::~ActionExecutor() {
+    // 执行线程会先做完当前的按键序列（释放已按下的修饰键）、中止正在执行的宏，再丢弃其余请求
+    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCV_.notify_one();
+    }
+
+    if (executorThread_.joinable()) {
+        executorThread_.join();
+    }
+}
+
+void ActionExecutor::SetTiming(const Timing& timing) {
+    keyGapUs_.store(std::max<int64_t>(0, timing.keyGapUs), std::memory_order_relaxed);
+    holdUs_.store(std::max<int64_t>(0, timing.holdUs), std::memory_order_relaxed);
+}
+
+void ActionExecutor::ExecuteAction(const ActionProgram& program, int64_t eventTimeUs) {
+    const int index = static_cast<int>(program.action);
+    if (index <= 0 || index >= kActionCount || (!program.HasKeys() && !program.IsMacro())) {
+        return;
+    }
+    Increment(requests_);
+
+    // 防抖在提交时按规则判断，被丢弃的请求不会进入队列
+    if (program.debounceUs > 0 && program.lastAcceptedUs) {
+        const int64_t now = MonotonicMicros();
+        const int64_t last = program.lastAcceptedUs->load(std::memory_order_relaxed);
+        if (last != 0 && now - last < program.debounceUs) {
+            Increment(debounced_);
+            return;
+        }
+        program.lastAcceptedUs->store(now, std::memory_order_relaxed);
+    }
+
+    Request request = {eventTimeUs, WMF_LATENCY_NOW(), program, false};
+    Submit(request);
+}
+
+void ActionExecutor::SimulateScroll(int deltaX, int deltaY) {
+    Increment(requests_);
+
+    // 并入待输出的滚动量；执行线程只做一次 exchange 取走，重试只发生在与它竞争时
+    uint64_t current = pendingScroll_.load(std::memory_order_relaxed);
+    while (!pendingScroll_.compare_exchange_weak(
+               current, PackScroll(ScrollX(current) + deltaX, ScrollY(current) + deltaY),
+               std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    // 先并入滚动量再发布计数：执行线程看到计数时一定能取到对应的滚动量
+    scrollSubmitted_.store(scrollSubmitted_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    submitted_.store(submitted_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    Wake();
+}
+
+void ActionExecutor::Submit(const Request& request) {
+    if (!queue_.TryPush(request)) {
+        return;
+    }
+    submitted_.store(submitted_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    Wake();
+}
+
+void ActionExecutor::CancelMacro() {
+    cancelRequested_.store(true, std::memory_order_relaxed);
+    Wake();
+}
+
+void ActionExecutor::Wake() {
+    // 与执行线程中的栅栏配对：要么执行线程看到新请求（或取消），要么这里看到它在休眠
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (executorWaiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCV_.notify_one();
+    }
+}
+
+void ActionExecutor::Complete(uint64_t count) {
+    completed_.store(completed_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+void ActionExecutor::WaitForIdle() {
+    while (completed_.load(std::memory_order_acquire) < submitted_.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+ActionExecutor::Stats ActionExecutor::GetStats() const {
+    Stats stats;
+    stats.requests = requests_.load(std::memory_order_relaxed);
+    stats.debounced = debounced_.load(std::memory_order_relaxed);
+    stats.drops = queue_.GetDrops();
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    stats.bursts = bursts_.load(std::memory_order_relaxed);
+    stats.keyEvents = keyEvents_.load(std::memory_order_relaxed);
+    stats.macros = macros_.load(std::memory_order_relaxed);
+    stats.macrosCancelled = macrosCancelled_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool ActionExecutor::SameKeys(const ActionProgram& a, const ActionProgram& b) {
+    if (a.macro != b.macro || a.eventCount != b.eventCount || a.pressCount != b.pressCount) {
+        return false;
+    }
+    // 逐个比较字段：KeyEvent 含填充字节，整块比较会受未初始化的填充影响
+    for (int i = 0; i < a.eventCount; ++i) {
+        if (a.events[i].key != b.events[i].key || a.events[i].down != b.events[i].down) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ActionExecutor::ExecutorThreadFunc() {
+    for (;;) {
+        const int64_t now = MonotonicMicros();
+        // 先记下已提交的请求数，休眠时据此判断期间是否有新请求
+        const uint64_t seen = submitted_.load(std::memory_order_acquire);
+        // 取消只作用于正在执行的宏，没有宏时的取消请求直接丢弃
+        const bool cancel = cancelRequested_.exchange(false, std::memory_order_relaxed);
+
+        // 滚动优先：没有按住的键时立即发出，不等排在前面的按键序列
+        if (!IsHoldingKeys() && DrainScroll()) {
+            continue;
+        }
+        if (macro_.IsRunning()) {
+            // 宏运行期间再次触发同一个宏视为取消，再次触发的请求可以排在其他请求之后
+            if (cancel || !running_ || FindRetrigger()) {
+                RunMacro(now, true);
+                continue;
+            }
+            // 按键序列的保持期间宏的下一步顺延，不与它按住的修饰键混在一起
+            if (now >= macro_.GetDeadline() && !IsHoldingSegment()) {
+                RunMacro(now, false);
+                continue;
+            }
+        }
+        if (segmentCount_ > 0) {
+            if (now >= nextSegmentUs_) {
+                RunSegments(now);
+                continue;
+            }
+        } else if (!running_) {
+            if (!macro_.IsRunning()) {
+                break;
+            }
+        } else if (!macro_.IsHolding() && StartNext(now)) {
+            // 宏按住键时不开始新的按键序列
+            continue;
+        }
+
+        // 先声明即将休眠，再复查一次，避免丢失唤醒
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        executorWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // 睡到下一段或宏的下一步的截止时间；有新请求（按键、滚动或再次触发）、取消或退出时提前醒来
+        int64_t deadline = segmentCount_ > 0 ? nextSegmentUs_ : INT64_MAX;
+        if (macro_.IsRunning() && !IsHoldingSegment() && macro_.GetDeadline() < deadline) {
+            deadline = macro_.GetDeadline();
+        }
+        auto woken = [this, seen] {
+            return submitted_.load(std::memory_order_relaxed) != seen ||
+                   cancelRequested_.load(std::memory_order_relaxed) ||
+                   (!running_ && segmentCount_ == 0);
+        };
+        if (deadline != INT64_MAX) {
+            wakeCV_.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(deadline)), woken);
+        } else {
+            wakeCV_.wait(lock, woken);
+        }
+        executorWaiting_.store(false, std::memory_order_relaxed);
+    }
+
+    // 退出时丢弃尚未开始的请求和尚未发出的滚动量
+    Request request;
+    uint64_t dropped = 0;
+    while (queue_.TryPop(request)) {
+        ++dropped;
+    }
+    if (hasQueuedMacro_) {
+        hasQueuedMacro_ = false;
+        queuedMacro_ = Request();
+        ++dropped;
+    }
+    const uint64_t scrolls = scrollSubmitted_.load(std::memory_order_acquire);
+    Complete(dropped + (scrolls - scrollDrained_));
+    scrollDrained_ = scrolls;
+}
+
+bool ActionExecutor::DrainScroll() {
+    // 先读计数再取滚动量：计数中的请求一定已经并入；之后并入的请求留到下一次，
+    // 它的滚动量若已被这次取走，下一次只补记完成数
+    const uint64_t submitted = scrollSubmitted_.load(std::memory_order_acquire);
+    if (submitted == scrollDrained_) {
+        return false;
+    }
+    const uint64_t count = submitted - scrollDrained_;
+    scrollDrained_ = submitted;
+
+    const uint64_t packed = pendingScroll_.exchange(0, std::memory_order_acquire);
+    if (packed != 0) {
+        const int64_t startNs = WMF_LATENCY_NOW();
+        output_->SendScroll(ScrollX(packed), ScrollY(packed));
+        WMF_LATENCY_RECORD(INJECTION, startNs, WMF_LATENCY_NOW());
+    }
+    Increment(coalesced_, count - 1);
+    Complete(count);
+    return true;
+}
+
+bool ActionExecutor::StartNext(int64_t nowUs) {
+    // 等待槽中的宏先于队列中的请求开始
+    if (hasQueuedMacro_ && !macro_.IsRunning()) {
+        hasQueuedMacro_ = false;
+        StartMacro(queuedMacro_, nowUs);
+        queuedMacro_ = Request();
+        return true;
+    }
+
+    const Request* front = queue_.Front();
+    if (!front) {
+        return false;
+    }
+    if (front->retrigger) {
+        // 已经中止过宏，不再执行
+        queue_.Pop();
+        Complete(1);
+        return true;
+    }
+
+    if (front->program.IsMacro()) {
+        if (!macro_.IsRunning()) {
+            StartMacro(*front, nowUs);
+            queue_.Pop();
+        } else if (front->program.macro.get() == macro_.GetCode()) {
+            // 扫描之后才到达的再次触发，留给下一轮的 FindRetrigger
+            return false;
+        } else if (!hasQueuedMacro_) {
+            // 宏运行期间取出的宏放进等待槽，后面的按键程序不必等它
+            queuedMacro_ = *front;
+            hasQueuedMacro_ = true;
+            queue_.Pop();
+        } else {
+            // 等待槽已占用：保持宏之间的先后顺序，队首留到当前宏结束
+            return false;
+        }
+        return true;
+    }
+
+    WMF_LATENCY_RECORD(ACTION_QUEUE, front->submitNs, WMF_LATENCY_NOW());
+    jobEventUs_ = front->eventUs;
+    program_ = front->program;
+    queue_.Pop();
+
+    // 排在一起的相同按键程序合并为一次连发：修饰键只按一次，主键点按多次
+    int repeat = 1;
+    while (repeat < kMaxBurst && (front = queue_.Front()) && SameKeys(front->program, program_)) {
+        queue_.Pop();
+        ++repeat;
+    }
+
+    // 按时间标记分段：[修饰键+主键 按下] 保持 [主键释放] 间隔 [主键按下] 保持 ... [主键+修饰键 释放]
+    const int64_t gap = keyGapUs_.load(std::memory_order_relaxed);
+    const int64_t hold = holdUs_.load(std::memory_order_relaxed);
+    const uint8_t press = program_.pressCount;
+    const uint8_t release = static_cast<uint8_t>(program_.eventCount - press);
+    int count = 0;
+    segments_[count++] = {0, press, hold};
+    for (int r = 1; r < repeat; ++r) {
+        segments_[count++] = {press, 1, gap};
+        segments_[count++] = {static_cast<uint8_t>(press - 1), 1, hold};
+    }
+    segments_[count++] = {press, release, gap};
+
+    segmentCount_ = count;
+    segmentIndex_ = 0;
+    nextSegmentUs_ = nowUs;
+    jobRequests_ = static_cast<uint64_t>(repeat);
+    Increment(bursts_);
+    Increment(coalesced_, static_cast<uint64_t>(repeat - 1));
+    RunSegments(nowUs);
+    return true;
+}
+
+void ActionExecutor::StartMacro(const Request& request, int64_t nowUs) {
+    WMF_LATENCY_RECORD(ACTION_QUEUE, request.submitNs, WMF_LATENCY_NOW());
+    macroEventUs_ = request.eventUs;
+    // 取消只作用于开始执行之后的宏
+    cancelRequested_.store(false, std::memory_order_relaxed);
+    macro_.Start(request.program.macro, nowUs);
+    Increment(macros_);
+    RunMacro(nowUs, false);
+}
+
+bool ActionExecutor::FindRetrigger() {
+    const MacroCode* code = macro_.GetCode();
+    for (size_t i = 0; Request* request = queue_.PeekAt(i); ++i) {
+        if (!request->retrigger && request->program.macro.get() == code) {
+            request->retrigger = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ActionExecutor::RunSegments(int64_t nowUs) {
+    while (segmentIndex_ < segmentCount_ && nowUs >= nextSegmentUs_) {
+        const Segment& segment = segments_[segmentIndex_++];
+        const int64_t startNs = WMF_LATENCY_NOW();
+        output_->SendKeys(program_.events + segment.offset, segment.count);
+        const int64_t endNs = WMF_LATENCY_NOW();
+        WMF_LATENCY_RECORD(INJECTION, startNs, endNs);
+        if (segmentIndex_ == 1 && jobEventUs_ > 0) {
+            // 按下段发出即视为动作生效
+            WMF_LATENCY_RECORD(END_TO_END, jobEventUs_ * 1000, endNs);
+        }
+        Increment(keyEvents_, segment.count);
+        // 间隔从实际发出的时刻算起，线程晚醒时不会压缩后面的间隔
+        nextSegmentUs_ = nowUs + segment.delayUs;
+    }
+
+    // 最后一段发出后同样留出间隔，再开始下一个序列
+    if (segmentIndex_ == segmentCount_ && nowUs >= nextSegmentUs_) {
+        segmentCount_ = 0;
+        segmentIndex_ = 0;
+        Complete(jobRequests_);
+    }
+}
+
+void ActionExecutor::RunMacro(int64_t nowUs, bool cancel) {
+    const uint64_t before = macro_.GetKeyEvents();
+    if (cancel) {
+        macro_.Cancel(output_);
+        Increment(macrosCancelled_);
+    } else {
+        macro_.Run(nowUs, holdUs_.load(std::memory_order_relaxed), output_);
+        if (macroEventUs_ > 0) {
+            // 宏的第一段（到第一个等待为止）发出即视为动作生效
+            WMF_LATENCY_RECORD(END_TO_END, macroEventUs_ * 1000, WMF_LATENCY_NOW());
+            macroEventUs_ = 0;
+        }
+    }
+    Increment(keyEvents_, macro_.GetKeyEvents() - before);
+    if (!macro_.IsRunning()) {
+        Complete(1);
+    }
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,227 @@
+﻿#pragma once
+
+#include "ActionProgram.h"
+#include "ActionSink.h"
+#include "InputSink.h"
+#include "MacroProgram.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 异步动作执行器 - 识别器只提交请求，按键注入在独立的执行线程中按时间表进行
+ *
+ * ExecuteAction / SimulateScroll 在识别器工作线程中调用，只把请求（含编译好的按键程序）
+ * 复制进无锁队列并返回。执行线程按程序的时间标记分段批量发出：按下段、保持 holdUs、
+ * 释放段，一个动作只有两次 InputSink::SendKeys。段之间的间隔是截止时间而不是 Sleep：
+ * 等待期间线程休眠到下一个截止时间，空闲时无限等待。
+ *
+ * 滚动不进入请求队列：提交时累加到一个原子的待输出滚动量，执行线程在没有注入的键
+ * 处于按下状态时（动作开始前、段之间的间隔、宏的等待）随时取出发出，不必等排在前面的
+ * 按键序列做完；按键保持期间仍要等待，否则按住的 Ctrl/Shift 会把滚动变成缩放或水平滚动。
+ *
+ * - 防抖：同一规则在 actionDebounce 毫秒内的重复请求在提交时直接丢弃（间隔和计时随编译后的程序）
+ * - 合并：排队中的相同按键程序合并为一次连发（修饰键只按一次，主键点按多次），
+ *   两次取出之间的滚动请求合并为一次输出
+ * - 宏：由 MacroInterpreter 逐条解释，等待同样是截止时间；宏运行期间再次触发同一个宏、
+ *   调用 CancelMacro() 或析构都会中止它并释放已按下的键
+ *
+ * 宏不独占执行线程：宏等待期间，排队的按键程序照常执行，后面的宏放进一个等待槽，
+ * 当前宏结束后开始。两边按住的键不会交错——宏按住键时不开始新的按键序列，
+ * 按键序列的保持期间宏的下一步顺延。再次触发同一个宏的请求不必排在队首，
+ * 执行线程每次醒来都扫描整个队列。
+ */
+class ActionExecutor : public ActionSink {
+public:
+    /**
+     * @brief 按键时间表
+     */
+    struct Timing {
+        int64_t keyGapUs;   // 主键释放后到下一次按下（或下一个动作）的间隔
+        int64_t holdUs;     // 主键按下到释放的间隔
+
+        Timing() : keyGapUs(20000), holdUs(50000) {}
+    };
+
+    struct Stats {
+        uint64_t requests;      // 提交的请求数（含被丢弃的）
+        uint64_t debounced;     // 防抖丢弃
+        uint64_t drops;         // 队列满丢弃
+        uint64_t coalesced;     // 合并到前一个请求中的请求数
+        uint64_t bursts;        // 实际执行的按键序列数
+        uint64_t keyEvents;     // 发出的按键事件数
+        uint64_t macros;        // 开始执行的宏
+        uint64_t macrosCancelled;  // 中途取消的宏
+    };
+
+    static const int kMaxBurst = 8;   // 一次连发最多合并的请求数
+
+    explicit ActionExecutor(InputSink* output);
+    ~ActionExecutor() override;
+
+    ActionExecutor(const ActionExecutor&) = delete;
+    ActionExecutor& operator=(const ActionExecutor&) = delete;
+
+    /**
+     * @brief 提交动作请求（仅识别器工作线程调用，不阻塞）
+     */
+    void ExecuteAction(const ActionProgram& program, int64_t eventTimeUs) override;
+
+    /**
+     * @brief 提交滚动请求（仅识别器工作线程调用，不阻塞）
+     */
+    void SimulateScroll(int deltaX, int deltaY) override;
+
+    /**
+     * @brief 设置按键时间表，对之后开始执行的动作生效
+     */
+    void SetTiming(const Timing& timing);
+
+    /**
+     * @brief 中止正在执行的宏并释放已按下的键，可在任意线程调用；排队的请求照常执行
+     */
+    void CancelMacro();
+
+    /**
+     * @brief 等待所有已提交的请求执行完毕
+     */
+    void WaitForIdle();
+
+    Stats GetStats() const;
+
+private:
+    struct Request {
+        int64_t eventUs;    // 触发事件的钩子入口时间（延迟统计）
+        int64_t submitNs;   // 提交时刻（延迟统计，未启用时为 0）
+        ActionProgram program;
+        bool retrigger;     // 已作为再次触发中止了正在执行的宏，出队时直接完成（执行线程标记）
+    };
+
+    /**
+     * @brief 一段批量发出的按键：program_.events 中 [offset, offset + count)，发出后等待 delayUs
+     */
+    struct Segment {
+        uint8_t offset;
+        uint8_t count;
+        int64_t delayUs;
+    };
+
+    static const size_t kQueueCapacity = 64;
+    static const int kMaxSegments = kMaxBurst * 2;
+    static const int kActionCount = static_cast<int>(ActionType::MACRO) + 1;
+
+    void ExecutorThreadFunc();
+
+    /**
+     * @brief 取出下一个请求并合并其后相同的请求，按键程序分段；
+     *        宏运行期间取出的宏放进等待槽
+     * @return 没有可以开始的请求时返回 false
+     */
+    bool StartNext(int64_t nowUs);
+
+    /**
+     * @brief 开始执行宏并运行到第一个等待
+     */
+    void StartMacro(const Request& request, int64_t nowUs);
+
+    /**
+     * @brief 在整个队列中查找再次触发当前宏的请求并标记
+     */
+    bool FindRetrigger();
+
+    /**
+     * @brief 发出累积的滚动量
+     * @return 没有待处理的滚动请求时返回 false
+     */
+    bool DrainScroll();
+
+    bool HasPendingScroll() const {
+        return scrollSubmitted_.load(std::memory_order_acquire) != scrollDrained_;
+    }
+
+    /**
+     * @brief 按键序列是否处于保持期间（按下段已发出，释放段未发出）
+     */
+    bool IsHoldingSegment() const {
+        return segmentIndex_ > 0 && segmentIndex_ < segmentCount_;
+    }
+
+    /**
+     * @brief 是否有注入的键或按钮处于按下状态（按键序列的保持期间，或宏按住的键）
+     */
+    bool IsHoldingKeys() const {
+        return IsHoldingSegment() || macro_.IsHolding();
+    }
+
+    // 待输出的滚动量打包为 64 位：低 32 位为水平，高 32 位为垂直
+    static uint64_t PackScroll(int x, int y) {
+        return static_cast<uint32_t>(x) | (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32);
+    }
+    static int ScrollX(uint64_t packed) { return static_cast<int32_t>(static_cast<uint32_t>(packed)); }
+    static int ScrollY(uint64_t packed) { return static_cast<int32_t>(static_cast<uint32_t>(packed >> 32)); }
+
+    /**
+     * @brief 发出所有已到截止时间的段
+     */
+    void RunSegments(int64_t nowUs);
+
+    /**
+     * @brief 执行宏到下一个等待；cancel 为 true 时中止
+     */
+    void RunMacro(int64_t nowUs, bool cancel);
+
+    void Wake();
+
+    static bool SameKeys(const ActionProgram& a, const ActionProgram& b);
+
+    void Submit(const Request& request);
+    void Complete(uint64_t count);
+
+    InputSink* output_;
+
+    // 工作线程 -> 执行线程
+    SpscRing<Request, kQueueCapacity> queue_;
+    std::atomic<uint64_t> pendingScroll_;     // 尚未发出的滚动量（PackScroll）
+    std::atomic<uint64_t> scrollSubmitted_;   // 已提交的滚动请求数（工作线程写入）
+    uint64_t scrollDrained_;                  // 已发出的滚动请求数（执行线程独占）
+
+    // 执行线程独占：当前按键序列
+    ActionProgram program_;
+    Segment segments_[kMaxSegments];
+    int segmentCount_;
+    int segmentIndex_;
+    int64_t nextSegmentUs_;
+    uint64_t jobRequests_;      // 当前序列合并的请求数
+    int64_t jobEventUs_;        // 当前序列第一个请求的触发事件时间，按下段发出后记录端到端延迟
+    MacroInterpreter macro_;    // 当前宏
+    int64_t macroEventUs_;      // 当前宏的触发事件时间，第一段发出后记录端到端延迟
+    Request queuedMacro_;       // 等当前宏结束后开始的宏
+    bool hasQueuedMacro_;
+    std::atomic<bool> cancelRequested_;
+
+    std::atomic<int64_t> keyGapUs_;
+    std::atomic<int64_t> holdUs_;
+
+    std::atomic<uint64_t> submitted_;
+    std::atomic<uint64_t> completed_;
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> debounced_;
+    std::atomic<uint64_t> coalesced_;
+    std::atomic<uint64_t> bursts_;
+    std::atomic<uint64_t> keyEvents_;
+    std::atomic<uint64_t> macros_;
+    std::atomic<uint64_t> macrosCancelled_;
+
+    std::thread executorThread_;
+    std::atomic<bool> running_;
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCV_;
+    std::atomic<bool> executorWaiting_;
+};
+
+} // namespace WinMouseFix
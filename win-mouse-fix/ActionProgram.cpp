@@ -0,0 +1,245 @@
+﻿#include "ActionProgram.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace WinMouseFix {
+
+namespace {
+
+struct KeyName {
+    const char* name;
+    uint16_t key;
+};
+
+// 修饰键（前面的名称为规范名称）
+const KeyName kModifierNames[] = {
+    {"Ctrl", VirtualKey::CONTROL},
+    {"Control", VirtualKey::CONTROL},
+    {"Shift", VirtualKey::SHIFT},
+    {"Alt", VirtualKey::MENU},
+    {"Win", VirtualKey::LWIN},
+    {"Windows", VirtualKey::LWIN},
+};
+
+// 功能键（同一键码的第一个名称为规范名称）
+const KeyName kKeyNames[] = {
+    {"Tab", VirtualKey::TAB},
+    {"Enter", VirtualKey::RETURN},
+    {"Return", VirtualKey::RETURN},
+    {"Esc", VirtualKey::ESCAPE},
+    {"Escape", VirtualKey::ESCAPE},
+    {"Space", VirtualKey::SPACE},
+    {"Backspace", VirtualKey::BACK},
+    {"Delete", VirtualKey::DEL},
+    {"Del", VirtualKey::DEL},
+    {"Insert", VirtualKey::INSERT},
+    {"Ins", VirtualKey::INSERT},
+    {"Home", VirtualKey::HOME},
+    {"End", VirtualKey::END},
+    {"PageUp", VirtualKey::PRIOR},
+    {"PgUp", VirtualKey::PRIOR},
+    {"PageDown", VirtualKey::NEXT},
+    {"PgDn", VirtualKey::NEXT},
+    {"Left", VirtualKey::LEFT},
+    {"Right", VirtualKey::RIGHT},
+    {"Up", VirtualKey::UP},
+    {"Down", VirtualKey::DOWN},
+    {"PrintScreen", VirtualKey::SNAPSHOT},
+};
+
+bool EqualsIgnoreCase(const std::string& a, const char* b) {
+    size_t n = strlen(b);
+    if (a.size() != n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LookupModifier(const std::string& name, uint16_t& key) {
+    for (const auto& entry : kModifierNames) {
+        if (EqualsIgnoreCase(name, entry.name)) {
+            key = entry.key;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LookupKey(const std::string& name, uint16_t& key) {
+    // 单个字母或数字：键码即大写 ASCII
+    if (name.size() == 1 && std::isalnum(static_cast<unsigned char>(name[0]))) {
+        key = static_cast<uint16_t>(std::toupper(static_cast<unsigned char>(name[0])));
+        return true;
+    }
+    // F1 ~ F24
+    if (name.size() >= 2 && name.size() <= 3 && (name[0] == 'F' || name[0] == 'f') &&
+        std::isdigit(static_cast<unsigned char>(name[1])) &&
+        (name.size() == 2 || std::isdigit(static_cast<unsigned char>(name[2])))) {
+        int number = std::atoi(name.c_str() + 1);
+        if (number >= 1 && number <= 24) {
+            key = static_cast<uint16_t>(VirtualKey::F1 + number - 1);
+            return true;
+        }
+        return false;
+    }
+    for (const auto& entry : kKeyNames) {
+        if (EqualsIgnoreCase(name, entry.name)) {
+            key = entry.key;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string KeyToName(uint16_t key) {
+    for (const auto& entry : kModifierNames) {
+        if (entry.key == key) {
+            return entry.name;
+        }
+    }
+    if ((key >= '0' && key <= '9') || (key >= 'A' && key <= 'Z')) {
+        return std::string(1, static_cast<char>(key));
+    }
+    if (key >= VirtualKey::F1 && key < VirtualKey::F1 + 24) {
+        return "F" + std::to_string(key - VirtualKey::F1 + 1);
+    }
+    for (const auto& entry : kKeyNames) {
+        if (entry.key == key) {
+            return entry.name;
+        }
+    }
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "0x%02X", key);
+    return buffer;
+}
+
+std::string Trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+KeyChord MakeChord(std::initializer_list<uint16_t> modifiers, uint16_t key) {
+    KeyChord chord;
+    for (uint16_t modifier : modifiers) {
+        chord.modifiers[chord.modifierCount++] = modifier;
+    }
+    chord.key = key;
+    return chord;
+}
+
+} // namespace
+
+bool ParseHotkey(const std::string& text, KeyChord& chord) {
+    KeyChord result;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('+', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string name = Trim(text.substr(start, end - start));
+        start = end + 1;
+
+        uint16_t key = 0;
+        if (LookupModifier(name, key)) {
+            for (int i = 0; i < result.modifierCount; ++i) {
+                if (result.modifiers[i] == key) {
+                    return false;
+                }
+            }
+            if (result.modifierCount == KeyChord::kMaxModifiers) {
+                return false;
+            }
+            result.modifiers[result.modifierCount++] = key;
+        } else if (LookupKey(name, key) && result.key == 0) {
+            result.key = key;
+        } else {
+            return false;
+        }
+    }
+
+    // 只有修饰键：最后一个作为主键，如 "Win" 单独点按
+    if (result.key == 0) {
+        if (result.modifierCount == 0) {
+            return false;
+        }
+        result.key = result.modifiers[--result.modifierCount];
+    }
+    chord = result;
+    return true;
+}
+
+std::string FormatHotkey(const KeyChord& chord) {
+    std::string text;
+    for (int i = 0; i < chord.modifierCount; ++i) {
+        text += KeyToName(chord.modifiers[i]);
+        text += '+';
+    }
+    return chord.key != 0 ? text + KeyToName(chord.key) : std::string();
+}
+
+KeyChord GetBuiltinChord(ActionType action) {
+    switch (action) {
+        case ActionType::TASK_VIEW:
+            return MakeChord({VirtualKey::LWIN}, VirtualKey::TAB);
+        case ActionType::SHOW_DESKTOP:
+            return MakeChord({VirtualKey::LWIN}, 'D');
+        case ActionType::SWITCH_DESKTOP_LEFT:
+            return MakeChord({VirtualKey::CONTROL, VirtualKey::LWIN}, VirtualKey::LEFT);
+        case ActionType::SWITCH_DESKTOP_RIGHT:
+            return MakeChord({VirtualKey::CONTROL, VirtualKey::LWIN}, VirtualKey::RIGHT);
+        default:
+            return KeyChord();
+    }
+}
+
+ActionProgram CompileActionProgram(ActionType action, const KeyChord& chord) {
+    ActionProgram program;
+    program.action = action;
+    if (chord.key == 0) {
+        return program;
+    }
+
+    int count = 0;
+    for (int i = 0; i < chord.modifierCount; ++i) {
+        program.events[count++] = {chord.modifiers[i], true};
+    }
+    program.events[count++] = {chord.key, true};
+    program.pressCount = static_cast<uint8_t>(count);
+    program.events[count++] = {chord.key, false};
+    for (int i = chord.modifierCount - 1; i >= 0; --i) {
+        program.events[count++] = {chord.modifiers[i], false};
+    }
+    program.eventCount = static_cast<uint8_t>(count);
+    return program;
+}
+
+ActionProgram CompileActionProgram(const GestureConfig& config) {
+    ActionProgram program;
+    if (config.actionType == ActionType::MACRO) {
+        program.action = ActionType::MACRO;
+        program.macro = config.macroCode;
+    } else {
+        const KeyChord chord = config.actionType == ActionType::CUSTOM_HOTKEY ? config.hotkey
+                                                                              : GetBuiltinChord(config.actionType);
+        program = CompileActionProgram(config.actionType, chord);
+    }
+    if (config.actionDebounce > 0 && (program.HasKeys() || program.IsMacro())) {
+        program.debounceUs = static_cast<int64_t>(config.actionDebounce) * 1000;
+        program.lastAcceptedUs = std::make_shared<std::atomic<int64_t>>(0);
+    }
+    return program;
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 虚拟键码（与 Win32 VK_* 取值一致，核心代码不依赖 <windows.h>）
+ */
+namespace VirtualKey {
+    const uint16_t BACK     = 0x08;
+    const uint16_t TAB      = 0x09;
+    const uint16_t RETURN   = 0x0D;
+    const uint16_t SHIFT    = 0x10;
+    const uint16_t CONTROL  = 0x11;
+    const uint16_t MENU     = 0x12;
+    const uint16_t ESCAPE   = 0x1B;
+    const uint16_t SPACE    = 0x20;
+    const uint16_t PRIOR    = 0x21;
+    const uint16_t NEXT     = 0x22;
+    const uint16_t END      = 0x23;
+    const uint16_t HOME     = 0x24;
+    const uint16_t LEFT     = 0x25;
+    const uint16_t UP       = 0x26;
+    const uint16_t RIGHT    = 0x27;
+    const uint16_t DOWN     = 0x28;
+    const uint16_t SNAPSHOT = 0x2C;
+    const uint16_t INSERT   = 0x2D;
+    const uint16_t DEL      = 0x2E;   // VK_DELETE（DELETE 与 <winnt.h> 中的宏冲突）
+    const uint16_t LWIN     = 0x5B;
+    const uint16_t F1       = 0x70;
+}
+
+/**
+ * @brief 解析热键字符串，如 "Ctrl+Shift+T"、"Win+Tab"、"Alt+F4"
+ *
+ * 按 '+' 分隔，名称不区分大小写；修饰键为 Ctrl、Shift、Alt、Win，
+ * 主键为字母、数字、F1~F24 和常用功能键（Tab、Enter、Esc、Space、Left 等）。
+ * 只有修饰键时最后一个作为主键（如 "Win"）。
+ * @return 名称无法识别、有多个主键或修饰键重复时返回 false
+ */
+bool ParseHotkey(const std::string& text, KeyChord& chord);
+
+/**
+ * @brief 热键的规范字符串（保存配置与界面显示用）
+ */
+std::string FormatHotkey(const KeyChord& chord);
+
+/**
+ * @brief 内置动作对应的组合键，没有按键的动作返回空组合键
+ */
+KeyChord GetBuiltinChord(ActionType action);
+
+/**
+ * @brief 由组合键编译按键程序
+ */
+ActionProgram CompileActionProgram(ActionType action, const KeyChord& chord);
+
+/**
+ * @brief 编译规则的动作：内置动作查表，CUSTOM_HOTKEY 使用规则中已解析的热键，
+ *        MACRO 引用规则中已编译的宏字节码
+ */
+ActionProgram CompileActionProgram(const GestureConfig& config);
+
+} // namespace WinMouseFix
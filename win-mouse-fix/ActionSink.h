@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 动作输出接口
+ *
+ * GestureRecognizer 只通过该接口发出动作请求，不直接依赖平台实现。
+ * 程序中由 ActionExecutor 实现（提交到执行线程，再由 WindowsActions 注入）；
+ * 无头驱动、回放工具等可提供自己的实现。接口方法在识别器的工作线程中调用，应当不阻塞。
+ */
+class ActionSink {
+public:
+    virtual ~ActionSink() {}
+
+    /**
+     * @brief 执行规则的动作
+     * @param program 加载配置时编译好的按键程序（program.action 为动作类型）
+     * @param eventTimeUs 触发事件在钩子入口处的 MonotonicMicros()，用于端到端延迟统计
+     */
+    virtual void ExecuteAction(const ActionProgram& program, int64_t eventTimeUs) = 0;
+
+    /**
+     * @brief 模拟鼠标滚轮滚动
+     *
+     * 滚动量为高分辨率滚轮单位（一格 WHEEL_DELTA = 120），方向与 Win32 mouseData 相同：
+     * 垂直正值为向前滚，水平正值为向右滚。方向与加速已由识别器处理。
+     * @param deltaX 水平滚动量
+     * @param deltaY 垂直滚动量
+     */
+    virtual void SimulateScroll(int deltaX, int deltaY) = 0;
+};
+
+} // namespace WinMouseFix
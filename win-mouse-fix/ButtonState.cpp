@@ -2,63 +2,85 @@
 
 namespace WinMouseFix {
 
-ButtonState::ButtonState() {
-    // 初始化所有按钮状态
-    buttonStates_[MouseButton::BUTTON_4] = ButtonInfo();
-    buttonStates_[MouseButton::BUTTON_5] = ButtonInfo();
-    buttonStates_[MouseButton::BUTTON_MIDDLE] = ButtonInfo();
-    buttonStates_[MouseButton::BUTTON_LEFT] = ButtonInfo();
-    buttonStates_[MouseButton::BUTTON_RIGHT] = ButtonInfo();
+ButtonState::ButtonState()
+    : buttonStates_()
+    , pressedMask_(0)
+    , pressedCount_(0) {
+    pressOrder_.fill(MouseButton::UNKNOWN);
 }
 
-void ButtonState::SetPressed(MouseButton button, const Point& position) {
-    auto it = buttonStates_.find(button);
-    if (it != buttonStates_.end()) {
-        it->second.pressed = true;
-        it->second.pressPosition = position;
-        it->second.pressTime = std::chrono::steady_clock::now();
+void ButtonState::SetPressed(MouseButton button, const Point& position, int64_t timeUs) {
+    if (!IsValid(button)) {
+        return;
     }
+
+    // 重复按下（丢失了释放事件）时移到最后，保持按下顺序不重复
+    if (IsPressed(button)) {
+        RemoveFromOrder(button);
+    }
+
+    ButtonInfo& info = buttonStates_[static_cast<int>(button)];
+    info.pressPosition = position;
+    info.pressTimeUs = timeUs;
+
+    pressOrder_[pressedCount_++] = button;
+    pressedMask_ |= Bit(button);
 }
 
-void ButtonState::SetReleased(MouseButton button) {
-    auto it = buttonStates_.find(button);
-    if (it != buttonStates_.end()) {
-        it->second.pressed = false;
+void ButtonState::SetReleased(MouseButton button, int64_t timeUs) {
+    if (!IsPressed(button)) {
+        return;
     }
+    ButtonInfo& info = buttonStates_[static_cast<int>(button)];
+    info.lastHoldUs = timeUs - info.pressTimeUs;
+    RemoveFromOrder(button);
+    pressedMask_ &= ~Bit(button);
 }
 
-bool ButtonState::IsPressed(MouseButton button) const {
-    auto it = buttonStates_.find(button);
-    if (it != buttonStates_.end()) {
-        return it->second.pressed;
+void ButtonState::RemoveFromOrder(MouseButton button) {
+    for (int i = 0; i < pressedCount_; ++i) {
+        if (pressOrder_[i] == button) {
+            for (int j = i + 1; j < pressedCount_; ++j) {
+                pressOrder_[j - 1] = pressOrder_[j];
+            }
+            pressOrder_[--pressedCount_] = MouseButton::UNKNOWN;
+            return;
+        }
     }
-    return false;
 }
 
 Point ButtonState::GetPressPosition(MouseButton button) const {
-    auto it = buttonStates_.find(button);
-    if (it != buttonStates_.end()) {
-        return it->second.pressPosition;
+    if (IsValid(button)) {
+        return buttonStates_[static_cast<int>(button)].pressPosition;
     }
     return Point(0, 0);
 }
 
-long long ButtonState::GetPressDuration(MouseButton button) const {
-    auto it = buttonStates_.find(button);
-    if (it != buttonStates_.end() && it->second.pressed) {
-        auto now = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - it->second.pressTime);
-        return duration.count();
+int64_t ButtonState::GetPressTime(MouseButton button) const {
+    if (IsValid(button)) {
+        return buttonStates_[static_cast<int>(button)].pressTimeUs;
     }
     return 0;
 }
 
-void ButtonState::Reset() {
-    for (auto& pair : buttonStates_) {
-        pair.second.pressed = false;
+long long ButtonState::GetPressDuration(MouseButton button, int64_t nowUs) const {
+    if (IsPressed(button)) {
+        return (nowUs - buttonStates_[static_cast<int>(button)].pressTimeUs) / 1000;
     }
+    return 0;
 }
 
-} // namespace WinMouseFix
+int64_t ButtonState::GetLastHoldDuration(MouseButton button) const {
+    if (IsValid(button)) {
+        return buttonStates_[static_cast<int>(button)].lastHoldUs;
+    }
+    return 0;
+}
 
+void ButtonState::Reset() {
+    pressOrder_.fill(MouseButton::UNKNOWN);
+    pressedMask_ = 0;
+    pressedCount_ = 0;
+}
+
+} // namespace WinMouseFix
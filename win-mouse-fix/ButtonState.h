@@ -1,31 +1,78 @@
 ﻿#pragma once
 
 #include "Common.h"
-#include <chrono>
+#include <array>
 
 namespace WinMouseFix {
 
 /**
  * @brief 按钮状态类 - 跟踪鼠标按钮的状态
+ *
+ * 五个按钮的状态存放在定长数组中，按下的按钮同时汇总为位掩码，并按按下顺序记录。
+ * 所有查询都是 O(1) 且不分配内存，可在钩子线程中使用。
+ * 时间均为事件发生时（钩子入口）的 MonotonicMicros()，不受排队延迟影响。
  */
 class ButtonState {
 public:
+    static const int kButtonCount = static_cast<int>(MouseButton::UNKNOWN);
+
+    /**
+     * @brief 按钮对应的掩码位（UNKNOWN 为 0）
+     */
+    static uint32_t Bit(MouseButton button) {
+        return IsValid(button) ? (1u << static_cast<int>(button)) : 0u;
+    }
+
     ButtonState();
 
     /**
      * @brief 设置按钮按下状态
+     * @param timeUs 按下事件的时间（微秒）
      */
-    void SetPressed(MouseButton button, const Point& position);
+    void SetPressed(MouseButton button, const Point& position, int64_t timeUs);
 
     /**
      * @brief 设置按钮释放状态
+     * @param timeUs 释放事件的时间（微秒）
      */
-    void SetReleased(MouseButton button);
+    void SetReleased(MouseButton button, int64_t timeUs);
 
     /**
      * @brief 检查按钮是否被按下
      */
-    bool IsPressed(MouseButton button) const;
+    bool IsPressed(MouseButton button) const { return (pressedMask_ & Bit(button)) != 0; }
+
+    /**
+     * @brief 当前按下的按钮掩码
+     */
+    uint32_t GetPressedMask() const { return pressedMask_; }
+
+    /**
+     * @brief 当前按下的按钮数
+     */
+    int GetPressedCount() const { return pressedCount_; }
+
+    /**
+     * @brief 按按下顺序获取按钮（0 为最早按下的），越界时返回 UNKNOWN
+     */
+    MouseButton GetPressOrder(int index) const {
+        return (index >= 0 && index < pressedCount_) ? pressOrder_[index] : MouseButton::UNKNOWN;
+    }
+
+    /**
+     * @brief 最后按下且仍未释放的按钮
+     */
+    MouseButton GetLastPressed() const { return GetPressOrder(pressedCount_ - 1); }
+
+    /**
+     * @brief 按下的恰好是 mask 中的按钮（组合键）
+     */
+    bool IsChord(uint32_t mask) const { return mask != 0 && pressedMask_ == mask; }
+
+    /**
+     * @brief mask 中的按钮都已按下（允许还有其他按钮）
+     */
+    bool IsChordHeld(uint32_t mask) const { return mask != 0 && (pressedMask_ & mask) == mask; }
 
     /**
      * @brief 获取按钮按下时的位置
@@ -33,9 +80,19 @@ public:
     Point GetPressPosition(MouseButton button) const;
 
     /**
-     * @brief 获取按钮按下的时长（毫秒）
+     * @brief 获取按钮按下时的时间（微秒）
+     */
+    int64_t GetPressTime(MouseButton button) const;
+
+    /**
+     * @brief 获取按钮到 nowUs 为止已按下的时长（毫秒），未按下时返回 0
      */
-    long long GetPressDuration(MouseButton button) const;
+    long long GetPressDuration(MouseButton button, int64_t nowUs) const;
+
+    /**
+     * @brief 获取按钮最近一次完整按下（按下到释放）的时长（微秒）
+     */
+    int64_t GetLastHoldDuration(MouseButton button) const;
 
     /**
      * @brief 重置所有按钮状态
@@ -43,16 +100,25 @@ public:
     void Reset();
 
 private:
+    static bool IsValid(MouseButton button) {
+        return static_cast<unsigned>(button) < static_cast<unsigned>(kButtonCount);
+    }
+
+    /**
+     * @brief 从按下顺序中移除按钮
+     */
+    void RemoveFromOrder(MouseButton button);
+
     struct ButtonInfo {
-        bool pressed;
         Point pressPosition;
-        std::chrono::steady_clock::time_point pressTime;
-        
-        ButtonInfo() : pressed(false), pressPosition(0, 0) {}
+        int64_t pressTimeUs;
+        int64_t lastHoldUs;
     };
 
-    std::map<MouseButton, ButtonInfo> buttonStates_;
+    std::array<ButtonInfo, kButtonCount> buttonStates_;
+    std::array<MouseButton, kButtonCount> pressOrder_;  // 仍按下的按钮，按按下先后排列
+    uint32_t pressedMask_;
+    int pressedCount_;
 };
 
 } // namespace WinMouseFix
-
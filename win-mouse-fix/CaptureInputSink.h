@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#include "InputSink.h"
+#include <atomic>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 内存捕获输出端 - 记录执行器发出的每个按键、滚动、文本和鼠标按钮及其时间，用于测试和测量注入延迟
+ *
+ * 记录槽位在构造时一次分配；执行线程（唯一写者）写入槽位后以 release 发布计数，
+ * 任意线程以 acquire 读取计数后即可读取之前的记录，无锁、写入时不分配。
+ * 容量用完后丢弃并计数。Clear() 只能在执行器空闲时调用。
+ */
+class CaptureInputSink : public InputSink {
+public:
+    struct Record {
+        enum Kind : uint8_t { KEY, SCROLL, TEXT, BUTTON };
+        Kind kind;
+        uint16_t key;       // 按键的键码、文本的 UTF-16 码元或 MouseButton；滚动记为 0
+        bool down;          // 文本记为 false
+        int scrollX;
+        int scrollY;
+        uint32_t batch;     // 所属批次（SendKeys / SendScroll 调用序号，从 0 开始）
+        int64_t timeUs;     // 发出时刻（MonotonicMicros()）
+    };
+
+    explicit CaptureInputSink(size_t capacity = 4096)
+        : records_(capacity)
+        , count_(0)
+        , batches_(0)
+        , drops_(0) {
+    }
+
+    void SendKeys(const KeyEvent* events, size_t count) override {
+        const int64_t now = MonotonicMicros();
+        const uint32_t batch = batches_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i) {
+            Append({Record::KEY, events[i].key, events[i].down, 0, 0, batch, now});
+        }
+        batches_.store(batch + 1, std::memory_order_release);
+    }
+
+    void SendScroll(int deltaX, int deltaY) override {
+        const uint32_t batch = batches_.load(std::memory_order_relaxed);
+        Append({Record::SCROLL, 0, false, deltaX, deltaY, batch, MonotonicMicros()});
+        batches_.store(batch + 1, std::memory_order_release);
+    }
+
+    void SendText(const uint16_t* units, size_t count) override {
+        const int64_t now = MonotonicMicros();
+        const uint32_t batch = batches_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i) {
+            Append({Record::TEXT, units[i], false, 0, 0, batch, now});
+        }
+        batches_.store(batch + 1, std::memory_order_release);
+    }
+
+    void SendButton(MouseButton button, bool down) override {
+        const uint32_t batch = batches_.load(std::memory_order_relaxed);
+        Append({Record::BUTTON, static_cast<uint16_t>(button), down, 0, 0, batch, MonotonicMicros()});
+        batches_.store(batch + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 已发布的记录数
+     */
+    size_t GetCount() const { return count_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 第 index 条记录（index < GetCount()）
+     */
+    const Record& Get(size_t index) const { return records_[index]; }
+
+    /**
+     * @brief 复制已发布的记录（读取方调用，会分配内存）
+     */
+    std::vector<Record> Snapshot() const {
+        const size_t count = GetCount();
+        return std::vector<Record>(records_.begin(), records_.begin() + count);
+    }
+
+    /**
+     * @brief 调用次数（对应 SendInput / write 次数）
+     */
+    uint32_t GetBatchCount() const { return batches_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 因容量用完而丢弃的记录数
+     */
+    uint64_t GetDrops() const { return drops_.load(std::memory_order_relaxed); }
+
+    void Clear() {
+        count_.store(0, std::memory_order_release);
+        batches_.store(0, std::memory_order_release);
+        drops_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    void Append(const Record& record) {
+        const size_t index = count_.load(std::memory_order_relaxed);
+        if (index == records_.size()) {
+            drops_.store(drops_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        records_[index] = record;
+        count_.store(index + 1, std::memory_order_release);
+    }
+
+    std::vector<Record> records_;
+    std::atomic<size_t> count_;
+    std::atomic<uint32_t> batches_;
+    std::atomic<uint64_t> drops_;
+};
+
+} // namespace WinMouseFix
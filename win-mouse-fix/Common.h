@@ -1,11 +1,14 @@
 ﻿#pragma once
 
-#include <windows.h>
 #include <string>
 #include <memory>
+#include <atomic>
 #include <functional>
 #include <vector>
 #include <map>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 
 namespace WinMouseFix {
 
@@ -26,7 +29,13 @@ enum class GestureType {
     SWIPE_DOWN,         // 向下滑动
     SWIPE_LEFT,         // 向左滑动
     SWIPE_RIGHT,        // 向右滑动
-    TWO_FINGER_SCROLL   // 两指滚动模拟
+    SWIPE_UP_LEFT,      // 向左上滑动
+    SWIPE_UP_RIGHT,     // 向右上滑动
+    SWIPE_DOWN_LEFT,    // 向左下滑动
+    SWIPE_DOWN_RIGHT,   // 向右下滑动
+    TWO_FINGER_SCROLL,  // 两指滚动模拟
+    SHAPE,              // 绘制形状（L、V、圆等），释放时与模板匹配
+    SEQUENCE            // 多笔画序列（如 上-右），释放时识别
 };
 
 // Action types
@@ -37,7 +46,8 @@ enum class ActionType {
     SWITCH_DESKTOP_LEFT,    // 切换到左边的虚拟桌面
     SWITCH_DESKTOP_RIGHT,   // 切换到右边的虚拟桌面
     SCROLL_SIMULATION,      // 滚动模拟
-    CUSTOM_HOTKEY           // 自定义热键
+    CUSTOM_HOTKEY,          // 自定义热键
+    MACRO                   // 宏（按键、文本、滚轮、点击与等待的序列）
 };
 
 // Point structure
@@ -61,18 +71,162 @@ struct Point {
     }
 };
 
+// Portable input event (filled by the platform hook or a replay/test driver)
+struct InputEvent {
+    enum Type {
+        BUTTON_DOWN,
+        BUTTON_UP,
+        MOVE
+    };
+
+    // flags 位定义
+    static const uint32_t FLAG_INJECTED = 0x01;  // 由程序注入（SendInput 等）
+
+    Type type;
+    MouseButton button;     // 仅按钮事件有效
+    Point position;         // 屏幕坐标
+    uint32_t timestamp;     // 毫秒时间戳（与 MSLLHOOKSTRUCT::time 同源，会回绕）
+    uint32_t flags;
+    int64_t hookTimeUs;     // 钩子入口处的 MonotonicMicros()，0 表示未提供（由识别器在入口处补上）
+
+    InputEvent()
+        : type(MOVE)
+        , button(MouseButton::UNKNOWN)
+        , timestamp(0)
+        , flags(0)
+        , hookTimeUs(0)
+    {}
+};
+
+// 高精度单调时钟（微秒）。钩子入口和工作线程使用同一时钟，差值即为排队延迟；
+// Windows 上 steady_clock 基于 QueryPerformanceCounter
+inline int64_t MonotonicMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 组合键：依次按下修饰键，点按主键，再逆序释放修饰键（键码与 Win32 VK_* 相同）
+struct KeyChord {
+    static const int kMaxModifiers = 4;
+
+    uint16_t modifiers[kMaxModifiers];
+    int modifierCount;
+    uint16_t key;       // 0 表示没有按键
+
+    KeyChord() : modifiers(), modifierCount(0), key(0) {}
+};
+
+// 一个按键事件
+struct KeyEvent {
+    uint16_t key;
+    bool down;
+};
+
+// 宏字节码（MacroProgram.h）：加载配置时编译，之后只读，由规则和执行中的请求共享
+typedef std::vector<uint8_t> MacroCode;
+
+// 编译后的按键程序：加载配置时由组合键生成，执行时不再分配或解析
+//   events = [修饰键按下..., 主键按下 | 主键释放, 修饰键逆序释放...]
+//   pressCount 是时间标记：按下段 [0, pressCount) 发出后保持一段时间，再发出释放段
+// MACRO 动作没有按键，执行宏字节码（复制只增加引用计数）
+// 防抖按规则计时：同一规则编译出的程序及其副本共享 lastAcceptedUs，不同规则互不影响
+struct ActionProgram {
+    static const int kMaxEvents = (KeyChord::kMaxModifiers + 1) * 2;
+
+    ActionType action;
+    uint8_t eventCount;     // 0 表示没有按键（滚动、宏或无效动作）
+    uint8_t pressCount;
+    KeyEvent events[kMaxEvents];
+    std::shared_ptr<const MacroCode> macro;
+    int64_t debounceUs;     // 防抖间隔（微秒），0 表示不限制
+    std::shared_ptr<std::atomic<int64_t>> lastAcceptedUs;  // 上次被接受的时间（仅识别器工作线程读写）
+
+    ActionProgram() : action(ActionType::NONE), eventCount(0), pressCount(0), events(), debounceUs(0) {}
+
+    bool HasKeys() const { return eventCount > 0; }
+    bool IsMacro() const { return macro != nullptr; }
+};
+
 // Gesture configuration
 struct GestureConfig {
     MouseButton triggerButton;
+    MouseButton holdButton;  // 组合键：按住此按钮时按下 triggerButton 才触发；UNKNOWN 表示单个按钮
     GestureType gestureType;
     ActionType actionType;
     int threshold;  // 触发手势的最小移动距离（像素）
     
+    // 方向扇区：按钮配置了斜向手势时分 8 个扇区，否则 4 个
+    int angleTolerance;    // 与扇区中心的最大夹角（度），0 表示整个扇区
+    int angleHysteresis;   // 方向切换的滞回角度（度），同一按钮取最大值，0 表示不启用
+    
+    // 快速轻扫：速度达到 flickSpeed 时不必等移动距离达到 threshold
+    int flickSpeed;        // 触发速度（像素/秒），0 表示不启用
+    int flickMinDistance;  // 轻扫的最小移动距离（像素），过滤抖动
+    int flickMaxAngle;     // 速度方向与手势方向的最大夹角（度）
+    
+    // 预测式提前提交：方向置信度达到 commitConfidence 时不必等移动距离达到 threshold
+    double commitConfidence;  // 提交所需的置信度（0~1），0 表示不启用
+    int commitDistance;       // 提前提交的最小移动距离（像素）
+    
+    // 拖动连发：触发后沿同一方向每再移动 repeatStep 像素再执行一次，
+    // 往回移动一步执行相反方向规则的动作
+    int repeatStep;        // 每次连发的移动距离（像素），0 表示不启用
+    int repeatInterval;    // 两次执行的最小间隔（毫秒）
+    
+    // 动作防抖：同一规则两次执行的最小间隔（毫秒），期间的重复请求被丢弃；0 表示不限制
+    int actionDebounce;
+    
+    // 自定义热键（actionType 为 CUSTOM_HOTKEY），如 "Ctrl+Shift+T"，加载配置时解析
+    KeyChord hotkey;
+    
+    // 宏（actionType 为 MACRO）：步骤原文与加载时编译的字节码
+    std::vector<std::string> macroSteps;
+    std::shared_ptr<const MacroCode> macroCode;
+    
+    // 编译后的按键程序（GestureTable::Compile 生成）
+    ActionProgram program;
+    
+    // 滚动模拟（gestureType 为 TWO_FINGER_SCROLL）
+    double scrollAcceleration;  // 速度每增加 1000 像素/秒滚动倍率增加的量，0 表示不加速
+    bool scrollNatural;         // 自然滚动方向，false 为反向
+    double scrollGainX;         // 水平滚动增益
+    double scrollGainY;         // 垂直滚动增益
+    double scrollFriction;      // 松开后惯性滚动的衰减率（每秒，速度按 e^(-scrollFriction*t) 衰减），0 表示不启用
+    int scrollOutputRate;       // 滚动输出频率（次/秒），期间的滚动量合并为一批；0 表示每个采样立即输出
+    bool scrollAxisLock;        // 锁定主方向，丢弃另一方向的抖动；false 表示不锁定
+    
+    // 形状手势（gestureType 为 SHAPE）：threshold 为笔画的最小长度
+    std::string shapeName;            // 模板名称
+    std::vector<Point> shapePoints;   // 模板笔画（内置模板或配置文件 shapes 中的点）
+    double shapeMinScore;             // 触发所需的最低相似度（0~1）
+    
+    // 多笔画序列（gestureType 为 SEQUENCE）：threshold 为每个笔画的最小长度
+    std::vector<GestureType> sequence;  // 笔画方向（滑动方向，至少两笔）
+    
     GestureConfig() 
         : triggerButton(MouseButton::UNKNOWN)
+        , holdButton(MouseButton::UNKNOWN)
         , gestureType(GestureType::NONE)
         , actionType(ActionType::NONE)
         , threshold(50) 
+        , angleTolerance(0)
+        , angleHysteresis(0)
+        , flickSpeed(0)
+        , flickMinDistance(15)
+        , flickMaxAngle(30)
+        , commitConfidence(0)
+        , commitDistance(20)
+        , repeatStep(0)
+        , repeatInterval(100)
+        , actionDebounce(0)
+        , scrollAcceleration(0)
+        , scrollNatural(true)
+        , scrollGainX(1.0)
+        , scrollGainY(1.0)
+        , scrollFriction(0)
+        , scrollOutputRate(0)
+        , scrollAxisLock(false)
+        , shapeMinScore(0.75)
     {}
 };
 
@@ -83,21 +237,5 @@ inline double distance(const Point& p1, const Point& p2) {
     return sqrt(static_cast<double>(dx * dx + dy * dy));
 }
 
-inline std::wstring StringToWString(const std::string& str) {
-    if (str.empty()) return std::wstring();
-    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
-    std::wstring wstr(size, 0);
-    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &wstr[0], size);
-    return wstr;
-}
-
-inline std::string WStringToString(const std::wstring& wstr) {
-    if (wstr.empty()) return std::string();
-    int size = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
-    std::string str(size, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &str[0], size, nullptr, nullptr);
-    return str;
-}
-
 } // namespace WinMouseFix
 
@@ -1,4 +1,9 @@
 ﻿#include "ConfigManager.h"
+#include "ActionProgram.h"
+#include "GestureTable.h"
+#include "MacroProgram.h"
+#include "ShapeMatcher.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -6,13 +11,22 @@ using json = nlohmann::json;
 
 namespace WinMouseFix {
 
-ConfigManager::ConfigManager() {
+namespace {
+const int kMaxBlockDecisionTimeoutUs = 10000;
+} // namespace
+
+ConfigManager::ConfigManager()
+    : skippedCount_(0)
+    , blockDecisionTimeoutUs_(0) {
 }
 
 bool ConfigManager::LoadFromFile(const std::string& filepath) {
+    lastError_.clear();
+    skippedCount_ = 0;
     try {
         std::ifstream file(filepath);
         if (!file.is_open()) {
+            lastError_ = "无法打开配置文件 " + filepath;
             return false;
         }
         
@@ -21,7 +35,8 @@ bool ConfigManager::LoadFromFile(const std::string& filepath) {
         file.close();
         
         return ParseJson(j);
-    } catch (const std::exception&) {
+    } catch (const std::exception& e) {
+        lastError_ = std::string("JSON 解析失败: ") + e.what();
         return false;
     }
 }
@@ -50,6 +65,7 @@ void ConfigManager::AddGestureConfig(const GestureConfig& config) {
 
 void ConfigManager::CreateDefaultConfig() {
     gestureConfigs_.clear();
+    blockDecisionTimeoutUs_ = 0;
     
     // 按钮4 + 向上滑动 = 任务视图
     GestureConfig config1;
@@ -93,44 +109,204 @@ void ConfigManager::CreateDefaultConfig() {
 }
 
 bool ConfigManager::ParseJson(const json& j) {
+    lastError_.clear();
+    skippedCount_ = 0;
     try {
         gestureConfigs_.clear();
         
+        // 钩子回调受 LowLevelHooksTimeout 限制，最多等待 10 毫秒
+        blockDecisionTimeoutUs_ = std::max(0, std::min(j.value("blockDecisionTimeoutUs", 0), kMaxBlockDecisionTimeoutUs));
+        
         if (!j.contains("gestures") || !j["gestures"].is_array()) {
+            lastError_ = "缺少 gestures 数组";
             return false;
         }
         
+        size_t index = 0;
+        int chordCount = 0;
         for (const auto& item : j["gestures"]) {
+            ++index;
             GestureConfig config;
             
-            config.triggerButton = StringToMouseButton(item.value("triggerButton", ""));
+            ParseTrigger(item.value("triggerButton", ""), config);
             config.gestureType = StringToGestureType(item.value("gestureType", ""));
             config.actionType = StringToActionType(item.value("actionType", ""));
             config.threshold = item.value("threshold", 50);
+            config.angleTolerance = item.value("angleTolerance", 0);
+            config.angleHysteresis = item.value("angleHysteresis", 0);
+            config.flickSpeed = item.value("flickSpeed", 0);
+            config.flickMinDistance = item.value("flickMinDistance", 15);
+            config.flickMaxAngle = item.value("flickMaxAngle", 30);
+            config.commitConfidence = item.value("commitConfidence", 0.0);
+            config.commitDistance = item.value("commitDistance", 20);
+            config.repeatStep = item.value("repeatStep", 0);
+            config.repeatInterval = item.value("repeatInterval", 100);
+            config.actionDebounce = item.value("actionDebounce", 0);
+            config.scrollAcceleration = item.value("scrollAcceleration", 0.0);
+            config.scrollNatural = item.value("scrollNatural", true);
+            config.scrollGainX = item.value("scrollGainX", 1.0);
+            config.scrollGainY = item.value("scrollGainY", 1.0);
+            config.scrollFriction = item.value("scrollFriction", 0.0);
+            config.scrollOutputRate = item.value("scrollOutputRate", 0);
+            config.scrollAxisLock = item.value("scrollAxisLock", false);
+            if (config.gestureType == GestureType::SEQUENCE) {
+                if (!ParseSequence(item, config.sequence)) {
+                    if (skippedCount_++ == 0) {
+                        lastError_ = "第 " + std::to_string(index) + " 条规则的笔画序列无效";
+                    }
+                    continue;
+                }
+            }
+            if (config.actionType == ActionType::CUSTOM_HOTKEY) {
+                // 热键名称只在加载时解析一次，执行时直接使用编译好的按键程序
+                if (!ParseHotkey(item.value("hotkey", ""), config.hotkey)) {
+                    if (skippedCount_++ == 0) {
+                        lastError_ = "第 " + std::to_string(index) + " 条规则的热键 " + item.value("hotkey", "") + " 无效";
+                    }
+                    continue;
+                }
+            }
+            if (config.actionType == ActionType::MACRO) {
+                // 宏步骤在加载时编译为字节码，执行线程只解释字节码
+                std::string error = "缺少 macro 步骤数组";
+                auto code = std::make_shared<MacroCode>();
+                bool valid = item.contains("macro") && item["macro"].is_array();
+                if (valid) {
+                    for (const auto& step : item["macro"]) {
+                        valid = valid && step.is_string();
+                        if (valid) {
+                            config.macroSteps.push_back(step.get<std::string>());
+                        }
+                    }
+                    if (!valid) {
+                        error = "macro 步骤必须是字符串";
+                    }
+                }
+                if (!valid || !CompileMacro(config.macroSteps, *code, error)) {
+                    if (skippedCount_++ == 0) {
+                        lastError_ = "第 " + std::to_string(index) + " 条规则: " + error;
+                    }
+                    continue;
+                }
+                config.macroCode = code;
+            }
+            if (config.gestureType == GestureType::SHAPE) {
+                config.shapeName = item.value("shape", "");
+                config.shapeMinScore = item.value("shapeMinScore", 0.75);
+                if (!ResolveShape(j, config.shapeName, config.shapePoints)) {
+                    if (skippedCount_++ == 0) {
+                        lastError_ = "第 " + std::to_string(index) + " 条规则的形状 " + config.shapeName + " 未定义";
+                    }
+                    continue;
+                }
+            }
+            
+            // 规则表最多容纳 GestureTable::kMaxChords 个不同的组合键
+            const bool newChord = config.holdButton != MouseButton::UNKNOWN && !HasChord(config);
+            if (newChord && chordCount >= GestureTable::kMaxChords) {
+                if (skippedCount_++ == 0) {
+                    lastError_ = "第 " + std::to_string(index) + " 条规则的组合键超过 " +
+                                 std::to_string(GestureTable::kMaxChords) + " 个";
+                }
+                continue;
+            }
             
             if (config.triggerButton != MouseButton::UNKNOWN &&
                 config.gestureType != GestureType::NONE &&
                 config.actionType != ActionType::NONE) {
                 gestureConfigs_.push_back(config);
+                chordCount += newChord ? 1 : 0;
+            } else if (skippedCount_++ == 0) {
+                lastError_ = "第 " + std::to_string(index) + " 条规则的按钮、手势或动作无效";
             }
         }
         
+        if (gestureConfigs_.empty() && lastError_.empty()) {
+            lastError_ = "没有有效的手势规则";
+        }
         return !gestureConfigs_.empty();
-    } catch (const std::exception&) {
+    } catch (const std::exception& e) {
+        lastError_ = std::string("配置格式错误: ") + e.what();
         return false;
     }
 }
 
 json ConfigManager::GenerateJson() const {
     json j;
+    if (blockDecisionTimeoutUs_ > 0) {
+        j["blockDecisionTimeoutUs"] = blockDecisionTimeoutUs_;
+    }
     j["gestures"] = json::array();
     
     for (const auto& config : gestureConfigs_) {
         json item;
-        item["triggerButton"] = MouseButtonToString(config.triggerButton);
+        item["triggerButton"] = config.holdButton != MouseButton::UNKNOWN
+            ? MouseButtonToString(config.holdButton) + "+" + MouseButtonToString(config.triggerButton)
+            : MouseButtonToString(config.triggerButton);
         item["gestureType"] = GestureTypeToString(config.gestureType);
         item["actionType"] = ActionTypeToString(config.actionType);
         item["threshold"] = config.threshold;
+        if (config.angleTolerance > 0) {
+            item["angleTolerance"] = config.angleTolerance;
+        }
+        if (config.angleHysteresis > 0) {
+            item["angleHysteresis"] = config.angleHysteresis;
+        }
+        if (config.flickSpeed > 0) {
+            item["flickSpeed"] = config.flickSpeed;
+            item["flickMinDistance"] = config.flickMinDistance;
+            item["flickMaxAngle"] = config.flickMaxAngle;
+        }
+        if (config.commitConfidence > 0) {
+            item["commitConfidence"] = config.commitConfidence;
+            item["commitDistance"] = config.commitDistance;
+        }
+        if (config.repeatStep > 0) {
+            item["repeatStep"] = config.repeatStep;
+            item["repeatInterval"] = config.repeatInterval;
+        }
+        if (config.actionType == ActionType::CUSTOM_HOTKEY) {
+            item["hotkey"] = FormatHotkey(config.hotkey);
+        }
+        if (config.actionType == ActionType::MACRO) {
+            item["macro"] = config.macroSteps;
+        }
+        if (config.actionDebounce > 0) {
+            item["actionDebounce"] = config.actionDebounce;
+        }
+        if (config.gestureType == GestureType::TWO_FINGER_SCROLL) {
+            item["scrollAcceleration"] = config.scrollAcceleration;
+            item["scrollNatural"] = config.scrollNatural;
+            item["scrollGainX"] = config.scrollGainX;
+            item["scrollGainY"] = config.scrollGainY;
+            item["scrollFriction"] = config.scrollFriction;
+            item["scrollOutputRate"] = config.scrollOutputRate;
+            item["scrollAxisLock"] = config.scrollAxisLock;
+        }
+        if (config.gestureType == GestureType::SEQUENCE) {
+            item["sequence"] = json::array();
+            for (GestureType stroke : config.sequence) {
+                item["sequence"].push_back(GestureTypeToString(stroke));
+            }
+        }
+        if (config.gestureType == GestureType::SHAPE) {
+            item["shape"] = config.shapeName;
+            item["shapeMinScore"] = config.shapeMinScore;
+            
+            // 与内置模板不同的笔画写入 shapes
+            std::vector<Point> builtin;
+            ShapeMatcher::GetBuiltinTemplate(config.shapeName, builtin);
+            bool same = builtin.size() == config.shapePoints.size() &&
+                        std::equal(builtin.begin(), builtin.end(), config.shapePoints.begin(),
+                                   [](const Point& a, const Point& b) { return a.x == b.x && a.y == b.y; });
+            if (!same) {
+                json points = json::array();
+                for (const auto& point : config.shapePoints) {
+                    points.push_back({point.x, point.y});
+                }
+                j["shapes"][config.shapeName] = points;
+            }
+        }
         
         j["gestures"].push_back(item);
     }
@@ -138,10 +314,45 @@ json ConfigManager::GenerateJson() const {
     return j;
 }
 
+bool ConfigManager::ParseSequence(const json& item, std::vector<GestureType>& strokes) const {
+    strokes.clear();
+    if (!item.contains("sequence") || !item["sequence"].is_array()) {
+        return false;
+    }
+    
+    // "sequence": ["SWIPE_UP", "SWIPE_RIGHT"]，每一笔都必须是滑动方向
+    for (const auto& name : item["sequence"]) {
+        GestureType stroke = name.is_string() ? StringToGestureType(name.get<std::string>()) : GestureType::NONE;
+        if (stroke < GestureType::SWIPE_UP || stroke > GestureType::SWIPE_DOWN_RIGHT) {
+            return false;
+        }
+        strokes.push_back(stroke);
+    }
+    return strokes.size() >= 2;
+}
+
+bool ConfigManager::ResolveShape(const json& j, const std::string& name, std::vector<Point>& points) {
+    points.clear();
+    if (name.empty()) {
+        return false;
+    }
+    
+    // "shapes": { "名称": [[x, y], ...] }
+    if (j.contains("shapes") && j["shapes"].is_object() && j["shapes"].contains(name)) {
+        for (const auto& point : j["shapes"][name]) {
+            points.push_back(Point(point.at(0).get<int>(), point.at(1).get<int>()));
+        }
+        return points.size() >= 2;
+    }
+    return ShapeMatcher::GetBuiltinTemplate(name, points);
+}
+
 MouseButton ConfigManager::StringToMouseButton(const std::string& str) const {
     if (str == "BUTTON_4") return MouseButton::BUTTON_4;
     if (str == "BUTTON_5") return MouseButton::BUTTON_5;
     if (str == "BUTTON_MIDDLE") return MouseButton::BUTTON_MIDDLE;
+    if (str == "LEFT" || str == "BUTTON_LEFT") return MouseButton::BUTTON_LEFT;
+    if (str == "RIGHT" || str == "BUTTON_RIGHT") return MouseButton::BUTTON_RIGHT;
     return MouseButton::UNKNOWN;
 }
 
@@ -150,16 +361,57 @@ std::string ConfigManager::MouseButtonToString(MouseButton button) const {
         case MouseButton::BUTTON_4: return "BUTTON_4";
         case MouseButton::BUTTON_5: return "BUTTON_5";
         case MouseButton::BUTTON_MIDDLE: return "BUTTON_MIDDLE";
+        case MouseButton::BUTTON_LEFT: return "LEFT";
+        case MouseButton::BUTTON_RIGHT: return "RIGHT";
         default: return "UNKNOWN";
     }
 }
 
+void ConfigManager::ParseTrigger(const std::string& str, GestureConfig& config) const {
+    config.triggerButton = MouseButton::UNKNOWN;
+    config.holdButton = MouseButton::UNKNOWN;
+    
+    // "BUTTON_4+LEFT"：按住侧键 4 时按下左键。先按住的必须是侧键或中键，
+    // 否则它的按下已经传给了应用程序；左右键单独作为触发按钮会使普通点击失效
+    const size_t plus = str.find('+');
+    if (plus == std::string::npos) {
+        MouseButton button = StringToMouseButton(str);
+        if (button != MouseButton::BUTTON_LEFT && button != MouseButton::BUTTON_RIGHT) {
+            config.triggerButton = button;
+        }
+        return;
+    }
+    
+    MouseButton hold = StringToMouseButton(str.substr(0, plus));
+    MouseButton button = StringToMouseButton(str.substr(plus + 1));
+    if ((hold == MouseButton::BUTTON_4 || hold == MouseButton::BUTTON_5 || hold == MouseButton::BUTTON_MIDDLE) &&
+        button != MouseButton::UNKNOWN && button != hold) {
+        config.holdButton = hold;
+        config.triggerButton = button;
+    }
+}
+
+bool ConfigManager::HasChord(const GestureConfig& config) const {
+    for (const auto& existing : gestureConfigs_) {
+        if (existing.holdButton == config.holdButton && existing.triggerButton == config.triggerButton) {
+            return true;
+        }
+    }
+    return false;
+}
+
 GestureType ConfigManager::StringToGestureType(const std::string& str) const {
     if (str == "SWIPE_UP") return GestureType::SWIPE_UP;
     if (str == "SWIPE_DOWN") return GestureType::SWIPE_DOWN;
     if (str == "SWIPE_LEFT") return GestureType::SWIPE_LEFT;
     if (str == "SWIPE_RIGHT") return GestureType::SWIPE_RIGHT;
+    if (str == "SWIPE_UP_LEFT") return GestureType::SWIPE_UP_LEFT;
+    if (str == "SWIPE_UP_RIGHT") return GestureType::SWIPE_UP_RIGHT;
+    if (str == "SWIPE_DOWN_LEFT") return GestureType::SWIPE_DOWN_LEFT;
+    if (str == "SWIPE_DOWN_RIGHT") return GestureType::SWIPE_DOWN_RIGHT;
     if (str == "TWO_FINGER_SCROLL") return GestureType::TWO_FINGER_SCROLL;
+    if (str == "SHAPE") return GestureType::SHAPE;
+    if (str == "SEQUENCE") return GestureType::SEQUENCE;
     return GestureType::NONE;
 }
 
@@ -169,7 +421,13 @@ std::string ConfigManager::GestureTypeToString(GestureType type) const {
         case GestureType::SWIPE_DOWN: return "SWIPE_DOWN";
         case GestureType::SWIPE_LEFT: return "SWIPE_LEFT";
         case GestureType::SWIPE_RIGHT: return "SWIPE_RIGHT";
+        case GestureType::SWIPE_UP_LEFT: return "SWIPE_UP_LEFT";
+        case GestureType::SWIPE_UP_RIGHT: return "SWIPE_UP_RIGHT";
+        case GestureType::SWIPE_DOWN_LEFT: return "SWIPE_DOWN_LEFT";
+        case GestureType::SWIPE_DOWN_RIGHT: return "SWIPE_DOWN_RIGHT";
         case GestureType::TWO_FINGER_SCROLL: return "TWO_FINGER_SCROLL";
+        case GestureType::SHAPE: return "SHAPE";
+        case GestureType::SEQUENCE: return "SEQUENCE";
         default: return "NONE";
     }
 }
@@ -180,6 +438,8 @@ ActionType ConfigManager::StringToActionType(const std::string& str) const {
     if (str == "SWITCH_DESKTOP_LEFT") return ActionType::SWITCH_DESKTOP_LEFT;
     if (str == "SWITCH_DESKTOP_RIGHT") return ActionType::SWITCH_DESKTOP_RIGHT;
     if (str == "SCROLL_SIMULATION") return ActionType::SCROLL_SIMULATION;
+    if (str == "CUSTOM_HOTKEY") return ActionType::CUSTOM_HOTKEY;
+    if (str == "MACRO") return ActionType::MACRO;
     return ActionType::NONE;
 }
 
@@ -190,6 +450,8 @@ std::string ConfigManager::ActionTypeToString(ActionType type) const {
         case ActionType::SWITCH_DESKTOP_LEFT: return "SWITCH_DESKTOP_LEFT";
         case ActionType::SWITCH_DESKTOP_RIGHT: return "SWITCH_DESKTOP_RIGHT";
         case ActionType::SCROLL_SIMULATION: return "SCROLL_SIMULATION";
+        case ActionType::CUSTOM_HOTKEY: return "CUSTOM_HOTKEY";
+        case ActionType::MACRO: return "MACRO";
         default: return "NONE";
     }
 }
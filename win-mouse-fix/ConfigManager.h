@@ -36,25 +36,37 @@ public:
     }
 
     /**
-     * @brief 添加手势配置
+     * @brief 替换全部手势配置
      */
-    void AddGestureConfig(const GestureConfig& config);
+    void SetGestureConfigs(const std::vector<GestureConfig>& configs) {
+        gestureConfigs_ = configs;
+    }
 
     /**
-     * @brief 创建默认配置
+     * @brief 释放事件阻止判定等待工作线程的最长时间（微秒，0 表示不等待）
      */
-    void CreateDefaultConfig();
+    int GetBlockDecisionTimeoutUs() const { return blockDecisionTimeoutUs_; }
+    void SetBlockDecisionTimeoutUs(int timeoutUs) { blockDecisionTimeoutUs_ = timeoutUs; }
 
-private:
     /**
-     * @brief 解析 JSON 配置
+     * @brief 最近一次加载失败的原因，或被跳过的第一条规则
      */
-    bool ParseJson(const nlohmann::json& j);
+    const std::string& GetLastError() const { return lastError_; }
 
     /**
-     * @brief 生成 JSON 配置
+     * @brief 最近一次加载中因无效而被跳过的规则数
      */
-    nlohmann::json GenerateJson() const;
+    size_t GetSkippedCount() const { return skippedCount_; }
+
+    /**
+     * @brief 添加手势配置
+     */
+    void AddGestureConfig(const GestureConfig& config);
+
+    /**
+     * @brief 创建默认配置
+     */
+    void CreateDefaultConfig();
 
     /**
      * @brief 字符串转 MouseButton
@@ -86,8 +98,45 @@ private:
      */
     std::string ActionTypeToString(ActionType type) const;
 
+    // 基准测试直接调用 ParseJson
+    friend struct BenchmarkAccess;
+
+private:
+    /**
+     * @brief 解析 JSON 配置
+     */
+    bool ParseJson(const nlohmann::json& j);
+
+    /**
+     * @brief 生成 JSON 配置
+     */
+    nlohmann::json GenerateJson() const;
+
+    /**
+     * @brief 解析 triggerButton：单个按钮，或用 + 连接的组合键（先按住的按钮在前）
+     */
+    void ParseTrigger(const std::string& str, GestureConfig& config) const;
+
+    /**
+     * @brief 已加载的规则中是否已有同样的组合键
+     */
+    bool HasChord(const GestureConfig& config) const;
+
+    /**
+     * @brief 解析规则的 sequence 数组（至少两笔，每笔为滑动方向）
+     */
+    bool ParseSequence(const nlohmann::json& item, std::vector<GestureType>& strokes) const;
+
+    /**
+     * @brief 查找形状模板：优先使用配置中 shapes 的同名笔画，否则使用内置模板
+     */
+    static bool ResolveShape(const nlohmann::json& j, const std::string& name, std::vector<Point>& points);
+
 private:
     std::vector<GestureConfig> gestureConfigs_;
+    std::string lastError_;
+    size_t skippedCount_;
+    int blockDecisionTimeoutUs_;
 };
 
 } // namespace WinMouseFix
@@ -0,0 +1,153 @@
+﻿#include "ConfigWatcher.h"
+#include "ConfigManager.h"
+#include <filesystem>
+
+namespace WinMouseFix {
+
+namespace {
+
+// 发现变化后等待文件稳定的时间
+const std::chrono::milliseconds kSettleDelay(100);
+
+double ElapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher()
+    : pollInterval_(500)
+    , lastStamp_()
+    , running_(false) {
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    Stop();
+}
+
+bool ConfigWatcher::Start(const std::string& path, ApplyCallback apply, NotifyCallback notify) {
+    if (running_) {
+        return false;
+    }
+
+    path_ = path;
+    apply_ = apply;
+    notify_ = notify;
+    lastStamp_ = ReadStamp();  // 启动时的内容已由调用方加载
+
+    running_ = true;
+    watchThread_ = std::thread(&ConfigWatcher::WatchThreadFunc, this);
+    return true;
+}
+
+void ConfigWatcher::Stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        running_ = false;
+    }
+    stopCV_.notify_one();
+
+    if (watchThread_.joinable()) {
+        watchThread_.join();
+    }
+}
+
+bool ConfigWatcher::ReloadNow() {
+    return Reload(Clock::now());
+}
+
+ConfigWatcher::ReloadResult ConfigWatcher::GetLastResult() const {
+    std::lock_guard<std::mutex> lock(resultMutex_);
+    return lastResult_;
+}
+
+ConfigWatcher::FileStamp ConfigWatcher::ReadStamp() const {
+    FileStamp stamp = {0, 0, false};
+    std::error_code ec;
+    auto writeTime = std::filesystem::last_write_time(path_, ec);
+    if (ec) {
+        return stamp;
+    }
+    auto size = std::filesystem::file_size(path_, ec);
+    if (ec) {
+        return stamp;
+    }
+
+    stamp.writeTime = static_cast<long long>(writeTime.time_since_epoch().count());
+    stamp.size = static_cast<unsigned long long>(size);
+    stamp.exists = true;
+    return stamp;
+}
+
+bool ConfigWatcher::SleepFor(std::chrono::milliseconds duration) {
+    std::unique_lock<std::mutex> lock(stopMutex_);
+    return !stopCV_.wait_for(lock, duration, [this] { return !running_; });
+}
+
+void ConfigWatcher::WatchThreadFunc() {
+    while (SleepFor(pollInterval_)) {
+        FileStamp stamp = ReadStamp();
+        if (stamp == lastStamp_ || !stamp.exists) {
+            // 保存过程中文件可能短暂不存在（先删除再重命名），等它重新出现
+            continue;
+        }
+
+        Clock::time_point detected = Clock::now();
+
+        // 等待写入结束：稳定期内仍在变化则下一轮再看
+        if (!SleepFor(kSettleDelay)) {
+            break;
+        }
+        FileStamp settled = ReadStamp();
+        if (settled != stamp) {
+            continue;
+        }
+
+        lastStamp_ = settled;
+        Reload(detected);
+    }
+}
+
+bool ConfigWatcher::Reload(Clock::time_point detected) {
+    std::lock_guard<std::mutex> reloadLock(reloadMutex_);
+
+    Clock::time_point parseStart = Clock::now();
+    ConfigManager config;
+    bool valid = config.LoadFromFile(path_);
+    if (valid && config.GetSkippedCount() > 0) {
+        // 热重载时不静默丢弃规则：保留旧配置，让用户修正
+        valid = false;
+    }
+    Clock::time_point parsed = Clock::now();
+
+    if (valid && apply_) {
+        apply_(config.GetGestureConfigs());
+    }
+    Clock::time_point applied = Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(resultMutex_);
+        lastResult_.success = valid;
+        lastResult_.error = valid ? std::string() : config.GetLastError();
+        lastResult_.configs = valid ? config.GetGestureConfigs() : std::vector<GestureConfig>();
+        lastResult_.parseMs = ElapsedMs(parseStart, parsed);
+        lastResult_.applyMs = valid ? ElapsedMs(parsed, applied) : 0.0;
+        lastResult_.totalMs = ElapsedMs(detected, applied);
+        if (valid) {
+            lastResult_.reloadCount++;
+        } else {
+            lastResult_.failureCount++;
+        }
+    }
+
+    if (notify_) {
+        notify_();
+    }
+    return valid;
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 配置文件监视器 - 文件变化后在后台线程重新解析、校验并应用配置
+ *
+ * 按固定间隔比较文件的修改时间和大小；发现变化后等文件稳定（编辑器可能分多次写入）
+ * 再解析。解析失败或有无效规则时保留当前配置，只报告错误。
+ * 应用回调在监视线程中调用，应当是无阻塞的（如 GestureRecognizer::LoadConfig）。
+ */
+class ConfigWatcher {
+public:
+    /**
+     * @brief 最近一次重新加载的结果
+     */
+    struct ReloadResult {
+        bool success;
+        std::string error;                    // 失败原因（UTF-8）
+        std::vector<GestureConfig> configs;   // 成功时为新配置
+        double parseMs;                       // 读取、解析与校验耗时
+        double applyMs;                       // 应用回调（编译并发布规则）耗时
+        double totalMs;                       // 从发现文件变化到新规则生效（含等待文件稳定）
+        uint64_t reloadCount;                 // 成功次数
+        uint64_t failureCount;                // 失败次数
+
+        ReloadResult()
+            : success(false)
+            , parseMs(0)
+            , applyMs(0)
+            , totalMs(0)
+            , reloadCount(0)
+            , failureCount(0)
+        {}
+    };
+
+    typedef std::function<void(const std::vector<GestureConfig>&)> ApplyCallback;
+    typedef std::function<void()> NotifyCallback;
+
+    ConfigWatcher();
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    /**
+     * @brief 开始监视
+     * @param apply 配置校验通过后调用
+     * @param notify 每次尝试重新加载后调用（成功或失败），可用于通知界面线程
+     */
+    bool Start(const std::string& path, ApplyCallback apply, NotifyCallback notify);
+
+    /**
+     * @brief 停止监视线程
+     */
+    void Stop();
+
+    /**
+     * @brief 立即重新加载一次（调用线程中执行）
+     */
+    bool ReloadNow();
+
+    /**
+     * @brief 获取最近一次重新加载的结果
+     */
+    ReloadResult GetLastResult() const;
+
+    /**
+     * @brief 设置轮询间隔（应在 Start 之前调用）
+     */
+    void SetPollInterval(std::chrono::milliseconds interval) { pollInterval_ = interval; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct FileStamp {
+        long long writeTime;
+        unsigned long long size;
+        bool exists;
+
+        bool operator==(const FileStamp& other) const {
+            return exists == other.exists && writeTime == other.writeTime && size == other.size;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+
+    FileStamp ReadStamp() const;
+    bool Reload(Clock::time_point detected);
+    void WatchThreadFunc();
+
+    /**
+     * @brief 可被 Stop 打断的等待，返回 false 表示已停止
+     */
+    bool SleepFor(std::chrono::milliseconds duration);
+
+    std::string path_;
+    ApplyCallback apply_;
+    NotifyCallback notify_;
+    std::chrono::milliseconds pollInterval_;
+    FileStamp lastStamp_;                // 仅监视线程访问
+
+    std::thread watchThread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCV_;
+    std::atomic<bool> running_;
+
+    std::mutex reloadMutex_;             // 串行化监视线程与 ReloadNow
+    mutable std::mutex resultMutex_;
+    ReloadResult lastResult_;
+};
+
+} // namespace WinMouseFix
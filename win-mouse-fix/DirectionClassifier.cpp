@@ -0,0 +1,72 @@
+﻿#include "DirectionClassifier.h"
+#include <algorithm>
+
+namespace WinMouseFix {
+
+namespace {
+
+const double kCos45 = 0.70710678118654752;
+
+} // namespace
+
+DirectionClassifier::DirectionClassifier() {
+    Reset(Point(0, 0));
+}
+
+void DirectionClassifier::Reset(const Point& origin) {
+    origin_ = origin;
+    last_ = origin;
+    pathLength_ = 0;
+    peakDistance_ = 0;
+    netDistance_ = 0;
+    axisScore_ = 0;
+    direction_ = GestureType::NONE;
+    stableSamples_ = 0;
+    reversed_ = false;
+}
+
+void DirectionClassifier::AddSample(const Point& position) {
+    pathLength_ += distance(last_, position);
+    last_ = position;
+
+    Point net = position - origin_;
+    netDistance_ = net.length();
+    if (netDistance_ <= 0) {
+        axisScore_ = 0;
+        direction_ = GestureType::NONE;
+        stableSamples_ = 0;
+        return;
+    }
+
+    // 主轴方向与轴向得分
+    int absDx = abs(net.x);
+    int absDy = abs(net.y);
+    GestureType direction;
+    if (absDx > absDy) {
+        direction = net.x > 0 ? GestureType::SWIPE_RIGHT : GestureType::SWIPE_LEFT;
+    } else {
+        direction = net.y > 0 ? GestureType::SWIPE_DOWN : GestureType::SWIPE_UP;
+    }
+    double cosAngle = std::max(absDx, absDy) / netDistance_;
+    axisScore_ = std::max(0.0, (cosAngle - kCos45) / (1.0 - kCos45));
+
+    stableSamples_ = (direction == direction_) ? stableSamples_ + 1 : 1;
+    direction_ = direction;
+
+    // 反向：离开起点一段距离后又退回一半以上
+    peakDistance_ = std::max(peakDistance_, netDistance_);
+    if (peakDistance_ >= kReversalMinDistance && netDistance_ < peakDistance_ * 0.5) {
+        reversed_ = true;
+    }
+}
+
+double DirectionClassifier::GetConfidence() const {
+    if (direction_ == GestureType::NONE || pathLength_ <= 0) {
+        return 0.0;
+    }
+    double straightness = netDistance_ / pathLength_;
+    double stability = std::min(1.0, static_cast<double>(stableSamples_) / kStableSamples);
+    return axisScore_ * straightness * stability;
+}
+
+} // namespace WinMouseFix
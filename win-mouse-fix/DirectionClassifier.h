@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 预测式方向分类器 - 根据最初的几个采样估计滑动方向并给出置信度
+ *
+ * 置信度 = 轴向得分 x 路径平直度 x 方向稳定度，均在 [0, 1] 内：
+ *   轴向得分：位移与最近坐标轴的夹角，0 度为 1，45 度（对角线）为 0
+ *   平直度：  净位移 / 累计路径长度，来回晃动时下降
+ *   稳定度：  方向估计连续不变的采样数 / kStableSamples
+ * 净位移离开起点后又退回一半以上视为反向，反向之后本次手势不再提交。
+ */
+class DirectionClassifier {
+public:
+    // 方向估计连续不变多少个采样后稳定度为 1
+    static const int kStableSamples = 3;
+    // 净位移至少达到这么远之后才检测反向（像素），过滤按下时的抖动
+    static const int kReversalMinDistance = 10;
+    // 阈值后备触发所要求的最低轴向得分（约 38 度以内），过滤对角线误触发
+    static constexpr double kDiagonalGuard = 0.25;
+
+    DirectionClassifier();
+
+    /**
+     * @brief 以按下位置开始新的手势
+     */
+    void Reset(const Point& origin);
+
+    /**
+     * @brief 添加一个移动采样
+     */
+    void AddSample(const Point& position);
+
+    /**
+     * @brief 当前方向估计（尚无位移时为 NONE）
+     */
+    GestureType GetDirection() const { return direction_; }
+
+    /**
+     * @brief 当前置信度
+     */
+    double GetConfidence() const;
+
+    /**
+     * @brief 轴向得分
+     */
+    double GetAxisScore() const { return axisScore_; }
+
+    /**
+     * @brief 是否已经反向（反向后不应再提交手势）
+     */
+    bool IsReversed() const { return reversed_; }
+
+private:
+    Point origin_;
+    Point last_;
+    double pathLength_;
+    double peakDistance_;
+    double netDistance_;
+    double axisScore_;
+    GestureType direction_;
+    int stableSamples_;
+    bool reversed_;
+};
+
+} // namespace WinMouseFix
@@ -0,0 +1,59 @@
+﻿#include "DragRepeater.h"
+#include "SectorClassifier.h"
+#include <cmath>
+
+namespace WinMouseFix {
+
+DragRepeater::DragRepeater()
+    : origin_(0, 0)
+    , axis_(0, 0)
+    , invNorm_(0)
+    , step_(0)
+    , intervalUs_(0)
+    , lastFireUs_(0)
+    , count_(0) {
+}
+
+void DragRepeater::Reset() {
+    step_ = 0;
+    count_ = 0;
+}
+
+void DragRepeater::Arm(const Point& origin, GestureType direction, int step, int intervalMs, int64_t timeUs) {
+    axis_ = SectorClassifier::Axis(direction);
+    if (step <= 0 || (axis_.x == 0 && axis_.y == 0)) {
+        Reset();
+        return;
+    }
+    origin_ = origin;
+    invNorm_ = 1.0 / sqrt(static_cast<double>(axis_.x * axis_.x + axis_.y * axis_.y));
+    step_ = step;
+    intervalUs_ = static_cast<int64_t>(intervalMs > 0 ? intervalMs : 0) * 1000;
+    lastFireUs_ = timeUs;
+    count_ = 0;
+}
+
+DragRepeater::Step DragRepeater::AddSample(const Point& position, int64_t timeUs) {
+    if (step_ <= 0) {
+        return STEP_NONE;
+    }
+
+    Point delta = position - origin_;
+    double along = (delta.x * axis_.x + delta.y * axis_.y) * invNorm_;
+    Step result = STEP_NONE;
+    if (along >= static_cast<double>(count_ + 1) * step_) {
+        result = STEP_FORWARD;
+    } else if (along <= static_cast<double>(count_ - 1) * step_) {
+        result = STEP_REVERSE;
+    }
+
+    // 限速：距上次执行不足间隔时本次不执行，步数保留
+    if (result == STEP_NONE || timeUs - lastFireUs_ < intervalUs_) {
+        return STEP_NONE;
+    }
+    count_ += (result == STEP_FORWARD) ? 1 : -1;
+    lastFireUs_ = timeUs;
+    return result;
+}
+
+} // namespace WinMouseFix
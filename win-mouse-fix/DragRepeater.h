@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 拖动连发 - 手势触发后按沿触发方向的移动距离决定何时再次执行动作
+ *
+ * 以触发点为原点，把位移投影到触发方向上：每比上次执行处多走一步执行一次正向动作，
+ * 往回退一步执行一次反向动作（两侧各留一步，来回抖动不会反复触发）。
+ * 两次执行之间至少间隔 intervalMs，未到间隔的步数留到后续采样再执行。
+ */
+class DragRepeater {
+public:
+    enum Step {
+        STEP_NONE,
+        STEP_FORWARD,
+        STEP_REVERSE,
+    };
+
+    DragRepeater();
+
+    /**
+     * @brief 停止连发
+     */
+    void Reset();
+
+    /**
+     * @brief 手势触发时开始连发
+     * @param direction  触发的滑动方向
+     * @param step       每次执行的移动距离（像素）
+     * @param intervalMs 两次执行的最小间隔（毫秒）
+     */
+    void Arm(const Point& origin, GestureType direction, int step, int intervalMs, int64_t timeUs);
+
+    bool IsArmed() const { return step_ > 0; }
+
+    /**
+     * @brief 添加一个移动采样，返回本次应执行的动作（每个采样最多一次）
+     */
+    Step AddSample(const Point& position, int64_t timeUs);
+
+    /**
+     * @brief 正向减反向的净执行次数（不含触发本身）
+     */
+    int GetCount() const { return count_; }
+
+private:
+    Point origin_;
+    Point axis_;            // 方向轴，分量为 -1/0/1
+    double invNorm_;        // 方向轴长度的倒数
+    int step_;              // 0 表示未启用
+    int64_t intervalUs_;
+    int64_t lastFireUs_;
+    int count_;
+};
+
+} // namespace WinMouseFix
@@ -0,0 +1,64 @@
+﻿#include "FlickDetector.h"
+
+namespace WinMouseFix {
+
+FlickDetector::FlickDetector()
+    : samples_()
+    , head_(0)
+    , count_(0) {
+}
+
+void FlickDetector::Reset(const Point& position, int64_t timeUs) {
+    head_ = 0;
+    count_ = 0;
+    AddSample(position, timeUs);
+}
+
+void FlickDetector::AddSample(const Point& position, int64_t timeUs) {
+    if (count_ > 0 && timeUs <= Latest(0).timeUs) {
+        // 同一时刻的多个采样（或乱序）无法计算速度，只更新位置
+        samples_[(head_ + kCapacity - 1) % kCapacity].position = position;
+        return;
+    }
+
+    samples_[head_] = {position, timeUs};
+    head_ = (head_ + 1) % kCapacity;
+    if (count_ < kCapacity) {
+        ++count_;
+    }
+}
+
+FlickDetector::Velocity FlickDetector::Between(const Sample& from, const Sample& to) {
+    Velocity v;
+    double dt = static_cast<double>(to.timeUs - from.timeUs) / 1e6;
+    if (dt <= 0) {
+        return v;
+    }
+    v.vx = (to.position.x - from.position.x) / dt;
+    v.vy = (to.position.y - from.position.y) / dt;
+    v.speed = sqrt(v.vx * v.vx + v.vy * v.vy);
+    return v;
+}
+
+FlickDetector::Velocity FlickDetector::GetInstantVelocity() const {
+    if (count_ < 2) {
+        return Velocity();
+    }
+    return Between(Latest(1), Latest(0));
+}
+
+FlickDetector::Velocity FlickDetector::GetWindowVelocity() const {
+    if (count_ < 2) {
+        return Velocity();
+    }
+
+    // 找到窗口内最早的采样
+    const Sample& latest = Latest(0);
+    size_t oldest = 1;
+    while (oldest + 1 < count_ && latest.timeUs - Latest(oldest + 1).timeUs <= kWindowUs) {
+        ++oldest;
+    }
+    return Between(Latest(oldest), latest);
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include "Common.h"
+#include <array>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 快速轻扫（flick）检测 - 记录带时间戳的移动采样并计算速度
+ *
+ * 采样保存在定长环形缓冲区中，不分配内存。时间为事件发生时的 MonotonicMicros()，
+ * 因此速度不受工作线程排队延迟的影响。
+ */
+class FlickDetector {
+public:
+    /**
+     * @brief 速度（像素/秒）
+     */
+    struct Velocity {
+        double vx;
+        double vy;
+        double speed;
+
+        Velocity() : vx(0), vy(0), speed(0) {}
+    };
+
+    // 计算窗口速度的时间窗口
+    static const int64_t kWindowUs = 40000;
+
+    FlickDetector();
+
+    /**
+     * @brief 以按下位置和时间开始新的手势
+     */
+    void Reset(const Point& position, int64_t timeUs);
+
+    /**
+     * @brief 添加一个移动采样（时间不晚于上一个采样的会被忽略）
+     */
+    void AddSample(const Point& position, int64_t timeUs);
+
+    /**
+     * @brief 最近两个采样之间的瞬时速度
+     */
+    Velocity GetInstantVelocity() const;
+
+    /**
+     * @brief 最近 kWindowUs 内的平均速度（窗口内不足两个采样时退化为瞬时速度）
+     */
+    Velocity GetWindowVelocity() const;
+
+    /**
+     * @brief 最近一个采样的时间（没有采样时为 0）
+     */
+    int64_t GetLatestTime() const { return count_ > 0 ? Latest(0).timeUs : 0; }
+
+private:
+    struct Sample {
+        Point position;
+        int64_t timeUs;
+    };
+
+    static const size_t kCapacity = 16;
+
+    static Velocity Between(const Sample& from, const Sample& to);
+
+    const Sample& Latest(size_t back) const {
+        return samples_[(head_ + kCapacity - 1 - back) % kCapacity];
+    }
+
+    std::array<Sample, kCapacity> samples_;
+    size_t head_;    // 下一个写入位置
+    size_t count_;
+};
+
+} // namespace WinMouseFix
@@ -1,17 +1,62 @@
 ﻿#include "GestureRecognizer.h"
-#include "WindowsActions.h"
+#include "ActionSink.h"
+#include "LatencyTrace.h"
 #include <iostream>
 #include <cmath>
 
 namespace WinMouseFix {
 
-GestureRecognizer::GestureRecognizer(WindowsActions* actions)
-    : actions_(actions)
+GestureRecognizer::GestureRecognizer(ActionSink* actions)
+    : nextSequence_(0)
+    , hookActiveButton_(MouseButton::UNKNOWN)
+    , hookChordButton_(MouseButton::UNKNOWN)
+    , hookChordHolders_(0)
+    , hookButtonWord_(0)
+    , buttonResync_(false)
+    , buttonResyncs_(0)
+    , resyncPending_(false)
+    , resyncSequence_(0)
+    , resyncMask_(0)
+    , resyncDone_(0)
+    , moveOverflowPolicy_(MoveOverflowPolicy::COALESCE)
+    , pendingMove_()
+    , hasPendingMove_(false)
+    , hookHandedOff_(false)
+    , handoffState_(kHandoffEmpty)
+    , handoffMove_()
+    , takenMove_()
+    , hasTakenMove_(false)
+    , movesCoalesced_(0)
+    , coalescedRecords_(0)
+    , workerWaiting_(false)
     , running_(true)
+    , publishedState_(static_cast<uint64_t>(MouseButton::UNKNOWN))
+    , blockDecisionTimeout_(0)
+    , frameIntervalUs_(kDefaultFrameIntervalUs)
+    , liveEventTimes_(true)
+    , staleBlockDecisions_(0)
+    , latencySamples_(0)
+    , latencySumUs_(0)
+    , latencyMaxUs_(0)
+    , scrollSamples_(0)
+    , scrollFlushes_(0)
+    , scrollMessages_(0)
+    , actions_(actions)
+    , table_(std::unique_ptr<GestureTable>(new GestureTable()))
     , activeButton_(MouseButton::UNKNOWN)
+    , activeTrigger_(GestureTable::kNoTrigger)
+    , chordHolder_(MouseButton::UNKNOWN)
     , gestureTriggered_(false)
+    , gestureCancelled_(false)
+    , sequenceNode_(SequenceTrie::kRoot)
+    , strokeCapture_(false)
     , currentGesture_(GestureType::NONE)
-    , scrollMode_(false) {
+    , lastDirection_(GestureType::NONE)
+    , scrollMode_(false)
+    , momentumTrigger_(GestureTable::kNoTrigger)
+    , nextFrameUs_(0)
+    , scrollFlushArmed_(false)
+    , scrollFlushUs_(0) {
     
     // 启动处理线程
     processingThread_ = std::thread(&GestureRecognizer::ProcessingThreadFunc, this);
@@ -20,7 +65,10 @@ GestureRecognizer::GestureRecognizer(WindowsActions* actions)
 GestureRecognizer::~GestureRecognizer() {
     // 停止处理线程
     running_ = false;
-    queueCV_.notify_one();
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCV_.notify_one();
+    }
     
     if (processingThread_.joinable()) {
         processingThread_.join();
@@ -28,225 +76,810 @@ GestureRecognizer::~GestureRecognizer() {
 }
 
 void GestureRecognizer::LoadConfig(const std::vector<GestureConfig>& configs) {
-    configs_ = configs;
+    std::unique_ptr<GestureTable> table(new GestureTable());
+    table->Compile(configs);
+    table_.Publish(std::move(table));
+}
+
+GestureRecognizer::QueueStats GestureRecognizer::GetQueueStats() const {
+    QueueStats stats;
+    stats.buttonDrops = buttonLane_.GetDrops();
+    stats.buttonResyncs = buttonResyncs_.load(std::memory_order_relaxed);
+    stats.buttonHighWater = buttonLane_.GetHighWater();
+    stats.moveDrops = moveLane_.GetDrops();
+    stats.moveHighWater = moveLane_.GetHighWater();
+    stats.movesCoalesced = movesCoalesced_.load(std::memory_order_relaxed);
+    stats.coalescedRecords = coalescedRecords_.load(std::memory_order_relaxed);
+    stats.staleBlockDecisions = staleBlockDecisions_.load(std::memory_order_relaxed);
+    stats.latencySamples = latencySamples_.load(std::memory_order_relaxed);
+    stats.meanQueueLatencyUs = stats.latencySamples > 0
+        ? static_cast<double>(latencySumUs_.load(std::memory_order_relaxed)) / stats.latencySamples
+        : 0.0;
+    stats.maxQueueLatencyUs = latencyMaxUs_.load(std::memory_order_relaxed);
+    stats.scrollSamples = scrollSamples_.load(std::memory_order_relaxed);
+    stats.scrollFlushes = scrollFlushes_.load(std::memory_order_relaxed);
+    stats.scrollMessages = scrollMessages_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void GestureRecognizer::RecordQueueLatency(int64_t latencyUs) {
+    // 单一写者：普通的读-改-写即可，读者只需要近似一致的快照
+    latencySamples_.store(latencySamples_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    latencySumUs_.store(latencySumUs_.load(std::memory_order_relaxed) + latencyUs, std::memory_order_relaxed);
+    if (latencyUs > latencyMaxUs_.load(std::memory_order_relaxed)) {
+        latencyMaxUs_.store(latencyUs, std::memory_order_relaxed);
+    }
+}
+
+void GestureRecognizer::PublishState(uint64_t processedSequence) {
+    uint64_t state = static_cast<uint64_t>(activeButton_) & kStateButtonMask;
+    if (gestureTriggered_) state |= kStateTriggered;
+    if (scrollMode_) state |= kStateScrollMode;
+    if (strokeCapture_) state |= kStateStrokeCapture;
+    if (momentum_.IsActive()) state |= kStateMomentum;
+    state |= processedSequence << kStateSequenceShift;
+    publishedState_.store(state, std::memory_order_release);
+}
+
+uint64_t GestureRecognizer::LoadStateAtLeast(uint64_t target) {
+    uint64_t state = publishedState_.load(std::memory_order_acquire);
+    if (StateSequence(state) >= target || blockDecisionTimeout_.count() <= 0) {
+        return state;
+    }
+
+    // 工作线程落后：有界等待，超时后按最新发布的状态判定
+    const auto deadline = std::chrono::steady_clock::now() + blockDecisionTimeout_;
+    do {
+        std::this_thread::yield();
+        state = publishedState_.load(std::memory_order_acquire);
+        if (StateSequence(state) >= target) {
+            return state;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    
+    staleBlockDecisions_.fetch_add(1, std::memory_order_relaxed);
+    return state;
 }
 
 void GestureRecognizer::ProcessingThreadFunc() {
     while (running_) {
-        MouseEvent event;
+        // 定时任务（惯性滚动帧、批量滚动输出）：事件持续到达时也不延后
+        if (NextTimerDeadline() != INT64_MAX) {
+            int64_t now = MonotonicMicros();
+            if (now >= NextTimerDeadline()) {
+                RunTimers(now);
+                table_.Quiesce(kWorkerReader);
+            }
+        }
         
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCV_.wait(lock, [this] { return !eventQueue_.empty() || !running_; });
-            
-            if (!running_) break;
-            
-            if (eventQueue_.empty()) continue;
-            
-            event = eventQueue_.front();
-            eventQueue_.pop();
+        // 按钮通道满时丢失了按钮事件：取得丢失时钩子线程的按钮状态，处理完之前入队的事件后补齐
+        if (!resyncPending_ && buttonResync_.exchange(false, std::memory_order_acquire)) {
+            const uint64_t word = hookButtonWord_.load(std::memory_order_acquire);
+            resyncSequence_ = word >> kButtonWordShift;
+            resyncMask_ = static_cast<uint32_t>(word & ((1u << kButtonWordShift) - 1));
+            resyncPending_ = resyncSequence_ >= resyncDone_;
         }
         
-        ProcessEvent(event);
+        MouseEvent event;
+        if (PopNextEvent(event, resyncPending_ ? resyncSequence_ : UINT64_MAX)) {
+            if (LatencyOrigin(event.timeUs) > 0) {
+                RecordQueueLatency(MonotonicMicros() - event.timeUs);
+                WMF_LATENCY_RECORD(QUEUE_WAIT, event.timeUs * 1000, WMF_LATENCY_NOW());
+            }
+            ProcessEvent(event);
+            PublishState(event.sequence + 1);
+            table_.Quiesce(kWorkerReader);
+            continue;
+        }
+        if (resyncPending_) {
+            ResyncButtons(resyncMask_, MonotonicMicros());
+            resyncPending_ = false;
+            resyncDone_ = resyncSequence_ + 1;
+            buttonResyncs_.fetch_add(1, std::memory_order_relaxed);
+            PublishState(resyncDone_);
+            table_.Quiesce(kWorkerReader);
+            continue;
+        }
+        
+        // 队列为空：先声明即将休眠，再复查一次，避免丢失唤醒
+        table_.Offline(kWorkerReader);
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        workerWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto hasWork = [this] {
+            return !buttonLane_.Empty() || !moveLane_.Empty() ||
+                   handoffState_.load(std::memory_order_relaxed) == kHandoffFull ||
+                   buttonResync_.load(std::memory_order_relaxed) || !running_;
+        };
+        const int64_t deadline = NextTimerDeadline();
+        if (deadline != INT64_MAX) {
+            // 有定时任务时按时醒来（惯性滚动每帧一次），空闲时无限等待
+            wakeCV_.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(deadline)),
+                               hasWork);
+        } else {
+            wakeCV_.wait(lock, hasWork);
+        }
+        workerWaiting_.store(false, std::memory_order_relaxed);
+        table_.Online(kWorkerReader);
+    }
+}
+
+bool GestureRecognizer::PopNextEvent(MouseEvent& event, uint64_t limit) {
+    const MouseEvent* button = buttonLane_.Front();
+    const MouseEvent* move = moveLane_.Front();
+    
+    // 某条通道看起来为空时再查一次：另一条通道的 acquire 保证了
+    // 序号更小的事件此时一定可见
+    if (button && !move) {
+        move = moveLane_.Front();
+    } else if (move && !button) {
+        button = buttonLane_.Front();
+    }
+    
+    // 两条通道看起来都空时取走交接槽中的合并记录。交出记录后钩子线程的下一个事件会先尝试收回它，
+    // 所以之后入队的事件序号都更大；取走之前入队的事件要再查一次两条通道
+    if (!button && !move && !hasTakenMove_) {
+        int expected = kHandoffFull;
+        if (handoffState_.load(std::memory_order_relaxed) == kHandoffFull &&
+            handoffState_.compare_exchange_strong(expected, kHandoffTaken, std::memory_order_acquire)) {
+            takenMove_ = handoffMove_;
+            hasTakenMove_ = true;
+            handoffState_.store(kHandoffEmpty, std::memory_order_release);
+            button = buttonLane_.Front();
+            move = moveLane_.Front();
+        }
+    }
+    
+    // 按序号取最小的一个；序号不小于 limit 的事件留到补齐按钮状态之后
+    const MouseEvent* next = hasTakenMove_ ? &takenMove_ : nullptr;
+    if (button && (!next || button->sequence < next->sequence)) {
+        next = button;
+    }
+    if (move && (!next || move->sequence < next->sequence)) {
+        next = move;
+    }
+    if (!next || next->sequence >= limit) {
+        return false;
+    }
+    
+    event = *next;
+    if (next == button) {
+        buttonLane_.Pop();
+    } else if (next == move) {
+        moveLane_.Pop();
+    } else {
+        hasTakenMove_ = false;
+    }
+    return true;
+}
+
+void GestureRecognizer::ResyncButtons(uint32_t hookMask, int64_t timeUs) {
+    // 先补释放再补按下：丢失的释放结束进行中的手势，激活按钮不会一直卡住
+    for (int i = 0; i < ButtonState::kButtonCount; ++i) {
+        const MouseButton button = static_cast<MouseButton>(i);
+        if (buttonState_.IsPressed(button) && (hookMask & ButtonState::Bit(button)) == 0) {
+            ProcessButtonUp(button, lastMousePos_, timeUs);
+        }
+    }
+    for (int i = 0; i < ButtonState::kButtonCount; ++i) {
+        const MouseButton button = static_cast<MouseButton>(i);
+        if (!buttonState_.IsPressed(button) && (hookMask & ButtonState::Bit(button)) != 0) {
+            ProcessButtonDown(button, lastMousePos_, timeUs);
+        }
+    }
+}
+
+void GestureRecognizer::NotifyWorker() {
+    // 与工作线程中的栅栏配对：要么工作线程看到新事件，要么这里看到它在休眠
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (workerWaiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCV_.notify_one();
     }
 }
 
 void GestureRecognizer::ProcessEvent(const MouseEvent& event) {
     switch (event.type) {
         case MouseEvent::BUTTON_DOWN:
-            ProcessButtonDown(event.button, event.position);
+            ProcessButtonDown(event.button, event.position, event.timeUs);
             break;
         case MouseEvent::BUTTON_UP:
-            ProcessButtonUp(event.button, event.position);
+            ProcessButtonUp(event.button, event.position, event.timeUs);
             break;
         case MouseEvent::MOUSE_MOVE:
-            ProcessMouseMove(event.position);
+            ProcessMouseMove(event.position, event.delta, event.timeUs);
             break;
     }
 }
 
-bool GestureRecognizer::OnButtonDown(MouseButton button, const Point& position) {
-    // 快速入队
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        eventQueue_.push({MouseEvent::BUTTON_DOWN, button, position});
+bool GestureRecognizer::OnInputEvent(const InputEvent& event) {
+    switch (event.type) {
+        case InputEvent::BUTTON_DOWN:
+            return OnButtonDown(event.button, event.position, event.hookTimeUs);
+        case InputEvent::BUTTON_UP:
+            return OnButtonUp(event.button, event.position, event.hookTimeUs);
+        case InputEvent::MOVE:
+            return OnMouseMove(event.position, event.hookTimeUs);
     }
-    queueCV_.notify_one();
-    
-    // 如果有配置，阻止默认行为
-    return HasConfigForButton(button);
+    return false;
 }
 
-void GestureRecognizer::ProcessButtonDown(MouseButton button, const Point& position) {
-    buttonState_.SetPressed(button, position);
+void GestureRecognizer::WaitForIdle() {
+    FlushPendingMove(true);
     
-    // 检查是否有对应的手势配置
-    bool hasConfig = false;
-    for (const auto& config : configs_) {
-        if (config.triggerButton == button) {
-            hasConfig = true;
-            break;
-        }
+    const uint64_t target = nextSequence_;
+    while (StateSequence(publishedState_.load(std::memory_order_acquire)) < target) {
+        std::this_thread::yield();
     }
+}
+
+void GestureRecognizer::WaitForQueueSpace() {
+    // 留出两个槽位：合并记录和按钮事件本身
+    while (buttonLane_.Size() + 2 > kButtonLaneCapacity) {
+        std::this_thread::yield();
+    }
+}
+
+bool GestureRecognizer::OnButtonDown(MouseButton button, const Point& position, int64_t timeUs) {
+    timeUs = EventTime(timeUs);
     
+    // 之前合并的移动必须先于按钮事件送达
+    FlushPendingMove(true);
+    lastHookPos_ = position;
+    hookButtons_.SetPressed(button, position, timeUs);
+    
+    EnqueueButtonEvent(MouseEvent::BUTTON_DOWN, button, position, timeUs);
+    
+    // 如果有配置，阻止默认行为；移动是否入队由钩子线程自己决定，
+    // 不等工作线程处理完按下事件，否则按下后紧跟的移动会被漏掉
+    const GestureTable& table = *table_.Get();
+    const int chord = table.FindChord(hookButtons_.GetPressedMask(), button);
+    bool hasConfig = chord != GestureTable::kNoTrigger || table.HasButton(button);
+    if (chord != GestureTable::kNoTrigger) {
+        // 组合键：第二个按钮的按下和释放都被阻止，先按住的按钮释放时也不再产生默认行为
+        hookChordButton_ = button;
+        hookChordHolders_ |= ButtonState::Bit(table.GetChordHolder(chord));
+    }
+    table_.Quiesce(kHookReader);
     if (hasConfig) {
+        hookActiveButton_ = button;
+    }
+    return hasConfig;
+}
+
+void GestureRecognizer::ProcessButtonDown(MouseButton button, const Point& position, int64_t timeUs) {
+    buttonState_.SetPressed(button, position, timeUs);
+    
+    // 按下任何按钮都立即停止惯性滚动，已累积的滚动量先送出
+    momentum_.Stop();
+    FlushScroll();
+    
+    // 检查是否有对应的手势配置：按住组合键的第一个按钮时按下第二个按钮，
+    // 第一个按钮上进行中的手势到此结束，从第二个按钮按下处按组合键的规则重新识别
+    const GestureTable& table = *table_.Get();
+    int trigger = table.FindChord(buttonState_.GetPressedMask(), button);
+    if (trigger == GestureTable::kNoTrigger && table.HasButton(button)) {
+        trigger = GestureTable::ButtonTrigger(button);
+    }
+    
+    if (trigger != GestureTable::kNoTrigger) {
         activeButton_ = button;
+        activeTrigger_ = trigger;
+        chordHolder_ = table.GetChordHolder(trigger);
         gestureStartPos_ = position;
         lastMousePos_ = position;
         gestureTriggered_ = false;
         currentGesture_ = GestureType::NONE;
+        lastDirection_ = GestureType::NONE;
         scrollMode_ = false;
-        scrollAccumulator_ = Point(0, 0);
+        scrollEngine_.Reset(timeUs);
+        gestureCancelled_ = false;
+        flick_.Reset(position, timeUs);
+        classifier_.Reset(position);
+        repeater_.Reset();
+        stroke_.Reset(position);
+        segmenter_.Reset(position);
+        sequenceNode_ = SequenceTrie::kRoot;
+        strokeCapture_ = false;
     }
 }
 
-bool GestureRecognizer::OnButtonUp(MouseButton button, const Point& position) {
-    // 检查这个按钮是否触发了手势
+bool GestureRecognizer::OnButtonUp(MouseButton button, const Point& position, int64_t timeUs) {
+    timeUs = EventTime(timeUs);
+    
+    // 之前合并的移动必须先于按钮事件送达，否则释放前的位移会丢失
+    FlushPendingMove(true);
+    
+    hookButtons_.SetReleased(button, timeUs);
+    
+    // 检查这个按钮是否触发了手势：状态字包含释放之前入队的所有事件时判定才准确。
+    // 不是钩子线程视角的激活按钮（左右键、未配置的按钮）时不可能触发过手势，无需等待
     bool hadGesture = false;
-    if (button == activeButton_ && (gestureTriggered_ || scrollMode_)) {
+    const uint32_t bit = ButtonState::Bit(button);
+    if (button == hookChordButton_ || (hookChordHolders_ & bit) != 0) {
+        // 组合键的按钮：按下时已被阻止（或参与过组合键），释放一并阻止
         hadGesture = true;
+        hookChordHolders_ &= ~bit;
+        if (button == hookChordButton_) {
+            hookChordButton_ = MouseButton::UNKNOWN;
+        }
+    } else if (button == hookActiveButton_) {
+        uint64_t state = LoadStateAtLeast(nextSequence_);
+        hadGesture = StateButton(state) == button &&
+                     (state & (kStateTriggered | kStateScrollMode | kStateStrokeCapture)) != 0;
     }
     
-    // 快速入队
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        eventQueue_.push({MouseEvent::BUTTON_UP, button, position});
+    EnqueueButtonEvent(MouseEvent::BUTTON_UP, button, position, timeUs);
+    if (button == hookActiveButton_) {
+        hookActiveButton_ = MouseButton::UNKNOWN;
     }
-    queueCV_.notify_one();
+    table_.Quiesce(kHookReader);
     
     // 如果触发了手势，阻止默认行为
     return hadGesture;
 }
 
-void GestureRecognizer::ProcessButtonUp(MouseButton button, const Point& position) {
+void GestureRecognizer::ProcessButtonUp(MouseButton button, const Point& position, int64_t timeUs) {
     // 在工作线程中处理
-    buttonState_.SetReleased(button);
+    buttonState_.SetReleased(button, timeUs);
     
-    if (button == activeButton_) {
+    // 组合键中任一按钮释放都结束组合键手势
+    if (button == activeButton_ || (button == chordHolder_ && activeButton_ != MouseButton::UNKNOWN)) {
+        // 形状/序列按钮的一次性手势在释放时识别
+        if (strokeCapture_ && !gestureTriggered_) {
+            const GestureConfig* cfg = RecognizeStroke(*table_.Get(), position);
+            if (cfg) {
+                ExecuteGesture(*cfg, position - gestureStartPos_, timeUs);
+            }
+        }
+        
+        if (scrollMode_) {
+            // 没有惯性时滚动到此结束，不必等到下一个输出时刻
+            StartMomentum(*table_.Get(), timeUs);
+            if (!momentum_.IsActive()) {
+                FlushScroll();
+            }
+        }
+        
         activeButton_ = MouseButton::UNKNOWN;
+        activeTrigger_ = GestureTable::kNoTrigger;
+        chordHolder_ = MouseButton::UNKNOWN;
         gestureTriggered_ = false;
         currentGesture_ = GestureType::NONE;
         scrollMode_ = false;
+        strokeCapture_ = false;
+        repeater_.Reset();
     }
 }
 
-bool GestureRecognizer::OnMouseMove(const Point& currentPos) {
-    // 只有在有活动按钮时才入队
-    if (activeButton_ != MouseButton::UNKNOWN) {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        
-        // 如果队列太长，跳过（避免事件堆积）
-        if (eventQueue_.size() < 10) {
-            eventQueue_.push({MouseEvent::MOUSE_MOVE, MouseButton::UNKNOWN, currentPos});
-            queueCV_.notify_one();
+bool GestureRecognizer::OnMouseMove(const Point& currentPos, int64_t timeUs) {
+    // 只有在有活动按钮或惯性滚动时才入队（惯性滚动中反向移动会取消惯性）
+    if (hookActiveButton_ != MouseButton::UNKNOWN ||
+        (publishedState_.load(std::memory_order_relaxed) & kStateMomentum) != 0) {
+        timeUs = EventTime(timeUs);
+        ReclaimHandoff();
+        if (hasPendingMove_) {
+            // 并入尚未送出的合并记录
+            pendingMove_.position = currentPos;
+            pendingMove_.delta = pendingMove_.delta + (currentPos - lastHookPos_);
+            pendingMove_.sampleCount++;
+            pendingMove_.timeUs = timeUs;
+        } else {
+            pendingMove_ = {MouseEvent::MOUSE_MOVE, MouseButton::UNKNOWN, currentPos, 0,
+                            currentPos - lastHookPos_, 1, timeUs};
+            hasPendingMove_ = true;
         }
+        lastHookPos_ = currentPos;
+        
+        FlushPendingMove(false);
     }
     
     return false;
 }
 
-void GestureRecognizer::ProcessMouseMove(const Point& currentPos) {
+void GestureRecognizer::EnqueueButtonEvent(MouseEvent::Type type, MouseButton button, const Point& position, int64_t timeUs) {
+    // 快速入队（无锁、无分配）
+    if (!buttonLane_.TryPush({type, button, position, nextSequence_, Point(), 0, timeUs})) {
+        // 通道已满（工作线程长时间停顿）：事件丢失，发布此刻的按钮状态，由工作线程补齐。
+        // 丢失的事件仍占用一个序号，等待空闲和释放判定照常以序号为准
+        hookButtonWord_.store(hookButtons_.GetPressedMask() | (nextSequence_ << kButtonWordShift),
+                              std::memory_order_release);
+        buttonResync_.store(true, std::memory_order_release);
+    }
+    nextSequence_++;
+    NotifyWorker();
+}
+
+void GestureRecognizer::ReclaimHandoff() {
+    if (!hookHandedOff_) {
+        return;
+    }
+    hookHandedOff_ = false;
+    
+    // 工作线程还没取走：收回继续合并，交出时占用的序号作废；已被取走时从新的记录开始累计
+    int expected = kHandoffFull;
+    if (handoffState_.compare_exchange_strong(expected, kHandoffEmpty, std::memory_order_relaxed)) {
+        pendingMove_ = handoffMove_;
+        hasPendingMove_ = true;
+    }
+}
+
+void GestureRecognizer::FlushPendingMove(bool mustDeliver) {
+    ReclaimHandoff();
+    if (!hasPendingMove_) {
+        return;
+    }
+    
+    pendingMove_.sequence = nextSequence_;
+    bool queued = moveLane_.TryPush(pendingMove_);
+    if (!queued && mustDeliver) {
+        // 按钮通道不丢弃，用它保证位移不早于按钮事件丢失
+        queued = buttonLane_.TryPush(pendingMove_);
+    }
+    
+    if (queued) {
+        nextSequence_++;
+        if (pendingMove_.sampleCount > 1) {
+            coalescedRecords_.fetch_add(1, std::memory_order_relaxed);
+        }
+        hasPendingMove_ = false;
+        NotifyWorker();
+    } else if (moveOverflowPolicy_ == MoveOverflowPolicy::COALESCE) {
+        // 队列已满：记录交给工作线程，停止移动时它也能取到最后的位移；
+        // 工作线程正在取上一条记录时先留在手里，下一个采样再交
+        movesCoalesced_.fetch_add(1, std::memory_order_relaxed);
+        if (handoffState_.load(std::memory_order_acquire) == kHandoffEmpty) {
+            handoffMove_ = pendingMove_;
+            nextSequence_++;
+            hasPendingMove_ = false;
+            hookHandedOff_ = true;
+            handoffState_.store(kHandoffFull, std::memory_order_release);
+            NotifyWorker();
+        }
+    } else {
+        // 丢弃策略：位移从下一个入队的采样开始重新累计
+        hasPendingMove_ = false;
+    }
+}
+
+void GestureRecognizer::ProcessMouseMove(const Point& currentPos, const Point& moveDelta, int64_t timeUs) {
     if (activeButton_ == MouseButton::UNKNOWN) {
+        // 惯性滚动中反向移动鼠标立即停止
+        if (momentum_.IsActive() && momentum_.IsOpposite(moveDelta)) {
+            momentum_.Stop();
+            FlushScroll();
+        }
         return;
     }
     
+    // moveDelta 由钩子线程计算，包含被合并的所有采样的位移
+    // 阈值比较用整数距离平方，普通滑动规则每个采样没有浮点运算
     Point delta = currentPos - gestureStartPos_;
-    double dist = delta.length();
-    Point moveDelta = currentPos - lastMousePos_;
+    int64_t dist2 = static_cast<int64_t>(delta.x) * delta.x + static_cast<int64_t>(delta.y) * delta.y;
     lastMousePos_ = currentPos;
     
-    // 如果已经触发过手势，不再处理（除了滚动模式）
+    // 如果已经触发过手势，不再识别（除了滚动模式），只处理拖动连发
     if (gestureTriggered_ && !scrollMode_) {
+        switch (repeater_.AddSample(currentPos, timeUs)) {
+            case DragRepeater::STEP_FORWARD:
+                actions_->ExecuteAction(repeatAction_, LatencyOrigin(timeUs));
+                break;
+            case DragRepeater::STEP_REVERSE:
+                if (reverseAction_.action != ActionType::NONE) {
+                    actions_->ExecuteAction(reverseAction_, LatencyOrigin(timeUs));
+                }
+                break;
+            default:
+                break;
+        }
         return;
     }
     
-    for (const auto& cfg : configs_) {
-        if (cfg.triggerButton != activeButton_) {
-            continue;
+    const GestureTable& table = *table_.Get();
+    
+    // 形状/序列按钮：只记录笔画，一次性手势推迟到释放时识别
+    if (table.IsDeferred(activeTrigger_)) {
+        if (table.HasShapes(activeTrigger_)) {
+            stroke_.Add(currentPos);
+            if (!strokeCapture_ && stroke_.GetLength() >= table.GetMinShapeLength(activeTrigger_)) {
+                strokeCapture_ = true;
+            }
         }
-        
-        // 滚动模式：持续处理
-        if (cfg.gestureType == GestureType::TWO_FINGER_SCROLL) {
-            if (!scrollMode_) {
-                scrollMode_ = true;
+        if (table.HasSequences(activeTrigger_)) {
+            AdvanceSequence(table, currentPos);
+        }
+        if (table.HasScroll(activeTrigger_)) {
+            scrollMode_ = true;
+            HandleScrollSimulation(table, currentPos, moveDelta, timeUs);
+        }
+        return;
+    }
+    
+    // 预测式提前提交：方向置信度达到规则的提交级别时立即触发；提交前反向则取消本次手势
+    if (!gestureTriggered_ && !gestureCancelled_ && table.HasEarlyCommit(activeTrigger_)) {
+        classifier_.AddSample(currentPos);
+        double dist = delta.length();
+        if (classifier_.IsReversed()) {
+            gestureCancelled_ = true;
+        } else if (dist >= table.GetMinCommitDistance(activeTrigger_)) {
+            const GestureConfig* cfg = DetectEarlyCommit(table, dist);
+            if (cfg) {
+                TriggerGesture(table, *cfg, delta, currentPos, timeUs);
+                return;
             }
-            HandleScrollSimulation(moveDelta);
-            return;
         }
-        
-        // 一次性手势：只触发一次
-        if (dist >= cfg.threshold && !gestureTriggered_) {
-            GestureType gesture = RecognizeGesture(delta, dist);
-            if (gesture != GestureType::NONE && cfg.gestureType == gesture) {
-                gestureTriggered_ = true;
-                currentGesture_ = gesture;
-                ExecuteGesture(cfg, delta);
-                return; // 执行后立即返回，不再处理
+    }
+    
+    // 一次性手势：只触发一次，每个采样最多识别一次方向
+    if (!gestureTriggered_ && !gestureCancelled_ && dist2 >= table.GetMinThresholdSquared(activeTrigger_)) {
+        SectorClassifier::Sector sector = RecognizeGesture(table, delta, lastDirection_);
+        lastDirection_ = sector.gesture;
+        const GestureConfig* cfg = table.Find(activeTrigger_, sector.gesture);
+        // 启用了提前提交的规则在阈值处也要求位移接近坐标轴，避免对角线拖动误触发
+        if (cfg && dist2 >= GestureTable::ThresholdSquared(cfg->threshold) && WithinTolerance(*cfg, sector) &&
+            (!table.HasEarlyCommit(activeTrigger_) || cfg->commitConfidence <= 0 ||
+             classifier_.GetAxisScore() >= DirectionClassifier::kDiagonalGuard)) {
+            TriggerGesture(table, *cfg, delta, currentPos, timeUs);
+            return; // 执行后立即返回，不再处理
+        }
+    }
+    
+    // 快速轻扫：速度足够快时不必等移动距离达到阈值，阈值仍作为慢速拖动的后备
+    if (!gestureTriggered_ && !gestureCancelled_ && table.HasFlick(activeTrigger_)) {
+        flick_.AddSample(currentPos, timeUs);
+        double dist = delta.length();
+        if (dist >= table.GetMinFlickDistance(activeTrigger_)) {
+            const GestureConfig* cfg = DetectFlick(table, delta, dist);
+            if (cfg) {
+                TriggerGesture(table, *cfg, delta, currentPos, timeUs);
+                return;
             }
         }
     }
+    
+    // 滚动模式：持续处理
+    if (table.HasScroll(activeTrigger_)) {
+        scrollMode_ = true;
+        HandleScrollSimulation(table, currentPos, moveDelta, timeUs);
+    }
 }
 
 void GestureRecognizer::Reset() {
     activeButton_ = MouseButton::UNKNOWN;
+    activeTrigger_ = GestureTable::kNoTrigger;
+    chordHolder_ = MouseButton::UNKNOWN;
     gestureTriggered_ = false;
+    gestureCancelled_ = false;
     currentGesture_ = GestureType::NONE;
     scrollMode_ = false;
+    strokeCapture_ = false;
+    repeater_.Reset();
+    momentum_.Stop();
+    FlushScroll();
     buttonState_.Reset();
+    PublishState(StateSequence(publishedState_.load(std::memory_order_relaxed)));
+}
+
+SectorClassifier::Sector GestureRecognizer::RecognizeGesture(const GestureTable& table, const Point& delta,
+                                                             GestureType previous) const {
+    // 最小距离由各规则的 threshold 决定；没有位移时返回 NONE
+    return SectorClassifier::Classify(delta, table.IsEightWay(activeTrigger_), previous,
+                                      table.GetHysteresis(activeTrigger_));
 }
 
-GestureType GestureRecognizer::RecognizeGesture(const Point& delta, double distance) const {
-    if (distance < 30) {
-        return GestureType::NONE;
+const GestureConfig* GestureRecognizer::DetectFlick(const GestureTable& table, const Point& delta, double distance) const {
+    SectorClassifier::Sector sector = RecognizeGesture(table, delta, GestureType::NONE);
+    GestureType gesture = sector.gesture;
+    const GestureConfig* cfg = table.Find(activeTrigger_, gesture);
+    if (!cfg || cfg->flickSpeed <= 0 || distance < cfg->flickMinDistance || !WithinTolerance(*cfg, sector)) {
+        return nullptr;
     }
     
-    // 使用绝对值比较，更简单直接
-    int absDx = abs(delta.x);
-    int absDy = abs(delta.y);
+    // 窗口速度达到触发速度，且瞬时速度没有明显回落（停下来的慢拖不算轻扫）
+    FlickDetector::Velocity window = flick_.GetWindowVelocity();
+    if (window.speed < cfg->flickSpeed || flick_.GetInstantVelocity().speed < cfg->flickSpeed * 0.5) {
+        return nullptr;
+    }
     
-    // 判断是水平还是垂直移动
-    if (absDx > absDy) {
-        // 水平移动
-        return delta.x > 0 ? GestureType::SWIPE_RIGHT : GestureType::SWIPE_LEFT;
-    } else {
-        // 垂直移动
-        return delta.y > 0 ? GestureType::SWIPE_DOWN : GestureType::SWIPE_UP;
+    // 速度方向与手势方向的夹角不超过 flickMaxAngle
+    const double kInvSqrt2 = 0.70710678118654752;
+    Point axis = SectorClassifier::Axis(gesture);
+    if (axis.x == 0 && axis.y == 0) {
+        return nullptr;
+    }
+    const double kDegToRad = 3.14159265358979323846 / 180.0;
+    double along = (window.vx * axis.x + window.vy * axis.y) * (SectorClassifier::IsDiagonal(gesture) ? kInvSqrt2 : 1.0);
+    if (along < window.speed * cos(cfg->flickMaxAngle * kDegToRad)) {
+        return nullptr;
     }
+    return cfg;
 }
 
-const GestureConfig* GestureRecognizer::FindConfig(MouseButton button, GestureType gesture) const {
-    for (const auto& config : configs_) {
-        if (config.triggerButton == button && config.gestureType == gesture) {
-            return &config;
+const GestureConfig* GestureRecognizer::DetectEarlyCommit(const GestureTable& table, double distance) const {
+    const GestureConfig* cfg = table.Find(activeTrigger_, classifier_.GetDirection());
+    if (!cfg || cfg->commitConfidence <= 0 || distance < cfg->commitDistance) {
+        return nullptr;
+    }
+    if (classifier_.GetConfidence() < cfg->commitConfidence) {
+        return nullptr;
+    }
+    return cfg;
+}
+
+void GestureRecognizer::TriggerGesture(const GestureTable& table, const GestureConfig& config, const Point& delta,
+                                       const Point& position, int64_t timeUs) {
+    gestureTriggered_ = true;
+    currentGesture_ = config.gestureType;
+    ExecuteGesture(config, delta, timeUs);
+    
+    // 连发的动作在触发时取出，按住期间热重载不影响本次连发
+    if (config.repeatStep > 0) {
+        const GestureConfig* reverse = table.Find(activeTrigger_, SectorClassifier::Opposite(config.gestureType));
+        repeatAction_ = config.program;
+        reverseAction_ = reverse ? reverse->program : ActionProgram();
+        repeater_.Arm(position, config.gestureType, config.repeatStep, config.repeatInterval, timeUs);
+    }
+}
+
+void GestureRecognizer::AdvanceSequence(const GestureTable& table, const Point& position) {
+    // 每结束一个笔画在前缀树中前进一步，与序列长度无关
+    GestureType finished = segmenter_.AddSample(position, table.GetMinStrokeLengthSquared(activeTrigger_),
+                                                table.IsEightWay(activeTrigger_));
+    if (finished != GestureType::NONE) {
+        sequenceNode_ = table.GetSequenceTrie(activeTrigger_).Advance(sequenceNode_, finished);
+    }
+    if (segmenter_.GetDirection() != GestureType::NONE) {
+        strokeCapture_ = true;
+    }
+}
+
+const GestureConfig* GestureRecognizer::RecognizeStroke(const GestureTable& table, const Point& releasePos) {
+    const Point delta = releasePos - gestureStartPos_;
+    
+    // 序列：释放时结束最后一个笔画
+    if (table.HasSequences(activeTrigger_)) {
+        AdvanceSequence(table, releasePos);
+        int node = table.GetSequenceTrie(activeTrigger_).Advance(sequenceNode_, segmenter_.GetDirection());
+        const GestureConfig* sequence =
+            table.GetSequenceRule(activeTrigger_, table.GetSequenceTrie(activeTrigger_).GetRule(node));
+        if (sequence) {
+            return sequence;
         }
     }
+    
+    stroke_.Add(releasePos);
+    const ShapeMatcher::Result match =
+        table.GetShapeMatcher(activeTrigger_).Match(stroke_.GetPoints(), stroke_.GetCount());
+    const GestureConfig* shape = table.GetShapeRule(activeTrigger_, match.index);
+    if (shape && match.score >= shape->shapeMinScore && stroke_.GetLength() >= shape->threshold) {
+        return shape;
+    }
+    
+    // 不像任何形状：按最终位移当作普通滑动
+    int64_t dist2 = static_cast<int64_t>(delta.x) * delta.x + static_cast<int64_t>(delta.y) * delta.y;
+    SectorClassifier::Sector sector = RecognizeGesture(table, delta, GestureType::NONE);
+    const GestureConfig* cfg = table.Find(activeTrigger_, sector.gesture);
+    if (cfg && dist2 >= GestureTable::ThresholdSquared(cfg->threshold) && WithinTolerance(*cfg, sector)) {
+        return cfg;
+    }
     return nullptr;
 }
 
-void GestureRecognizer::ExecuteGesture(const GestureConfig& config, const Point& delta) {
+const GestureConfig* GestureRecognizer::FindConfig(MouseButton button, GestureType gesture) const {
+    return table_.Get()->Find(GestureTable::ButtonTrigger(button), gesture);
+}
+
+void GestureRecognizer::ExecuteGesture(const GestureConfig& config, const Point& delta, int64_t timeUs) {
     // 移除日志输出以提高性能
-    actions_->ExecuteAction(config.actionType);
+    const int64_t origin = LatencyOrigin(timeUs);
+    if (origin > 0) {
+        WMF_LATENCY_RECORD(RECOGNITION, origin * 1000, WMF_LATENCY_NOW());
+    }
+    actions_->ExecuteAction(config.program, origin);
 }
 
-void GestureRecognizer::HandleScrollSimulation(const Point& delta) {
-    // 累积滚动量
-    scrollAccumulator_.x += delta.x;
-    scrollAccumulator_.y += delta.y;
+void GestureRecognizer::HandleScrollSimulation(const GestureTable& table, const Point& position, const Point& delta,
+                                               int64_t timeUs) {
+    const ScrollProfile& profile = table.GetScrollProfile(activeTrigger_);
+    if (profile.HasMomentum()) {
+        // 记录速度采样，松开时作为惯性的初速度
+        flick_.AddSample(position, timeUs);
+    }
     
-    // 滚动灵敏度因子（可以调整 - 数值越大越不敏感）
-    const int scrollFactor = 5;
+    // 按加速曲线换算为高分辨率滚轮量，不足一个单位的部分留到下次
+    Point wheel = scrollEngine_.AddSample(delta, timeUs, profile);
+    if (wheel.x != 0 || wheel.y != 0) {
+        EmitScroll(wheel, profile);
+    }
+}
+
+void GestureRecognizer::EmitScroll(const Point& wheel, const ScrollProfile& profile) {
+    // 统计只由工作线程写入，与 RecordQueueLatency 相同不需要原子的读-改-写
+    scrollSamples_.store(scrollSamples_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    pendingWheel_ = pendingWheel_ + wheel;
     
-    // 计算实际滚动量
-    int scrollX = scrollAccumulator_.x / scrollFactor;
-    int scrollY = scrollAccumulator_.y / scrollFactor;
+    const int64_t interval = profile.GetOutputIntervalUs();
+    if (interval <= 0) {
+        FlushScroll();
+    } else if (!scrollFlushArmed_) {
+        // 批次中的第一个滚动量决定输出时刻，最多延迟一个输出间隔
+        scrollFlushArmed_ = true;
+        scrollFlushUs_ = MonotonicMicros() + interval;
+    }
+}
+
+void GestureRecognizer::FlushScroll() {
+    scrollFlushArmed_ = false;
+    if (pendingWheel_.x == 0 && pendingWheel_.y == 0) {
+        return;
+    }
     
-    if (scrollX != 0 || scrollY != 0) {
-        // 发送滚动事件
-        actions_->SimulateScroll(scrollX, scrollY);
-        
-        // 减去已处理的量
-        scrollAccumulator_.x -= scrollX * scrollFactor;
-        scrollAccumulator_.y -= scrollY * scrollFactor;
+    actions_->SimulateScroll(pendingWheel_.x, pendingWheel_.y);
+    scrollFlushes_.store(scrollFlushes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    scrollMessages_.store(scrollMessages_.load(std::memory_order_relaxed) + (pendingWheel_.x != 0) +
+                          (pendingWheel_.y != 0), std::memory_order_relaxed);
+    pendingWheel_ = Point(0, 0);
+}
+
+int64_t GestureRecognizer::NextTimerDeadline() const {
+    int64_t deadline = INT64_MAX;
+    if (momentum_.IsActive()) {
+        deadline = nextFrameUs_;
+    }
+    if (scrollFlushArmed_ && scrollFlushUs_ < deadline) {
+        deadline = scrollFlushUs_;
+    }
+    return deadline;
+}
+
+void GestureRecognizer::RunTimers(int64_t nowUs) {
+    if (momentum_.IsActive() && nowUs >= nextFrameUs_) {
+        StepMomentum(nowUs);
+    }
+    if (scrollFlushArmed_ && nowUs >= scrollFlushUs_) {
+        FlushScroll();
+    }
+}
+
+void GestureRecognizer::StartMomentum(const GestureTable& table, int64_t timeUs) {
+    const ScrollProfile& profile = table.GetScrollProfile(activeTrigger_);
+    // 停下来之后再松开不产生惯性
+    if (!profile.HasMomentum() || timeUs - flick_.GetLatestTime() > FlickDetector::kWindowUs) {
+        return;
+    }
+    
+    // 惯性的帧按实际时间推进，起点也取实际时间：回放的事件时间可能远早于现在，
+    // 按事件时间开始会在第一帧把整段惯性一次滚完
+    FlickDetector::Velocity velocity = flick_.GetWindowVelocity();
+    const int64_t now = MonotonicMicros();
+    if (momentum_.Start(velocity.vx, velocity.vy, profile.GetFriction(), now)) {
+        momentumTrigger_ = activeTrigger_;
+        scrollEngine_.Rebase(now);
+        nextFrameUs_ = now + frameIntervalUs_.load(std::memory_order_relaxed);
+    }
+}
+
+void GestureRecognizer::StepMomentum(int64_t nowUs) {
+    Point pixels = momentum_.Step(nowUs);
+    if (pixels.x != 0 || pixels.y != 0) {
+        const ScrollProfile& profile = table_.Get()->GetScrollProfile(momentumTrigger_);
+        Point wheel = scrollEngine_.AddSample(pixels, nowUs, profile);
+        if (wheel.x != 0 || wheel.y != 0) {
+            EmitScroll(wheel, profile);
+        }
+    }
+    
+    // 按固定节拍排下一帧；落后时从现在重新开始，不补帧
+    const int64_t interval = frameIntervalUs_.load(std::memory_order_relaxed);
+    nextFrameUs_ += interval;
+    if (nextFrameUs_ <= nowUs) {
+        nextFrameUs_ = nowUs + interval;
+    }
+    
+    if (!momentum_.IsActive()) {
+        // 惯性结束：送出剩余的滚动量，清除状态位，钩子线程不再为它转发移动
+        FlushScroll();
+        PublishState(StateSequence(publishedState_.load(std::memory_order_relaxed)));
     }
 }
 
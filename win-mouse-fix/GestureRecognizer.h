@@ -2,47 +2,100 @@
 
 #include "Common.h"
 #include "ButtonState.h"
+#include "DirectionClassifier.h"
+#include "DragRepeater.h"
+#include "FlickDetector.h"
+#include "ScrollEngine.h"
+#include "SectorClassifier.h"
+#include "SequenceTrie.h"
+#include "ShapeMatcher.h"
+#include "GestureTable.h"
+#include "RcuSnapshot.h"
+#include "SpscRing.h"
 #include <vector>
+#include <chrono>
 #include <thread>
 #include <mutex>
-#include <queue>
 #include <condition_variable>
 #include <atomic>
 
 namespace WinMouseFix {
 
-class WindowsActions;
+class ActionSink;
 
 /**
  * @brief 手势识别器类 - 识别鼠标手势并触发相应动作
+ *
+ * 与平台无关：输入为 InputEvent（或 On* 系列方法），输出通过 ActionSink 发出。
+ * On* 方法由单一的生产者线程（钩子线程）调用，识别在内部工作线程中进行。
  */
 class GestureRecognizer {
 public:
-    explicit GestureRecognizer(WindowsActions* actions);
+    /**
+     * @brief 事件队列统计（每条通道的丢弃数与高水位）
+     */
+    struct QueueStats {
+        uint64_t buttonDrops;       // 按钮通道满时丢失的按钮事件数
+        uint64_t buttonResyncs;     // 丢失后按钩子线程的按钮状态补齐的次数
+        size_t buttonHighWater;
+        uint64_t moveDrops;         // 移动通道满时被拒绝的采样数
+        size_t moveHighWater;
+        uint64_t movesCoalesced;    // 其中被合并（而非丢弃）的采样数
+        uint64_t coalescedRecords;  // 入队的合并记录数（包含多于一个采样）
+        uint64_t staleBlockDecisions;  // 工作线程未追上就做出的释放阻止判定数
+        uint64_t latencySamples;       // 以下排队延迟统计的事件数
+        double meanQueueLatencyUs;     // 事件发生（钩子入口）到工作线程取出的平均延迟
+        int64_t maxQueueLatencyUs;
+        uint64_t scrollSamples;        // 产生滚动量的采样数（含惯性滚动的帧）
+        uint64_t scrollFlushes;        // 滚动输出次数（每次一个 SendInput 批次）
+        uint64_t scrollMessages;       // 发出的滚轮消息数（每次输出垂直、水平最多各一条）
+    };
+
+    /**
+     * @brief 移动通道满时的处理策略
+     */
+    enum class MoveOverflowPolicy {
+        DROP,       // 直接丢弃多余的采样
+        COALESCE    // 合并为一条“最新位置 + 累积位移 + 采样数”记录
+    };
+
+    explicit GestureRecognizer(ActionSink* actions);
     ~GestureRecognizer();
 
     /**
-     * @brief 加载手势配置
+     * @brief 加载手势配置（编译为按钮 x 手势类型的查找表）
+     *
+     * 可在任意线程调用，包括识别进行中：新规则表以原子指针替换的方式发布，
+     * 钩子线程和工作线程都不加锁、不等待，旧表在两者都不再引用后释放。
      */
     void LoadConfig(const std::vector<GestureConfig>& configs);
 
+    /**
+     * @brief 处理一个可移植输入事件
+     * @return 如果应阻止该事件的默认行为返回 true
+     */
+    bool OnInputEvent(const InputEvent& event);
+
     /**
      * @brief 处理鼠标移动事件
+     * @param timeUs 事件时间（MonotonicMicros()），0 表示取调用时刻
      * @return 如果手势正在进行中返回 true（此时应该阻止默认行为）
      */
-    bool OnMouseMove(const Point& currentPos);
+    bool OnMouseMove(const Point& currentPos, int64_t timeUs = 0);
 
     /**
      * @brief 处理鼠标按钮按下事件
+     * @param timeUs 事件时间（MonotonicMicros()），0 表示取调用时刻
      * @return 如果事件被处理返回 true
      */
-    bool OnButtonDown(MouseButton button, const Point& position);
+    bool OnButtonDown(MouseButton button, const Point& position, int64_t timeUs = 0);
 
     /**
      * @brief 处理鼠标按钮释放事件
+     * @param timeUs 事件时间（MonotonicMicros()），0 表示取调用时刻
      * @return 如果事件被处理返回 true
      */
-    bool OnButtonUp(MouseButton button, const Point& position);
+    bool OnButtonUp(MouseButton button, const Point& position, int64_t timeUs = 0);
 
     /**
      * @brief 重置手势识别状态
@@ -50,57 +103,184 @@ public:
     void Reset();
 
     /**
-     * @brief 检查是否有激活的手势
+     * @brief 等待工作线程处理完所有已入队的事件（仅生产者线程调用）
+     *
+     * 供无头驱动、回放和基准测试获得确定的结果，钩子回调中不要调用。
+     */
+    void WaitForIdle();
+
+    /**
+     * @brief 等待按钮通道留出空闲槽位（仅生产者线程调用）
+     *
+     * 真实钩子的事件速率远低于工作线程的处理能力；以最快速度回放时，
+     * 生产者需要在每个事件前调用本方法施加背压，否则按钮通道可能被填满。
      */
-    bool HasActiveGesture() const { return activeButton_ != MouseButton::UNKNOWN; }
+    void WaitForQueueSpace();
+
+    /**
+     * @brief 检查是否有激活的手势（读取工作线程发布的状态，任意线程可调用）
+     */
+    bool HasActiveGesture() const {
+        return StateButton(publishedState_.load(std::memory_order_acquire)) != MouseButton::UNKNOWN;
+    }
     
     /**
-     * @brief 检查按钮是否有配置
+     * @brief 钩子线程视角的按钮状态（所有五个按钮，仅钩子线程调用）
+     *
+     * 在钩子回调中即时更新，不经过队列，可用于判断组合键，例如
+     * GetButtonState().IsChord(ButtonState::Bit(MouseButton::BUTTON_4) | ButtonState::Bit(MouseButton::BUTTON_5))。
+     */
+    const ButtonState& GetButtonState() const { return hookButtons_; }
+
+    /**
+     * @brief 检查按钮是否有配置（一次数组访问，仅钩子线程调用）
+     */
+    bool HasConfigForButton(MouseButton button) const { return table_.Get()->HasButton(button); }
+
+    /**
+     * @brief 获取事件队列统计
+     */
+    QueueStats GetQueueStats() const;
+
+    // 基准测试直接调用工作线程内部的处理方法
+    friend struct BenchmarkAccess;
+
+    /**
+     * @brief 设置移动通道满时的处理策略（应在安装钩子前调用）
+     */
+    void SetMoveOverflowPolicy(MoveOverflowPolicy policy) { moveOverflowPolicy_ = policy; }
+
+    /**
+     * @brief 设置释放事件阻止判定的最长等待时间（应在安装钩子前调用）
+     *
+     * 默认为 0，直接按已发布的状态判定；否则最多等待这么久，让判定包含释放之前
+     * 入队的所有事件。钩子回调受 LowLevelHooksTimeout 限制，不宜设得过长。
      */
-    bool HasConfigForButton(MouseButton button) const {
-        for (const auto& config : configs_) {
-            if (config.triggerButton == button) {
-                return true;
-            }
-        }
-        return false;
+    void SetBlockDecisionTimeout(std::chrono::microseconds timeout) { blockDecisionTimeout_ = timeout; }
+
+    /**
+     * @brief 设置惯性滚动的帧率（通常为显示器刷新率，默认 60）
+     */
+    void SetFrameRate(int hz) {
+        frameIntervalUs_.store(hz > 0 ? 1000000 / hz : kDefaultFrameIntervalUs, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 事件时间是否为钩子入口的实际时间（默认是，应在送入事件前调用）
+     *
+     * 以最快速度回放录制时，事件时间按录制间隔排在过去，不是入队时刻：此时不记录排队延迟和
+     * 从事件时间算起的各阶段延迟，动作请求也不带触发时间，识别本身仍按事件时间进行。
+     */
+    void SetLiveEventTimes(bool live) { liveEventTimes_.store(live, std::memory_order_relaxed); }
+
+    /**
+     * @brief 是否正在惯性滚动（读取工作线程发布的状态，任意线程可调用）
+     */
+    bool IsMomentumActive() const {
+        return (publishedState_.load(std::memory_order_acquire) & kStateMomentum) != 0;
     }
 
 private:
     /**
-     * @brief 根据移动向量识别手势类型
+     * @brief 根据移动向量识别方向扇区（不检查距离）
+     *
+     * 激活按钮配置了斜向手势时分 8 个扇区，否则 4 个；previous 为上一次识别的方向，
+     * 用于按钮的方向滞回。只有整数运算。
+     */
+    SectorClassifier::Sector RecognizeGesture(const GestureTable& table, const Point& delta, GestureType previous) const;
+
+    /**
+     * @brief 扇区是否在规则的角度容差以内
      */
-    GestureType RecognizeGesture(const Point& delta, double distance) const;
+    static bool WithinTolerance(const GestureConfig& config, const SectorClassifier::Sector& sector) {
+        return config.angleTolerance <= 0 || sector.offset <= SectorClassifier::DegreesToUnits(config.angleTolerance);
+    }
 
     /**
-     * @brief 查找按钮对应的手势配置
+     * @brief 检查当前速度是否构成快速轻扫，返回应触发的规则
+     */
+    const GestureConfig* DetectFlick(const GestureTable& table, const Point& delta, double distance) const;
+
+    /**
+     * @brief 检查方向置信度是否达到规则的提交级别，返回应提前触发的规则
+     */
+    const GestureConfig* DetectEarlyCommit(const GestureTable& table, double distance) const;
+
+    /**
+     * @brief 触发一次性手势；规则配置了 repeatStep 时开始拖动连发
+     */
+    void TriggerGesture(const GestureTable& table, const GestureConfig& config, const Point& delta,
+                        const Point& position, int64_t timeUs);
+
+    /**
+     * @brief 释放时识别多笔画序列和形状，都不匹配时按最终位移识别滑动手势
+     */
+    const GestureConfig* RecognizeStroke(const GestureTable& table, const Point& releasePos);
+
+    /**
+     * @brief 把采样送入笔画分段，笔画结束时推进序列前缀树
+     */
+    void AdvanceSequence(const GestureTable& table, const Point& position);
+
+    /**
+     * @brief 查找单个按钮对应的手势配置
      */
     const GestureConfig* FindConfig(MouseButton button, GestureType gesture) const;
 
     /**
      * @brief 执行手势对应的动作
      */
-    void ExecuteGesture(const GestureConfig& config, const Point& delta);
+    void ExecuteGesture(const GestureConfig& config, const Point& delta, int64_t timeUs);
 
     /**
      * @brief 处理滚动模拟
      */
-    void HandleScrollSimulation(const Point& delta);
+    void HandleScrollSimulation(const GestureTable& table, const Point& position, const Point& delta, int64_t timeUs);
+
+    /**
+     * @brief 松开滚动按钮时按最近的移动速度开始惯性滚动
+     */
+    void StartMomentum(const GestureTable& table, int64_t timeUs);
+
+    /**
+     * @brief 推进一帧惯性滚动（工作线程空闲时按帧调用）
+     */
+    void StepMomentum(int64_t nowUs);
+
+    /**
+     * @brief 把滚轮量并入待输出的批次；输出间隔为 0 时立即输出
+     */
+    void EmitScroll(const Point& wheel, const ScrollProfile& profile);
+
+    /**
+     * @brief 输出待发送的滚轮量（两个方向一次发出）
+     */
+    void FlushScroll();
+
+    /**
+     * @brief 最近的定时任务（惯性滚动帧、批量滚动输出）时间，没有时返回 INT64_MAX
+     */
+    int64_t NextTimerDeadline() const;
+
+    /**
+     * @brief 执行到期的定时任务
+     */
+    void RunTimers(int64_t nowUs);
     
     /**
      * @brief 在工作线程中处理按钮按下
      */
-    void ProcessButtonDown(MouseButton button, const Point& position);
+    void ProcessButtonDown(MouseButton button, const Point& position, int64_t timeUs);
     
     /**
      * @brief 在工作线程中处理按钮释放
      */
-    void ProcessButtonUp(MouseButton button, const Point& position);
+    void ProcessButtonUp(MouseButton button, const Point& position, int64_t timeUs);
     
     /**
      * @brief 在工作线程中处理鼠标移动
      */
-    void ProcessMouseMove(const Point& position);
+    void ProcessMouseMove(const Point& position, const Point& delta, int64_t timeUs);
 
 private:
     // 事件队列相关
@@ -109,30 +289,187 @@ private:
         Type type;
         MouseButton button;
         Point position;
+        uint64_t sequence;     // 钩子线程分配的全局序号，用于合并两条通道
+        Point delta;           // 本事件覆盖的累积位移（仅 MOUSE_MOVE）
+        uint32_t sampleCount;  // 合并进本事件的原始采样数（仅 MOUSE_MOVE）
+        int64_t timeUs;        // 事件发生时间（钩子入口），合并记录为最新采样的时间
     };
-    
-    std::queue<MouseEvent> eventQueue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCV_;
+
+    // 按钮通道：容量远大于人手点击速率；工作线程长时间停顿时仍可能填满，
+    // 丢失的事件由工作线程按钩子线程的按钮状态补齐（见 hookButtonWord_）
+    static const size_t kButtonLaneCapacity = 256;
+    // 移动通道：工作线程跟不上时按 moveOverflowPolicy_ 丢弃或合并多余的移动采样
+    static const size_t kMoveLaneCapacity = 16;
+
+    SpscRing<MouseEvent, kButtonLaneCapacity> buttonLane_;
+    SpscRing<MouseEvent, kMoveLaneCapacity> moveLane_;
+    uint64_t nextSequence_;                // 仅钩子线程访问
+    MouseButton hookActiveButton_;         // 钩子线程视角的激活按钮，决定移动是否入队
+    ButtonState hookButtons_;              // 钩子线程视角的按钮状态（含组合键）
+    MouseButton hookChordButton_;          // 被阻止的组合键第二个按钮，释放时也阻止
+    uint32_t hookChordHolders_;            // 参与过组合键、释放时需要阻止的按钮
+
+    // 按钮通道满时的恢复：钩子线程发布丢失事件时的按钮状态（低 8 位为按下掩码，
+    // 其余为丢失事件占用的序号），工作线程处理完序号更小的事件后补齐按下/释放
+    static const int kButtonWordShift = 8;
+    std::atomic<uint64_t> hookButtonWord_;
+    std::atomic<bool> buttonResync_;
+    std::atomic<uint64_t> buttonResyncs_;
+    bool resyncPending_;                   // 以下仅工作线程访问
+    uint64_t resyncSequence_;
+    uint32_t resyncMask_;
+    uint64_t resyncDone_;                  // 已补齐的序号 + 1，重复发布的状态不再处理
+
+    // 移动采样合并（仅钩子线程访问）
+    MoveOverflowPolicy moveOverflowPolicy_;
+    MouseEvent pendingMove_;               // 尚未入队的合并记录
+    bool hasPendingMove_;
+    bool hookHandedOff_;                   // 合并记录可能还在交接槽中
+
+    // 交接槽（仅 COALESCE）：移动通道满时钩子线程把合并记录放进槽中，工作线程取空两条通道后
+    // 自己取走，停止移动时最后的位移也能送达；钩子线程下一个事件到来时若记录还在就收回继续合并
+    enum HandoffState { kHandoffEmpty, kHandoffFull, kHandoffTaken };
+    std::atomic<int> handoffState_;
+    MouseEvent handoffMove_;
+    MouseEvent takenMove_;                 // 工作线程已取走、尚未处理的记录
+    bool hasTakenMove_;
+    Point lastHookPos_;                    // 钩子线程看到的上一个位置
+    std::atomic<uint64_t> movesCoalesced_;
+    std::atomic<uint64_t> coalescedRecords_;
+
+    // 仅用于工作线程空闲时的休眠/唤醒，钩子线程只在工作线程休眠时加锁
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCV_;
+    std::atomic<bool> workerWaiting_;
+
     std::thread processingThread_;
     std::atomic<bool> running_;
+
+    // 工作线程发布的状态字：位 0-7 为激活按钮，位 8 为手势已触发，位 9 为滚动模式，
+    // 位 10 为正在绘制形状或序列，位 11 为惯性滚动中，位 16-63 为已处理事件的序号 + 1。
+    // 钩子线程一次加载即可判定是否阻止释放事件，以及没有按下按钮时移动是否入队。
+    static const uint64_t kStateButtonMask = 0xFF;
+    static const uint64_t kStateTriggered = 1ull << 8;
+    static const uint64_t kStateScrollMode = 1ull << 9;
+    static const uint64_t kStateStrokeCapture = 1ull << 10;
+    static const uint64_t kStateMomentum = 1ull << 11;
+    static const int kStateSequenceShift = 16;
+
+    static MouseButton StateButton(uint64_t state) {
+        return static_cast<MouseButton>(state & kStateButtonMask);
+    }
+    static uint64_t StateSequence(uint64_t state) { return state >> kStateSequenceShift; }
+
+    std::atomic<uint64_t> publishedState_;
+    std::chrono::microseconds blockDecisionTimeout_;  // 仅钩子线程读取
+    static const int64_t kDefaultFrameIntervalUs = 1000000 / 60;
+    std::atomic<int64_t> frameIntervalUs_;            // 惯性滚动的帧间隔
+    std::atomic<bool> liveEventTimes_;                // 事件时间是否为实际的钩子入口时间
+    std::atomic<uint64_t> staleBlockDecisions_;
+
+    // 排队延迟统计（仅工作线程写入）
+    std::atomic<uint64_t> latencySamples_;
+    std::atomic<int64_t> latencySumUs_;
+    std::atomic<int64_t> latencyMaxUs_;
+    std::atomic<uint64_t> scrollSamples_;
+    std::atomic<uint64_t> scrollFlushes_;
+    std::atomic<uint64_t> scrollMessages_;
+
+    /**
+     * @brief 发布当前手势状态（工作线程）
+     * @param processedSequence 已处理事件的序号 + 1
+     */
+    void PublishState(uint64_t processedSequence);
+
+    /**
+     * @brief 读取状态字，必要时在时限内等待序号到达 target（钩子线程）
+     */
+    uint64_t LoadStateAtLeast(uint64_t target);
     
     void ProcessingThreadFunc();
     void ProcessEvent(const MouseEvent& event);
+
+    /**
+     * @brief 按序号从两条通道中取出下一个事件（工作线程）
+     * @param limit 只取序号小于 limit 的事件
+     */
+    bool PopNextEvent(MouseEvent& event, uint64_t limit);
+
+    /**
+     * @brief 按钮事件丢失后，按钩子线程的按钮状态补齐工作线程的按下/释放（工作线程）
+     */
+    void ResyncButtons(uint32_t hookMask, int64_t timeUs);
+
+    /**
+     * @brief 唤醒休眠中的工作线程（钩子线程）
+     */
+    void NotifyWorker();
+
+    /**
+     * @brief 按钮事件入按钮通道（钩子线程）
+     */
+    void EnqueueButtonEvent(MouseEvent::Type type, MouseButton button, const Point& position, int64_t timeUs);
+
+    /**
+     * @brief 记录一个事件的排队延迟（工作线程）
+     */
+    void RecordQueueLatency(int64_t latencyUs);
+
+    static int64_t EventTime(int64_t timeUs) { return timeUs != 0 ? timeUs : MonotonicMicros(); }
+
+    /**
+     * @brief 延迟统计的起点：事件时间不是实际的钩子入口时间时返回 0（不统计）
+     */
+    int64_t LatencyOrigin(int64_t timeUs) const {
+        return liveEventTimes_.load(std::memory_order_relaxed) ? timeUs : 0;
+    }
+
+    /**
+     * @brief 将待入队的合并记录送入队列（钩子线程）
+     * @param mustDeliver 为 true 时移动通道满则改走按钮通道，保证先于按钮事件送达
+     */
+    void FlushPendingMove(bool mustDeliver);
+
+    /**
+     * @brief 收回交接槽中工作线程还没取走的合并记录（钩子线程）
+     */
+    void ReclaimHandoff();
     
-    WindowsActions* actions_;              // Windows 动作执行器
+    ActionSink* actions_;                  // 动作输出
     ButtonState buttonState_;              // 按钮状态跟踪
-    std::vector<GestureConfig> configs_;   // 手势配置列表
+    // 编译后的手势配置快照，读者为钩子线程和工作线程
+    static const size_t kHookReader = 0;
+    static const size_t kWorkerReader = 1;
+    RcuSnapshot<GestureTable, 2> table_;
     
     MouseButton activeButton_;             // 当前激活的按钮
+    int activeTrigger_;                    // 当前规则表中的触发器（单个按钮或组合键）
+    MouseButton chordHolder_;              // 组合键中先按住的按钮，单个按钮触发时为 UNKNOWN
     Point gestureStartPos_;                // 手势开始位置
     Point lastMousePos_;                   // 上一次鼠标位置
     bool gestureTriggered_;                // 手势是否已触发
+    bool gestureCancelled_;                // 提交前反向，本次按下不再触发一次性手势
+    FlickDetector flick_;                  // 当前手势的速度采样
+    DirectionClassifier classifier_;       // 当前手势的方向估计
+    DragRepeater repeater_;                // 触发后的拖动连发
+    ActionProgram repeatAction_;           // 正向连发的动作
+    ActionProgram reverseAction_;          // 反向连发的动作（相反方向的规则），没有时 action 为 NONE
+    ShapeStroke stroke_;                   // 当前手势的笔画（按钮配置了形状时记录）
+    StrokeSegmenter segmenter_;            // 多笔画序列的笔画分段
+    int sequenceNode_;                     // 已结束笔画在序列前缀树中的位置
+    bool strokeCapture_;                   // 笔画已足够长，释放时识别形状或序列
     GestureType currentGesture_;           // 当前手势类型
+    GestureType lastDirection_;            // 上一个采样识别的方向（方向滞回）
     
     // 滚动模拟相关
     bool scrollMode_;                      // 是否处于滚动模式
-    Point scrollAccumulator_;              // 滚动累积量
+    ScrollEngine scrollEngine_;            // 滚动余量与速度估计
+    ScrollMomentum momentum_;              // 松开后的惯性滚动
+    int momentumTrigger_;                  // 产生惯性的滚动触发器（取其滚动曲线）
+    int64_t nextFrameUs_;                  // 下一帧惯性滚动的时间
+    Point pendingWheel_;                   // 尚未输出的滚轮量
+    bool scrollFlushArmed_;                // 已排定批量输出
+    int64_t scrollFlushUs_;                // 批量输出的时间
 };
 
 } // namespace WinMouseFix
@@ -0,0 +1,163 @@
+﻿#include "GestureTable.h"
+#include "ActionProgram.h"
+#include "SectorClassifier.h"
+#include <algorithm>
+
+namespace WinMouseFix {
+
+GestureTable::GestureTable() {
+    Compile(std::vector<GestureConfig>());
+}
+
+void GestureTable::Compile(const std::vector<GestureConfig>& configs) {
+    for (int b = 0; b < kTriggerCount; ++b) {
+        for (int g = 0; g < kGestureCount; ++g) {
+            rules_[b][g] = GestureConfig();
+        }
+        masks_[b] = 0;
+        minThreshold_[b] = INT_MAX;
+        minThresholdSq_[b] = INT64_MAX;
+        hysteresis_[b] = 0;
+        minFlickDistance_[b] = INT_MAX;
+        minCommitDistance_[b] = INT_MAX;
+        minShapeLength_[b] = INT_MAX;
+        scrollProfiles_[b] = ScrollProfile();
+        shapes_[b].Clear();
+        shapeRules_[b].clear();
+        minStrokeLengthSq_[b] = INT64_MAX;
+        eightWay_[b] = false;
+        sequences_[b].Clear();
+        sequenceRules_[b].clear();
+    }
+    chordCount_ = 0;
+    holderMask_ = 0;
+    ruleCount_ = 0;
+
+    for (const auto& config : configs) {
+        const int b = AssignTrigger(config);
+        if (b == kNoTrigger) {
+            continue;
+        }
+
+        if (config.gestureType == GestureType::SHAPE) {
+            if (shapes_[b].AddTemplate(config.shapePoints.data(), config.shapePoints.size()) >= 0) {
+                shapeRules_[b].push_back(config);
+                shapeRules_[b].back().program = CompileActionProgram(config);
+                masks_[b] |= Bit(GestureType::SHAPE);
+                minShapeLength_[b] = std::min(minShapeLength_[b], config.threshold);
+                ++ruleCount_;
+            }
+            continue;
+        }
+
+        if (config.gestureType == GestureType::SEQUENCE) {
+            if (sequences_[b].Insert(config.sequence, static_cast<int>(sequenceRules_[b].size()))) {
+                sequenceRules_[b].push_back(config);
+                sequenceRules_[b].back().program = CompileActionProgram(config);
+                masks_[b] |= Bit(GestureType::SEQUENCE);
+                minStrokeLengthSq_[b] = std::min(minStrokeLengthSq_[b], ThresholdSquared(config.threshold));
+                for (GestureType stroke : config.sequence) {
+                    eightWay_[b] = eightWay_[b] || SectorClassifier::IsDiagonal(stroke);
+                }
+                ++ruleCount_;
+            }
+            continue;
+        }
+
+        int g = static_cast<int>(config.gestureType);
+        if (config.gestureType == GestureType::NONE || g < 0 || g >= kGestureCount) {
+            continue;
+        }
+
+        if (masks_[b] & Bit(config.gestureType)) {
+            continue;  // 重复规则：保留第一条
+        }
+
+        rules_[b][g] = config;
+        rules_[b][g].program = CompileActionProgram(config);
+        masks_[b] |= Bit(config.gestureType);
+        eightWay_[b] = eightWay_[b] || SectorClassifier::IsDiagonal(config.gestureType);
+        ++ruleCount_;
+
+        if (config.gestureType == GestureType::TWO_FINGER_SCROLL) {
+            scrollProfiles_[b].Build(config);
+        }
+        if (config.gestureType != GestureType::TWO_FINGER_SCROLL && config.threshold < minThreshold_[b]) {
+            minThreshold_[b] = config.threshold;
+            minThresholdSq_[b] = ThresholdSquared(config.threshold);
+        }
+        if (config.gestureType != GestureType::TWO_FINGER_SCROLL) {
+            hysteresis_[b] = std::max(hysteresis_[b], SectorClassifier::DegreesToUnits(config.angleHysteresis));
+        }
+        if (config.gestureType != GestureType::TWO_FINGER_SCROLL && config.flickSpeed > 0 &&
+            config.flickMinDistance < minFlickDistance_[b]) {
+            minFlickDistance_[b] = config.flickMinDistance;
+        }
+        if (config.gestureType != GestureType::TWO_FINGER_SCROLL && config.commitConfidence > 0 &&
+            config.commitDistance < minCommitDistance_[b]) {
+            minCommitDistance_[b] = config.commitDistance;
+        }
+    }
+}
+
+int GestureTable::AssignTrigger(const GestureConfig& config) {
+    if (!IsButton(config.triggerButton)) {
+        return kNoTrigger;
+    }
+    if (config.holdButton == MouseButton::UNKNOWN) {
+        return ButtonTrigger(config.triggerButton);
+    }
+    if (!IsButton(config.holdButton) || config.holdButton == config.triggerButton) {
+        return kNoTrigger;
+    }
+
+    for (int i = 0; i < chordCount_; ++i) {
+        if (chordHolders_[i] == config.holdButton && chordButtons_[i] == config.triggerButton) {
+            return kButtonCount + i;
+        }
+    }
+    if (chordCount_ == kMaxChords) {
+        return kNoTrigger;
+    }
+    chordHolders_[chordCount_] = config.holdButton;
+    chordButtons_[chordCount_] = config.triggerButton;
+    holderMask_ |= 1u << static_cast<int>(config.holdButton);
+    return kButtonCount + chordCount_++;
+}
+
+int GestureTable::FindChord(uint32_t heldMask, MouseButton button) const {
+    for (int i = 0; i < chordCount_; ++i) {
+        if (chordButtons_[i] == button && (heldMask & (1u << static_cast<int>(chordHolders_[i]))) != 0) {
+            return kButtonCount + i;
+        }
+    }
+    return kNoTrigger;
+}
+
+int GestureTable::GetMinThreshold(int trigger) const {
+    return IsValid(trigger) ? minThreshold_[trigger] : INT_MAX;
+}
+
+const GestureConfig* GestureTable::GetShapeRule(int trigger, int index) const {
+    if (!IsValid(trigger) || index < 0 || static_cast<size_t>(index) >= shapeRules_[trigger].size()) {
+        return nullptr;
+    }
+    return &shapeRules_[trigger][index];
+}
+
+const GestureConfig* GestureTable::GetSequenceRule(int trigger, int index) const {
+    if (!IsValid(trigger) || index < 0 || static_cast<size_t>(index) >= sequenceRules_[trigger].size()) {
+        return nullptr;
+    }
+    return &sequenceRules_[trigger][index];
+}
+
+const GestureConfig* GestureTable::Find(int trigger, GestureType gesture) const {
+    // 形状规则不在稠密表中，用 GetShapeRule 查询
+    if (!(GetGestureMask(trigger) & Bit(gesture)) || static_cast<int>(gesture) >= kGestureCount) {
+        return nullptr;
+    }
+    return &rules_[trigger][static_cast<int>(gesture)];
+}
+
+} // namespace WinMouseFix
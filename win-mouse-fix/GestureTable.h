@@ -0,0 +1,266 @@
+﻿#pragma once
+
+#include "Common.h"
+#include "ScrollEngine.h"
+#include "SequenceTrie.h"
+#include "ShapeMatcher.h"
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 编译后的手势规则表
+ *
+ * LoadConfig 时把规则列表展开为 按钮 x 手势类型 的稠密表，并预先计算每个按钮的
+ * 手势位掩码和一次性手势的最小阈值。查询都是一次数组访问，与规则数无关。
+ * 同一按钮、同一手势类型有多条规则时，只保留列表中的第一条（与 FindConfig 一致）。
+ * 形状规则不进入稠密表：每个按钮的形状模板编译到各自的 ShapeMatcher，模板下标即规则下标。
+ * 序列规则同样按按钮编译到各自的 SequenceTrie。
+ *
+ * 表按触发器下标索引：0 ~ kButtonCount-1 为单个按钮（即 MouseButton 取值），
+ * 其后为组合键（按住 holdButton 时按下 triggerButton），按首次出现的顺序分配，最多 kMaxChords 个。
+ */
+class GestureTable {
+public:
+    static const int kButtonCount = static_cast<int>(MouseButton::UNKNOWN);
+    static const int kGestureCount = static_cast<int>(GestureType::TWO_FINGER_SCROLL) + 1;
+    static const int kMaxChords = 8;
+    static const int kTriggerCount = kButtonCount + kMaxChords;
+    static const int kNoTrigger = -1;
+
+    GestureTable();
+
+    /**
+     * @brief 由规则列表重新生成表
+     */
+    void Compile(const std::vector<GestureConfig>& configs);
+
+    /**
+     * @brief 单个按钮的触发器下标
+     */
+    static int ButtonTrigger(MouseButton button) {
+        return IsButton(button) ? static_cast<int>(button) : kNoTrigger;
+    }
+
+    /**
+     * @brief 按住 heldMask 中的按钮时按下 button 构成的组合键触发器，没有配置时返回 kNoTrigger
+     *
+     * 多个组合键都匹配时取配置中最先出现的一个。钩子线程与工作线程用同样的输入调用，判定一致。
+     */
+    int FindChord(uint32_t heldMask, MouseButton button) const;
+
+    /**
+     * @brief 组合键中先按住的按钮，单个按钮的触发器返回 UNKNOWN
+     */
+    MouseButton GetChordHolder(int trigger) const {
+        return (trigger >= kButtonCount && trigger < kTriggerCount) ? chordHolders_[trigger - kButtonCount]
+                                                                    : MouseButton::UNKNOWN;
+    }
+
+    /**
+     * @brief 按钮是否配置了任何手势，或是某个组合键中先按住的按钮
+     */
+    bool HasButton(MouseButton button) const {
+        return IsButton(button) &&
+               (masks_[static_cast<int>(button)] != 0 || (holderMask_ & (1u << static_cast<int>(button))) != 0);
+    }
+
+    /**
+     * @brief 触发器是否配置了任何手势
+     */
+    bool HasTrigger(int trigger) const {
+        return IsValid(trigger) && masks_[trigger] != 0;
+    }
+
+    /**
+     * @brief 触发器的手势位掩码（位 n 对应 GestureType 取值 n）
+     */
+    uint32_t GetGestureMask(int trigger) const {
+        return IsValid(trigger) ? masks_[trigger] : 0;
+    }
+
+    /**
+     * @brief 触发器是否配置了滚动模拟
+     */
+    bool HasScroll(int trigger) const {
+        return (GetGestureMask(trigger) & Bit(GestureType::TWO_FINGER_SCROLL)) != 0;
+    }
+
+    /**
+     * @brief 触发器的滚动曲线（没有滚动规则时为默认曲线）
+     */
+    const ScrollProfile& GetScrollProfile(int trigger) const {
+        return scrollProfiles_[IsValid(trigger) ? trigger : 0];
+    }
+
+    /**
+     * @brief 触发器上一次性手势的最小阈值，没有一次性手势时返回 INT_MAX
+     */
+    int GetMinThreshold(int trigger) const;
+
+    /**
+     * @brief 最小阈值的平方，与整数距离平方比较，没有一次性手势时返回 INT64_MAX
+     */
+    int64_t GetMinThresholdSquared(int trigger) const {
+        return IsValid(trigger) ? minThresholdSq_[trigger] : INT64_MAX;
+    }
+
+    /**
+     * @brief 触发器是否配置了斜向滑动或含斜向笔画的序列（按 8 个扇区识别方向）
+     */
+    bool IsEightWay(int trigger) const {
+        return IsValid(trigger) && eightWay_[trigger];
+    }
+
+    /**
+     * @brief 触发器的方向滞回角度（SectorClassifier 角度单位）
+     */
+    int GetHysteresis(int trigger) const {
+        return IsValid(trigger) ? hysteresis_[trigger] : 0;
+    }
+
+    /**
+     * @brief 触发器上是否有启用了快速轻扫的规则
+     */
+    bool HasFlick(int trigger) const {
+        return IsValid(trigger) && minFlickDistance_[trigger] != INT_MAX;
+    }
+
+    /**
+     * @brief 触发器上快速轻扫规则的最小移动距离，没有时返回 INT_MAX
+     */
+    int GetMinFlickDistance(int trigger) const {
+        return IsValid(trigger) ? minFlickDistance_[trigger] : INT_MAX;
+    }
+
+    /**
+     * @brief 触发器上是否有启用了预测式提前提交的规则
+     */
+    bool HasEarlyCommit(int trigger) const {
+        return IsValid(trigger) && minCommitDistance_[trigger] != INT_MAX;
+    }
+
+    /**
+     * @brief 触发器上提前提交规则的最小移动距离，没有时返回 INT_MAX
+     */
+    int GetMinCommitDistance(int trigger) const {
+        return IsValid(trigger) ? minCommitDistance_[trigger] : INT_MAX;
+    }
+
+    /**
+     * @brief 触发器上是否有形状规则（有时一次性滑动手势推迟到释放时识别）
+     */
+    bool HasShapes(int trigger) const {
+        return (GetGestureMask(trigger) & Bit(GestureType::SHAPE)) != 0;
+    }
+
+    /**
+     * @brief 触发器上形状规则的最小笔画长度，没有时返回 INT_MAX
+     */
+    int GetMinShapeLength(int trigger) const {
+        return IsValid(trigger) ? minShapeLength_[trigger] : INT_MAX;
+    }
+
+    /**
+     * @brief 触发器的形状模板
+     */
+    const ShapeMatcher& GetShapeMatcher(int trigger) const {
+        return shapes_[IsValid(trigger) ? trigger : 0];
+    }
+
+    /**
+     * @brief 形状模板对应的规则，下标无效时返回 nullptr
+     */
+    const GestureConfig* GetShapeRule(int trigger, int index) const;
+
+    /**
+     * @brief 触发器上是否有多笔画序列规则
+     */
+    bool HasSequences(int trigger) const {
+        return (GetGestureMask(trigger) & Bit(GestureType::SEQUENCE)) != 0;
+    }
+
+    /**
+     * @brief 触发器上的一次性手势是否推迟到释放时识别（配置了形状或序列）
+     */
+    bool IsDeferred(int trigger) const {
+        return (GetGestureMask(trigger) & (Bit(GestureType::SHAPE) | Bit(GestureType::SEQUENCE))) != 0;
+    }
+
+    /**
+     * @brief 序列规则笔画最小长度的平方，没有序列规则时返回 INT64_MAX
+     */
+    int64_t GetMinStrokeLengthSquared(int trigger) const {
+        return IsValid(trigger) ? minStrokeLengthSq_[trigger] : INT64_MAX;
+    }
+
+    /**
+     * @brief 触发器的序列前缀树
+     */
+    const SequenceTrie& GetSequenceTrie(int trigger) const {
+        return sequences_[IsValid(trigger) ? trigger : 0];
+    }
+
+    /**
+     * @brief 序列前缀树节点上的规则下标对应的规则，下标无效时返回 nullptr
+     */
+    const GestureConfig* GetSequenceRule(int trigger, int index) const;
+
+    /**
+     * @brief 查找规则，不存在时返回 nullptr
+     */
+    const GestureConfig* Find(int trigger, GestureType gesture) const;
+
+    /**
+     * @brief 表中的规则数（去重后）
+     */
+    size_t GetRuleCount() const { return ruleCount_; }
+
+    static uint32_t Bit(GestureType gesture) { return 1u << static_cast<int>(gesture); }
+
+    /**
+     * @brief 阈值的平方（负阈值按 0 处理）
+     */
+    static int64_t ThresholdSquared(int threshold) {
+        int64_t t = threshold > 0 ? threshold : 0;
+        return t * t;
+    }
+
+private:
+    static bool IsButton(MouseButton button) {
+        return static_cast<unsigned>(button) < static_cast<unsigned>(kButtonCount);
+    }
+    static bool IsValid(int trigger) {
+        return static_cast<unsigned>(trigger) < static_cast<unsigned>(kTriggerCount);
+    }
+
+    /**
+     * @brief 规则的触发器下标，组合键在此分配；无效或组合键超出上限时返回 kNoTrigger
+     */
+    int AssignTrigger(const GestureConfig& config);
+
+    GestureConfig rules_[kTriggerCount][kGestureCount];
+    uint32_t masks_[kTriggerCount];
+    int minThreshold_[kTriggerCount];
+    int64_t minThresholdSq_[kTriggerCount];
+    int hysteresis_[kTriggerCount];
+    int minFlickDistance_[kTriggerCount];
+    int minCommitDistance_[kTriggerCount];
+    int minShapeLength_[kTriggerCount];
+    ScrollProfile scrollProfiles_[kTriggerCount];
+    ShapeMatcher shapes_[kTriggerCount];
+    std::vector<GestureConfig> shapeRules_[kTriggerCount];
+    int64_t minStrokeLengthSq_[kTriggerCount];
+    bool eightWay_[kTriggerCount];
+    SequenceTrie sequences_[kTriggerCount];
+    std::vector<GestureConfig> sequenceRules_[kTriggerCount];
+    MouseButton chordHolders_[kMaxChords];
+    MouseButton chordButtons_[kMaxChords];
+    int chordCount_;
+    uint32_t holderMask_;
+    size_t ruleCount_;
+};
+
+} // namespace WinMouseFix
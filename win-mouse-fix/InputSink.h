@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 底层输入注入接口
+ *
+ * ActionExecutor 把编译好的按键程序按时间标记分段，每段一次调用批量发出，
+ * 段与段之间的间隔由执行器调度。Windows 下由 WindowsActions 实现（每段一次 SendInput）。
+ * 文本和鼠标按钮只由宏（MacroInterpreter）使用。
+ * 接口方法只在执行线程中调用。
+ */
+class InputSink {
+public:
+    virtual ~InputSink() {}
+
+    /**
+     * @brief 批量发出按键事件（count 不超过 ActionProgram::kMaxEvents）
+     */
+    virtual void SendKeys(const KeyEvent* events, size_t count) = 0;
+
+    /**
+     * @brief 发送滚轮滚动（高分辨率滚轮单位，方向与 ActionSink::SimulateScroll 相同）
+     */
+    virtual void SendScroll(int deltaX, int deltaY) = 0;
+
+    /**
+     * @brief 输入文本（UTF-16 码元，不经过键盘布局）
+     */
+    virtual void SendText(const uint16_t* units, size_t count) = 0;
+
+    /**
+     * @brief 按下或释放鼠标按钮
+     */
+    virtual void SendButton(MouseButton button, bool down) = 0;
+};
+
+} // namespace WinMouseFix
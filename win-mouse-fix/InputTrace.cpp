@@ -0,0 +1,320 @@
+﻿#include "InputTrace.h"
+#include <chrono>
+#include <cstring>
+
+namespace WinMouseFix {
+
+namespace {
+
+const uint8_t kMagic[4] = {'W', 'M', 'F', 'T'};
+
+// 常见消息的紧凑索引，其余消息用 kRawMessageIndex 后跟原始值
+const uint32_t kMessageTable[] = {
+    TraceMessage::MOUSE_MOVE,
+    TraceMessage::LBUTTON_DOWN,
+    TraceMessage::LBUTTON_UP,
+    TraceMessage::RBUTTON_DOWN,
+    TraceMessage::RBUTTON_UP,
+    TraceMessage::MBUTTON_DOWN,
+    TraceMessage::MBUTTON_UP,
+    TraceMessage::MOUSE_WHEEL,
+    TraceMessage::XBUTTON_DOWN,
+    TraceMessage::XBUTTON_UP,
+    TraceMessage::MOUSE_HWHEEL,
+};
+const uint8_t kMessageCount = sizeof(kMessageTable) / sizeof(kMessageTable[0]);
+const uint8_t kRawMessageIndex = 0x0F;
+const uint8_t kHasMouseData = 0x10;
+const uint8_t kHasFlags = 0x20;
+
+inline size_t PutVarint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+inline bool GetVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (data == end) {
+            return false;
+        }
+        uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint32_t ZigZag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t UnZigZag(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// TraceEncoder / TraceDecoder
+// ---------------------------------------------------------------------------
+
+size_t TraceEncoder::EncodeHeader(uint8_t* out) {
+    memcpy(out, kMagic, 4);
+    out[4] = static_cast<uint8_t>(kVersion & 0xFF);
+    out[5] = static_cast<uint8_t>(kVersion >> 8);
+    out[6] = 0;
+    out[7] = 0;
+    return kHeaderSize;
+}
+
+void TraceEncoder::Reset() {
+    prevX_ = 0;
+    prevY_ = 0;
+    prevTime_ = 0;
+}
+
+size_t TraceEncoder::Encode(const TraceRecord& record, uint8_t* out) {
+    uint8_t index = kRawMessageIndex;
+    for (uint8_t i = 0; i < kMessageCount; ++i) {
+        if (kMessageTable[i] == record.message) {
+            index = i;
+            break;
+        }
+    }
+
+    uint8_t tag = index;
+    if (record.mouseData != 0) tag |= kHasMouseData;
+    if (record.flags != 0) tag |= kHasFlags;
+
+    size_t n = 0;
+    out[n++] = tag;
+    if (index == kRawMessageIndex) {
+        n += PutVarint(out + n, record.message);
+    }
+    n += PutVarint(out + n, ZigZag(record.x - prevX_));
+    n += PutVarint(out + n, ZigZag(record.y - prevY_));
+    n += PutVarint(out + n, record.time - prevTime_);
+    if (tag & kHasMouseData) {
+        n += PutVarint(out + n, record.mouseData);
+    }
+    if (tag & kHasFlags) {
+        n += PutVarint(out + n, record.flags);
+    }
+
+    prevX_ = record.x;
+    prevY_ = record.y;
+    prevTime_ = record.time;
+    return n;
+}
+
+bool TraceDecoder::DecodeHeader(const uint8_t* data, size_t size) {
+    if (size < TraceEncoder::kHeaderSize || memcmp(data, kMagic, 4) != 0) {
+        return false;
+    }
+    uint16_t version = static_cast<uint16_t>(data[4] | (data[5] << 8));
+    return version == TraceEncoder::kVersion;
+}
+
+void TraceDecoder::Reset() {
+    prevX_ = 0;
+    prevY_ = 0;
+    prevTime_ = 0;
+}
+
+bool TraceDecoder::Decode(const uint8_t*& data, const uint8_t* end, TraceRecord& record) {
+    const uint8_t* p = data;
+    if (p == end) {
+        return false;
+    }
+
+    uint8_t tag = *p++;
+    uint8_t index = tag & 0x0F;
+    if (index == kRawMessageIndex) {
+        if (!GetVarint(p, end, record.message)) return false;
+    } else if (index < kMessageCount) {
+        record.message = kMessageTable[index];
+    } else {
+        return false;
+    }
+
+    uint32_t dx, dy, dt;
+    if (!GetVarint(p, end, dx) || !GetVarint(p, end, dy) || !GetVarint(p, end, dt)) {
+        return false;
+    }
+    record.mouseData = 0;
+    record.flags = 0;
+    if ((tag & kHasMouseData) && !GetVarint(p, end, record.mouseData)) return false;
+    if ((tag & kHasFlags) && !GetVarint(p, end, record.flags)) return false;
+
+    record.x = prevX_ + UnZigZag(dx);
+    record.y = prevY_ + UnZigZag(dy);
+    record.time = prevTime_ + dt;
+
+    prevX_ = record.x;
+    prevY_ = record.y;
+    prevTime_ = record.time;
+    data = p;
+    return true;
+}
+
+bool ReadTraceFile(const std::string& path, std::vector<TraceRecord>& records) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!TraceDecoder::DecodeHeader(bytes.data(), bytes.size())) {
+        return false;
+    }
+
+    TraceDecoder decoder;
+    const uint8_t* p = bytes.data() + TraceEncoder::kHeaderSize;
+    const uint8_t* end = bytes.data() + bytes.size();
+    TraceRecord record;
+    while (p < end) {
+        if (!decoder.Decode(p, end, record)) {
+            // 录制被中断时最后一条记录可能不完整，保留已解码的部分
+            break;
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+bool TraceRecordToInputEvent(const TraceRecord& record, uint32_t startTime, int64_t baseUs, InputEvent& event) {
+    event.position = Point(record.x, record.y);
+    event.timestamp = record.time;
+    // 时间戳按 32 位回绕，差值仍然正确
+    event.hookTimeUs = baseUs + static_cast<int64_t>(record.time - startTime) * 1000;
+    event.flags = (record.flags & 0x01) ? InputEvent::FLAG_INJECTED : 0;  // LLMHF_INJECTED
+    event.button = MouseButton::UNKNOWN;
+
+    switch (record.message) {
+        case TraceMessage::MOUSE_MOVE:
+            event.type = InputEvent::MOVE;
+            return true;
+
+        case TraceMessage::XBUTTON_DOWN:
+        case TraceMessage::XBUTTON_UP:
+            event.type = (record.message == TraceMessage::XBUTTON_DOWN) ? InputEvent::BUTTON_DOWN : InputEvent::BUTTON_UP;
+            // HIWORD(mouseData) == XBUTTON1 为侧键 4
+            event.button = ((record.mouseData >> 16) == 1) ? MouseButton::BUTTON_4 : MouseButton::BUTTON_5;
+            return true;
+
+        case TraceMessage::MBUTTON_DOWN:
+        case TraceMessage::MBUTTON_UP:
+            event.type = (record.message == TraceMessage::MBUTTON_DOWN) ? InputEvent::BUTTON_DOWN : InputEvent::BUTTON_UP;
+            event.button = MouseButton::BUTTON_MIDDLE;
+            return true;
+
+        case TraceMessage::LBUTTON_DOWN:
+        case TraceMessage::LBUTTON_UP:
+            event.type = (record.message == TraceMessage::LBUTTON_DOWN) ? InputEvent::BUTTON_DOWN : InputEvent::BUTTON_UP;
+            event.button = MouseButton::BUTTON_LEFT;
+            return true;
+
+        case TraceMessage::RBUTTON_DOWN:
+        case TraceMessage::RBUTTON_UP:
+            event.type = (record.message == TraceMessage::RBUTTON_DOWN) ? InputEvent::BUTTON_DOWN : InputEvent::BUTTON_UP;
+            event.button = MouseButton::BUTTON_RIGHT;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TraceRecorder
+// ---------------------------------------------------------------------------
+
+TraceRecorder::TraceRecorder()
+    : running_(false)
+    , written_(0) {
+}
+
+TraceRecorder::~TraceRecorder() {
+    Stop();
+}
+
+bool TraceRecorder::Start(const std::string& path) {
+    if (running_) {
+        return false;
+    }
+
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    uint8_t header[TraceEncoder::kHeaderSize];
+    TraceEncoder::EncodeHeader(header);
+    file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    encoder_.Reset();
+    written_ = 0;
+    running_ = true;
+    writerThread_ = std::thread(&TraceRecorder::WriterThreadFunc, this);
+    return true;
+}
+
+void TraceRecorder::Stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        running_ = false;
+    }
+    stopCV_.notify_one();
+
+    if (writerThread_.joinable()) {
+        writerThread_.join();
+    }
+    file_.close();
+}
+
+void TraceRecorder::WriterThreadFunc() {
+    std::vector<uint8_t> buffer;
+    buffer.reserve(64 * 1024);
+
+    while (running_) {
+        Drain(buffer);
+
+        // 钩子线程从不通知写入线程，这里按固定间隔批量写出
+        std::unique_lock<std::mutex> lock(stopMutex_);
+        stopCV_.wait_for(lock, std::chrono::milliseconds(20), [this] { return !running_; });
+    }
+
+    Drain(buffer);
+    file_.flush();
+}
+
+void TraceRecorder::Drain(std::vector<uint8_t>& buffer) {
+    TraceRecord record;
+    uint64_t count = 0;
+    while (ring_.TryPop(record)) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + TraceEncoder::kMaxRecordSize);
+        buffer.resize(offset + encoder_.Encode(record, buffer.data() + offset));
+        ++count;
+    }
+
+    if (!buffer.empty()) {
+        file_.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        buffer.clear();
+        written_.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+} // namespace WinMouseFix
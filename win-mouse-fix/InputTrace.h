@@ -0,0 +1,189 @@
+﻿#pragma once
+
+#include "Common.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 原始钩子消息编号（与 Win32 WM_* 取值一致，核心代码不依赖 <windows.h>）
+ */
+namespace TraceMessage {
+    const uint32_t MOUSE_MOVE    = 0x0200;
+    const uint32_t LBUTTON_DOWN  = 0x0201;
+    const uint32_t LBUTTON_UP    = 0x0202;
+    const uint32_t RBUTTON_DOWN  = 0x0204;
+    const uint32_t RBUTTON_UP    = 0x0205;
+    const uint32_t MBUTTON_DOWN  = 0x0207;
+    const uint32_t MBUTTON_UP    = 0x0208;
+    const uint32_t MOUSE_WHEEL   = 0x020A;
+    const uint32_t XBUTTON_DOWN  = 0x020B;
+    const uint32_t XBUTTON_UP    = 0x020C;
+    const uint32_t MOUSE_HWHEEL  = 0x020E;
+}
+
+/**
+ * @brief 一条原始输入记录（对应一次 WH_MOUSE_LL 回调）
+ */
+struct TraceRecord {
+    uint32_t message;    // WM_* 消息
+    int32_t x;           // MSLLHOOKSTRUCT::pt
+    int32_t y;
+    uint32_t mouseData;  // MSLLHOOKSTRUCT::mouseData
+    uint32_t flags;      // MSLLHOOKSTRUCT::flags
+    uint32_t time;       // MSLLHOOKSTRUCT::time（毫秒，会回绕）
+};
+
+/**
+ * @brief 轨迹文件编码器
+ *
+ * 文件格式：8 字节文件头（"WMFT" + 版本号 + 保留），随后是逐条记录：
+ *   1 字节标记：低 4 位为消息索引（15 表示后跟 varint 原始消息），
+ *               bit4 表示带 mouseData，bit5 表示带 flags
+ *   坐标 x/y 相对上一条记录的增量（zigzag varint）
+ *   时间相对上一条记录的增量（varint，按 32 位回绕）
+ *   [mouseData varint] [flags varint]
+ * 典型的移动记录只占 4 字节。
+ */
+class TraceEncoder {
+public:
+    static const size_t kHeaderSize = 8;
+    static const size_t kMaxRecordSize = 1 + 5 * 6;
+    static const uint16_t kVersion = 1;
+
+    TraceEncoder() { Reset(); }
+
+    /**
+     * @brief 写入文件头，返回字节数（kHeaderSize）
+     */
+    static size_t EncodeHeader(uint8_t* out);
+
+    /**
+     * @brief 编码一条记录，返回写入的字节数（不超过 kMaxRecordSize）
+     */
+    size_t Encode(const TraceRecord& record, uint8_t* out);
+
+    /**
+     * @brief 清除增量编码的参考状态
+     */
+    void Reset();
+
+private:
+    int32_t prevX_;
+    int32_t prevY_;
+    uint32_t prevTime_;
+};
+
+/**
+ * @brief 轨迹文件解码器
+ */
+class TraceDecoder {
+public:
+    TraceDecoder() { Reset(); }
+
+    /**
+     * @brief 校验文件头
+     */
+    static bool DecodeHeader(const uint8_t* data, size_t size);
+
+    /**
+     * @brief 解码一条记录并前移 data
+     * @return 数据不完整或损坏时返回 false
+     */
+    bool Decode(const uint8_t*& data, const uint8_t* end, TraceRecord& record);
+
+    void Reset();
+
+private:
+    int32_t prevX_;
+    int32_t prevY_;
+    uint32_t prevTime_;
+};
+
+/**
+ * @brief 读取整个轨迹文件
+ */
+bool ReadTraceFile(const std::string& path, std::vector<TraceRecord>& records);
+
+/**
+ * @brief 将原始记录转换为识别器使用的输入事件
+ *
+ * 事件的 hookTimeUs 为 baseUs 加上录制时与 startTime 的间隔，回放时速度、时长等
+ * 与录制时一致，不受回放快慢影响。
+ * @param startTime 轨迹第一条记录的时间（毫秒，差值按 32 位回绕计算）
+ * @param baseUs 第一条记录对应的钩子时间（MonotonicMicros() 时间轴）
+ * @return 识别器不关心的消息（滚轮等）返回 false
+ */
+bool TraceRecordToInputEvent(const TraceRecord& record, uint32_t startTime, int64_t baseUs, InputEvent& event);
+
+/**
+ * @brief 轨迹录制器
+ *
+ * 钩子线程调用 Record() 把原始记录放入无锁环形队列（无等待、无分配，
+ * 队列满时丢弃并计数）；后台线程批量编码并写入文件。
+ */
+class TraceRecorder {
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * @brief 创建轨迹文件并启动写入线程
+     */
+    bool Start(const std::string& path);
+
+    /**
+     * @brief 写出剩余记录并关闭文件
+     */
+    void Stop();
+
+    bool IsRecording() const { return running_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 记录一条原始事件（仅钩子线程调用）
+     */
+    void Record(const TraceRecord& record) {
+        ring_.TryPush(record);
+    }
+
+    /**
+     * @brief 因队列满而丢弃的记录数
+     */
+    uint64_t GetDrops() const { return ring_.GetDrops(); }
+
+    /**
+     * @brief 已写入文件的记录数
+     */
+    uint64_t GetWrittenCount() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    void WriterThreadFunc();
+
+    /**
+     * @brief 编码队列中的所有记录并写入文件（写入线程）
+     */
+    void Drain(std::vector<uint8_t>& buffer);
+
+    static const size_t kRingCapacity = 4096;
+
+    SpscRing<TraceRecord, kRingCapacity> ring_;
+    TraceEncoder encoder_;
+    std::ofstream file_;
+    std::thread writerThread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCV_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> written_;
+};
+
+} // namespace WinMouseFix
@@ -0,0 +1,217 @@
+﻿#include "LatencyTrace.h"
+#include <cstdio>
+#include <fstream>
+
+namespace WinMouseFix {
+
+namespace {
+
+const char* const kStageNames[kLatencyStageCount] = {
+    "hook callback",
+    "queue wait",
+    "recognition",
+    "action queue",
+    "injection",
+    "end to end",
+};
+
+#if WMF_LATENCY_TRACE
+// 静态存储：程序启动时构造，之后记录与查询都不分配内存
+LatencyHistogram g_histograms[kLatencyStageCount];
+#endif
+
+// 最高置位的位置（value > 0），二分查找，分支数固定
+inline int HighestBit(uint64_t value) {
+    int bit = 0;
+    for (int step = 32; step > 0; step >>= 1) {
+        if (value >> step) {
+            value >>= step;
+            bit += step;
+        }
+    }
+    return bit;
+}
+
+} // namespace
+
+const char* LatencyStageName(LatencyStage stage) {
+    const int index = static_cast<int>(stage);
+    return index >= 0 && index < kLatencyStageCount ? kStageNames[index] : "unknown";
+}
+
+LatencyHistogram::LatencyHistogram()
+    : count_(0)
+    , sumNs_(0)
+    , minNs_(INT64_MAX)
+    , maxNs_(0) {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::BucketIndex(int64_t valueNs) {
+    if (valueNs < kSubBucketCount) {
+        return valueNs < 0 ? 0 : static_cast<int>(valueNs);
+    }
+    // 最高位决定区间，其后 kSubBucketBits 位决定子桶
+    const int shift = HighestBit(static_cast<uint64_t>(valueNs)) - kSubBucketBits;
+    if (shift > kMaxShift) {
+        return kBucketCount - 1;
+    }
+    return (shift + 1) * kSubBucketCount + static_cast<int>((valueNs >> shift) & (kSubBucketCount - 1));
+}
+
+int64_t LatencyHistogram::BucketLowerBound(int index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    const int shift = index / kSubBucketCount - 1;
+    return static_cast<int64_t>(kSubBucketCount + index % kSubBucketCount) << shift;
+}
+
+int64_t LatencyHistogram::BucketUpperBound(int index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    const int shift = index / kSubBucketCount - 1;
+    return BucketLowerBound(index) + (static_cast<int64_t>(1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t valueNs) {
+    if (valueNs < 0) {
+        valueNs = 0;
+    }
+    buckets_[BucketIndex(valueNs)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sumNs_.fetch_add(valueNs, std::memory_order_relaxed);
+
+    int64_t current = maxNs_.load(std::memory_order_relaxed);
+    while (valueNs > current && !maxNs_.compare_exchange_weak(current, valueNs, std::memory_order_relaxed)) {
+    }
+    current = minNs_.load(std::memory_order_relaxed);
+    while (valueNs < current && !minNs_.compare_exchange_weak(current, valueNs, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t LatencyHistogram::GetPercentile(double fraction) const {
+    const uint64_t count = GetCount();
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(fraction * count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    const int64_t maximum = maxNs_.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += GetBucket(i);
+        if (seen >= target) {
+            const int64_t upper = BucketUpperBound(i);
+            return upper < maximum ? upper : maximum;
+        }
+    }
+    return maximum;
+}
+
+LatencyHistogram::Summary LatencyHistogram::GetSummary() const {
+    Summary summary;
+    summary.count = GetCount();
+    summary.minNs = summary.count > 0 ? minNs_.load(std::memory_order_relaxed) : 0;
+    summary.maxNs = maxNs_.load(std::memory_order_relaxed);
+    summary.meanNs = summary.count > 0 ? static_cast<double>(sumNs_.load(std::memory_order_relaxed)) / summary.count : 0.0;
+    summary.p50Ns = GetPercentile(0.50);
+    summary.p90Ns = GetPercentile(0.90);
+    summary.p99Ns = GetPercentile(0.99);
+    summary.p999Ns = GetPercentile(0.999);
+    return summary;
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sumNs_.store(0, std::memory_order_relaxed);
+    minNs_.store(INT64_MAX, std::memory_order_relaxed);
+    maxNs_.store(0, std::memory_order_relaxed);
+}
+
+#if WMF_LATENCY_TRACE
+
+void LatencyTrace::Record(LatencyStage stage, int64_t startNs, int64_t endNs) {
+    g_histograms[static_cast<int>(stage)].Record(endNs - startNs);
+}
+
+const LatencyHistogram& LatencyTrace::Get(LatencyStage stage) {
+    return g_histograms[static_cast<int>(stage)];
+}
+
+void LatencyTrace::Reset() {
+    for (auto& histogram : g_histograms) {
+        histogram.Reset();
+    }
+}
+
+std::string LatencyTrace::Format() {
+    std::string text;
+    char line[192];
+    for (int i = 0; i < kLatencyStageCount; ++i) {
+        const LatencyHistogram::Summary s = g_histograms[i].GetSummary();
+        if (s.count == 0) {
+            snprintf(line, sizeof(line), "%-14s n=0\n", kStageNames[i]);
+        } else {
+            snprintf(line, sizeof(line),
+                     "%-14s n=%-8llu mean %9.1f us  p50 %9.1f  p90 %9.1f  p99 %9.1f  p999 %9.1f  max %9.1f us\n",
+                     kStageNames[i], static_cast<unsigned long long>(s.count), s.meanNs / 1000.0,
+                     s.p50Ns / 1000.0, s.p90Ns / 1000.0, s.p99Ns / 1000.0, s.p999Ns / 1000.0, s.maxNs / 1000.0);
+        }
+        text += line;
+    }
+    return text;
+}
+
+bool LatencyTrace::DumpToFile(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << Format() << "\n# stage, lower_ns, upper_ns, count\n";
+    for (int i = 0; i < kLatencyStageCount; ++i) {
+        for (int b = 0; b < LatencyHistogram::kBucketCount; ++b) {
+            const uint64_t count = g_histograms[i].GetBucket(b);
+            if (count > 0) {
+                file << kStageNames[i] << ", " << LatencyHistogram::BucketLowerBound(b) << ", "
+                     << LatencyHistogram::BucketUpperBound(b) << ", " << count << '\n';
+            }
+        }
+    }
+    return file.good();
+}
+
+#else
+
+void LatencyTrace::Record(LatencyStage, int64_t, int64_t) {
+}
+
+const LatencyHistogram& LatencyTrace::Get(LatencyStage) {
+    static const LatencyHistogram empty;
+    return empty;
+}
+
+void LatencyTrace::Reset() {
+}
+
+std::string LatencyTrace::Format() {
+    return "latency tracing is compiled out (WMF_LATENCY_TRACE=0)\n";
+}
+
+bool LatencyTrace::DumpToFile(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    file << Format();
+    return file.good();
+}
+
+#endif
+
+} // namespace WinMouseFix
@@ -0,0 +1,158 @@
+﻿#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <string>
+
+// 端到端延迟统计开关：CMake 选项 WMF_LATENCY_TRACE（默认开启），定义为 0 时所有埋点编译为空
+#ifndef WMF_LATENCY_TRACE
+#define WMF_LATENCY_TRACE 1
+#endif
+
+namespace WinMouseFix {
+
+/**
+ * @brief 延迟统计的阶段
+ *
+ * 从一次鼠标事件到按键注入完成：
+ *   HOOK_CALLBACK  钩子回调入口到返回（MouseHook::HandleHook）
+ *   QUEUE_WAIT     事件入队（钩子入口时间）到工作线程取出
+ *   RECOGNITION    触发事件的钩子入口到手势提交
+ *   ACTION_QUEUE   手势提交到执行线程开始执行该动作
+ *   INJECTION      一次注入调用（SendInput / write）的耗时
+ *   END_TO_END     触发事件的钩子入口到按下段注入完成（系统已收到按键）
+ * 以钩子入口为起点的阶段沿用事件的微秒时间戳，精度为 1 微秒；其余阶段为纳秒。
+ */
+enum class LatencyStage {
+    HOOK_CALLBACK,
+    QUEUE_WAIT,
+    RECOGNITION,
+    ACTION_QUEUE,
+    INJECTION,
+    END_TO_END
+};
+
+const int kLatencyStageCount = static_cast<int>(LatencyStage::END_TO_END) + 1;
+
+const char* LatencyStageName(LatencyStage stage);
+
+/**
+ * @brief 高精度单调时钟（纳秒），与 MonotonicMicros() 同源
+ */
+inline int64_t MonotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief HDR 风格的对数-线性直方图（纳秒）
+ *
+ * 每个 2 的幂区间再均分为 32 个子桶，相对误差约 3%，可记录到约 18 分钟。
+ * 桶与统计量都是原子计数：Record() 无锁、不分配内存，可在任意线程（包括钩子线程）调用；
+ * 读取方得到的是近似一致的快照。
+ */
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 5;
+    static const int kSubBucketCount = 1 << kSubBucketBits;
+    static const int kMaxShift = 35;
+    static const int kBucketCount = (kMaxShift + 2) * kSubBucketCount;
+
+    struct Summary {
+        uint64_t count;
+        int64_t minNs;
+        int64_t maxNs;
+        double meanNs;
+        int64_t p50Ns;
+        int64_t p90Ns;
+        int64_t p99Ns;
+        int64_t p999Ns;
+    };
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(int64_t valueNs);
+
+    /**
+     * @brief 百分位数（0~1），返回所在桶的上界（不超过最大值）
+     */
+    int64_t GetPercentile(double fraction) const;
+
+    Summary GetSummary() const;
+
+    uint64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 第 index 个桶的计数
+     */
+    uint64_t GetBucket(int index) const { return buckets_[index].load(std::memory_order_relaxed); }
+
+    void Reset();
+
+    static int BucketIndex(int64_t valueNs);
+    static int64_t BucketLowerBound(int index);
+    static int64_t BucketUpperBound(int index);
+
+private:
+    std::atomic<uint64_t> buckets_[kBucketCount];
+    std::atomic<uint64_t> count_;
+    std::atomic<int64_t> sumNs_;
+    std::atomic<int64_t> minNs_;
+    std::atomic<int64_t> maxNs_;
+};
+
+/**
+ * @brief 进程内各阶段的延迟直方图
+ *
+ * 直方图是静态存储，埋点只做几次原子加法；运行时可随时查询、格式化或写入文件。
+ * WMF_LATENCY_TRACE 为 0 时不记录，Format() 只返回一行说明。
+ */
+class LatencyTrace {
+public:
+    static void Record(LatencyStage stage, int64_t startNs, int64_t endNs);
+
+    static const LatencyHistogram& Get(LatencyStage stage);
+
+    static void Reset();
+
+    /**
+     * @brief 各阶段的次数与百分位数，每个阶段一行
+     */
+    static std::string Format();
+
+    /**
+     * @brief 写入 Format() 的内容与各阶段非空桶的明细（下界、上界、计数），便于离线分析
+     */
+    static bool DumpToFile(const std::string& path);
+};
+
+/**
+ * @brief 作用域计时：构造到析构的耗时记入指定阶段（用于有多个返回点的函数）
+ */
+class LatencyScope {
+public:
+#if WMF_LATENCY_TRACE
+    explicit LatencyScope(LatencyStage stage) : stage_(stage), startNs_(MonotonicNanos()) {}
+    ~LatencyScope() { LatencyTrace::Record(stage_, startNs_, MonotonicNanos()); }
+
+private:
+    LatencyStage stage_;
+    int64_t startNs_;
+#else
+    explicit LatencyScope(LatencyStage) {}
+#endif
+};
+
+} // namespace WinMouseFix
+
+#if WMF_LATENCY_TRACE
+#define WMF_LATENCY_NOW() ::WinMouseFix::MonotonicNanos()
+#define WMF_LATENCY_RECORD(stage, startNs, endNs) \
+    ::WinMouseFix::LatencyTrace::Record(::WinMouseFix::LatencyStage::stage, (startNs), (endNs))
+#else
+#define WMF_LATENCY_NOW() (static_cast<int64_t>(0))
+#define WMF_LATENCY_RECORD(stage, startNs, endNs) ((void)(startNs), (void)(endNs))
+#endif
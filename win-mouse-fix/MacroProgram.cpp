@@ -0,0 +1,347 @@
+﻿#include "MacroProgram.h"
+#include "ActionProgram.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace WinMouseFix {
+
+namespace {
+
+const size_t kMaxTextUnits = 255;   // 一条 TEXT 指令最多的码元数，更长的文本拆成多条
+
+struct ButtonName {
+    const char* name;
+    MouseButton button;
+};
+
+const ButtonName kButtonNames[] = {
+    {"left", MouseButton::BUTTON_LEFT},
+    {"right", MouseButton::BUTTON_RIGHT},
+    {"middle", MouseButton::BUTTON_MIDDLE},
+    {"button4", MouseButton::BUTTON_4},
+    {"button5", MouseButton::BUTTON_5},
+};
+
+std::string ToLower(const std::string& text) {
+    std::string result = text;
+    for (auto& c : result) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return result;
+}
+
+std::string Trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+bool ParseInt(const std::string& text, long minimum, long maximum, long& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtol(text.c_str(), &end, 10);
+    return *end == '\0' && value >= minimum && value <= maximum;
+}
+
+// 单个键：热键语法中不带修饰键组合的名称，如 "Ctrl"、"A"、"F5"
+bool ParseSingleKey(const std::string& text, uint16_t& key) {
+    KeyChord chord;
+    if (!ParseHotkey(text, chord) || chord.modifierCount != 0 || chord.key > 0xFF) {
+        return false;
+    }
+    key = chord.key;
+    return true;
+}
+
+bool ParseButton(const std::string& text, MouseButton& button) {
+    const std::string name = ToLower(text);
+    for (const auto& entry : kButtonNames) {
+        if (name == entry.name) {
+            button = entry.button;
+            return true;
+        }
+    }
+    return false;
+}
+
+// UTF-8 -> UTF-16，非法序列返回 false
+bool DecodeUtf8(const std::string& text, std::vector<uint16_t>& units) {
+    size_t i = 0;
+    while (i < text.size()) {
+        const unsigned char lead = static_cast<unsigned char>(text[i]);
+        uint32_t codePoint;
+        size_t length;
+        if (lead < 0x80) {
+            codePoint = lead;
+            length = 1;
+        } else if ((lead & 0xE0) == 0xC0) {
+            codePoint = lead & 0x1F;
+            length = 2;
+        } else if ((lead & 0xF0) == 0xE0) {
+            codePoint = lead & 0x0F;
+            length = 3;
+        } else if ((lead & 0xF8) == 0xF0) {
+            codePoint = lead & 0x07;
+            length = 4;
+        } else {
+            return false;
+        }
+        if (i + length > text.size()) {
+            return false;
+        }
+        for (size_t k = 1; k < length; ++k) {
+            const unsigned char next = static_cast<unsigned char>(text[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                return false;
+            }
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+        if (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            return false;
+        }
+        if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            units.push_back(static_cast<uint16_t>(0xD800 + (codePoint >> 10)));
+            units.push_back(static_cast<uint16_t>(0xDC00 + (codePoint & 0x3FF)));
+        } else {
+            units.push_back(static_cast<uint16_t>(codePoint));
+        }
+        i += length;
+    }
+    return true;
+}
+
+void Emit16(MacroCode& code, uint16_t value) {
+    code.push_back(static_cast<uint8_t>(value & 0xFF));
+    code.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline uint16_t Read16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief 编译一个步骤，追加到 code
+ */
+bool CompileStep(const std::string& step, MacroCode& code) {
+    const size_t first = step.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return false;
+    }
+    const size_t space = step.find_first_of(" \t", first);
+    const std::string name = ToLower(step.substr(first, space == std::string::npos ? std::string::npos : space - first));
+    // 文本保留原样（只去掉步骤名后的一个分隔符），其余参数去掉首尾空白
+    const std::string raw = space == std::string::npos ? std::string() : step.substr(space + 1);
+    const std::string argument = Trim(raw);
+
+    uint16_t key = 0;
+    long value = 0;
+    MouseButton button = MouseButton::UNKNOWN;
+    if ((name == "down" || name == "up") && ParseSingleKey(argument, key)) {
+        code.push_back(name == "down" ? MacroOp::KEY_DOWN : MacroOp::KEY_UP);
+        code.push_back(static_cast<uint8_t>(key));
+    } else if (name == "key") {
+        KeyChord chord;
+        if (!ParseHotkey(argument, chord) || chord.key > 0xFF) {
+            return false;
+        }
+        // 与内置动作相同的时间表：按下，保持，逆序释放
+        const ActionProgram program = CompileActionProgram(ActionType::MACRO, chord);
+        for (int i = 0; i < program.eventCount; ++i) {
+            if (i == program.pressCount) {
+                code.push_back(MacroOp::HOLD);
+            }
+            code.push_back(program.events[i].down ? MacroOp::KEY_DOWN : MacroOp::KEY_UP);
+            code.push_back(static_cast<uint8_t>(program.events[i].key));
+        }
+    } else if (name == "text") {
+        std::vector<uint16_t> units;
+        if (raw.empty() || !DecodeUtf8(raw, units)) {
+            return false;
+        }
+        for (size_t offset = 0; offset < units.size(); offset += kMaxTextUnits) {
+            const size_t count = units.size() - offset < kMaxTextUnits ? units.size() - offset : kMaxTextUnits;
+            code.push_back(MacroOp::TEXT);
+            code.push_back(static_cast<uint8_t>(count));
+            for (size_t i = 0; i < count; ++i) {
+                Emit16(code, units[offset + i]);
+            }
+        }
+    } else if ((name == "wheel" || name == "hwheel") && ParseInt(argument, -32768, 32767, value) && value != 0) {
+        code.push_back(MacroOp::WHEEL);
+        Emit16(code, static_cast<uint16_t>(name == "hwheel" ? value : 0));
+        Emit16(code, static_cast<uint16_t>(name == "wheel" ? value : 0));
+    } else if (name == "click" && ParseButton(argument, button)) {
+        code.push_back(MacroOp::BUTTON_DOWN);
+        code.push_back(static_cast<uint8_t>(button));
+        code.push_back(MacroOp::BUTTON_UP);
+        code.push_back(static_cast<uint8_t>(button));
+    } else if (name == "wait" && ParseInt(argument, 0, kMaxMacroWaitMs, value)) {
+        code.push_back(MacroOp::WAIT);
+        Emit16(code, static_cast<uint16_t>(value));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool CompileMacro(const std::vector<std::string>& steps, MacroCode& code, std::string& error) {
+    code.clear();
+    if (steps.empty()) {
+        error = "宏没有步骤";
+        return false;
+    }
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (!CompileStep(steps[i], code)) {
+            error = "宏的第 " + std::to_string(i + 1) + " 步 \"" + steps[i] + "\" 无效";
+            return false;
+        }
+        if (code.size() >= kMaxMacroCodeSize) {
+            error = "宏太长";
+            return false;
+        }
+    }
+    code.push_back(MacroOp::END);
+    code.shrink_to_fit();
+    return true;
+}
+
+MacroInterpreter::MacroInterpreter()
+    : pc_(0)
+    , deadlineUs_(0)
+    , batch_()
+    , batchCount_(0)
+    , heldKeys_()
+    , heldKeyCount_(0)
+    , heldButtons_(0)
+    , keyEvents_(0) {
+}
+
+void MacroInterpreter::Start(const std::shared_ptr<const MacroCode>& code, int64_t nowUs) {
+    code_ = code;
+    pc_ = 0;
+    deadlineUs_ = nowUs;
+    batchCount_ = 0;
+    heldKeyCount_ = 0;
+    heldButtons_ = 0;
+}
+
+void MacroInterpreter::Flush(InputSink* output) {
+    if (batchCount_ > 0) {
+        output->SendKeys(batch_, batchCount_);
+        keyEvents_ += batchCount_;
+        batchCount_ = 0;
+    }
+}
+
+bool MacroInterpreter::Run(int64_t nowUs, int64_t holdUs, InputSink* output) {
+    if (!code_ || nowUs < deadlineUs_) {
+        return code_ != nullptr;
+    }
+
+    const uint8_t* code = code_->data();
+    const size_t size = code_->size();
+    while (pc_ < size) {
+        const uint8_t op = code[pc_];
+        if ((op != MacroOp::KEY_DOWN && op != MacroOp::KEY_UP) || batchCount_ == ActionProgram::kMaxEvents) {
+            Flush(output);
+        }
+
+        switch (op) {
+            case MacroOp::KEY_DOWN:
+            case MacroOp::KEY_UP: {
+                const uint16_t key = code[pc_ + 1];
+                const bool down = op == MacroOp::KEY_DOWN;
+                batch_[batchCount_++] = {key, down};
+                // 记录仍按下的键，结束或取消时释放
+                int index = 0;
+                while (index < heldKeyCount_ && heldKeys_[index] != key) {
+                    ++index;
+                }
+                if (down && index == heldKeyCount_ && heldKeyCount_ < kMaxHeldKeys) {
+                    heldKeys_[heldKeyCount_++] = key;
+                } else if (!down && index < heldKeyCount_) {
+                    heldKeys_[index] = heldKeys_[--heldKeyCount_];
+                }
+                pc_ += 2;
+                break;
+            }
+            case MacroOp::TEXT: {
+                uint16_t units[kMaxTextUnits];
+                const size_t count = code[pc_ + 1];
+                for (size_t i = 0; i < count; ++i) {
+                    units[i] = Read16(code + pc_ + 2 + i * 2);
+                }
+                output->SendText(units, count);
+                pc_ += 2 + count * 2;
+                break;
+            }
+            case MacroOp::WHEEL:
+                output->SendScroll(static_cast<int16_t>(Read16(code + pc_ + 1)),
+                                   static_cast<int16_t>(Read16(code + pc_ + 3)));
+                pc_ += 5;
+                break;
+            case MacroOp::BUTTON_DOWN:
+            case MacroOp::BUTTON_UP: {
+                const uint8_t button = code[pc_ + 1];
+                const bool down = op == MacroOp::BUTTON_DOWN;
+                output->SendButton(static_cast<MouseButton>(button), down);
+                heldButtons_ = down ? (heldButtons_ | (1u << button)) : (heldButtons_ & ~(1u << button));
+                pc_ += 2;
+                break;
+            }
+            case MacroOp::WAIT:
+                // 等待从实际执行的时刻算起，线程晚醒时不会压缩后面的间隔
+                deadlineUs_ = nowUs + static_cast<int64_t>(Read16(code + pc_ + 1)) * 1000;
+                pc_ += 3;
+                return true;
+            case MacroOp::HOLD:
+                deadlineUs_ = nowUs + holdUs;
+                pc_ += 1;
+                return true;
+            default:
+                pc_ = size;
+                break;
+        }
+    }
+
+    Finish(output);
+    return false;
+}
+
+void MacroInterpreter::Cancel(InputSink* output) {
+    if (code_) {
+        Finish(output);
+    }
+}
+
+void MacroInterpreter::Finish(InputSink* output) {
+    Flush(output);
+
+    // 逆序释放仍按下的键与按钮
+    while (heldKeyCount_ > 0) {
+        batch_[batchCount_++] = {heldKeys_[--heldKeyCount_], false};
+        if (batchCount_ == ActionProgram::kMaxEvents) {
+            Flush(output);
+        }
+    }
+    Flush(output);
+    for (uint8_t button = 0; heldButtons_ != 0; ++button) {
+        if (heldButtons_ & (1u << button)) {
+            output->SendButton(static_cast<MouseButton>(button), false);
+            heldButtons_ &= ~(1u << button);
+        }
+    }
+    code_.reset();
+    pc_ = 0;
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include "InputSink.h"
+#include <string>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 宏字节码的操作码
+ *
+ * 每条指令 1 字节操作码加定长或带长度的操作数，多字节整数为小端序：
+ *   KEY_DOWN / KEY_UP      键码 (u8)
+ *   TEXT                   码元数 n (u8)，n 个 UTF-16 码元 (u16)
+ *   WHEEL                  水平 (i16)、垂直 (i16) 滚动量，高分辨率滚轮单位
+ *   BUTTON_DOWN / BUTTON_UP  MouseButton (u8)
+ *   WAIT                   毫秒 (u16)
+ *   HOLD                   无操作数，等待执行器的按键保持时间
+ */
+namespace MacroOp {
+    const uint8_t END         = 0;
+    const uint8_t KEY_DOWN    = 1;
+    const uint8_t KEY_UP      = 2;
+    const uint8_t TEXT        = 3;
+    const uint8_t WHEEL       = 4;
+    const uint8_t BUTTON_DOWN = 5;
+    const uint8_t BUTTON_UP   = 6;
+    const uint8_t WAIT        = 7;
+    const uint8_t HOLD        = 8;
+}
+
+const size_t kMaxMacroCodeSize = 4096;  // 一个宏的字节码上限
+const int kMaxMacroWaitMs = 60000;      // 单个 wait 步骤的上限
+
+/**
+ * @brief 把宏步骤编译为字节码（加载配置时调用）
+ *
+ * 每个步骤一个字符串，步骤名不区分大小写：
+ *   "down Ctrl" / "up Ctrl"    按下 / 释放一个键（键名同热键）
+ *   "key Ctrl+Shift+T"         点按热键：按下，保持，逆序释放
+ *   "text 你好, world"         输入文本（步骤名后第一个空格之后的全部内容）
+ *   "wheel -120" / "hwheel 120" 垂直 / 水平滚动，120 为一格
+ *   "click Left"               点击鼠标按钮（Left、Right、Middle、Button4、Button5）
+ *   "wait 200"                 等待毫秒数
+ * @return 有无法识别的步骤时返回 false，error 为原因
+ */
+bool CompileMacro(const std::vector<std::string>& steps, MacroCode& code, std::string& error);
+
+/**
+ * @brief 宏解释器 - 在执行线程中逐条执行字节码，遇到等待就返回，不阻塞
+ *
+ * 连续的按键指令合并为一次 InputSink::SendKeys。等待以截止时间表示：Run() 执行到
+ * 下一个等待或结束，调用方在 GetDeadline() 之前不必再调用。宏结束或被取消时，
+ * 仍按下的键和鼠标按钮会被释放，不会留下卡住的修饰键。
+ */
+class MacroInterpreter {
+public:
+    static const int kMaxHeldKeys = 16;
+
+    MacroInterpreter();
+
+    /**
+     * @brief 开始执行一个宏（之前的宏必须已结束或取消）
+     */
+    void Start(const std::shared_ptr<const MacroCode>& code, int64_t nowUs);
+
+    /**
+     * @brief 执行到下一个等待或结束
+     * @param holdUs HOLD 指令的等待时间
+     * @return 宏仍在运行时返回 true
+     */
+    bool Run(int64_t nowUs, int64_t holdUs, InputSink* output);
+
+    /**
+     * @brief 中止当前宏并释放仍按下的键和按钮
+     */
+    void Cancel(InputSink* output);
+
+    bool IsRunning() const { return code_ != nullptr; }
+    bool IsHolding() const { return heldKeyCount_ > 0 || heldButtons_ != 0; }
+    const MacroCode* GetCode() const { return code_.get(); }
+    int64_t GetDeadline() const { return deadlineUs_; }
+
+    /**
+     * @brief 累计发出的按键事件数（含释放时补发的）
+     */
+    uint64_t GetKeyEvents() const { return keyEvents_; }
+
+private:
+    void Flush(InputSink* output);
+    void Finish(InputSink* output);
+
+    std::shared_ptr<const MacroCode> code_;
+    size_t pc_;
+    int64_t deadlineUs_;
+
+    // 待发出的连续按键
+    KeyEvent batch_[ActionProgram::kMaxEvents];
+    size_t batchCount_;
+
+    // 仍按下的键与按钮（结束或取消时释放）
+    uint16_t heldKeys_[kMaxHeldKeys];
+    int heldKeyCount_;
+    uint32_t heldButtons_;
+
+    uint64_t keyEvents_;
+};
+
+} // namespace WinMouseFix
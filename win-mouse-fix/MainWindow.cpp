@@ -1,6 +1,9 @@
 ﻿#include "MainWindow.h"
+#include "ActionProgram.h"
 #include "ConfigManager.h"
+#include "ConfigWatcher.h"
 #include "MouseHook.h"
+#include "SequenceTrie.h"
 #include "TrayIcon.h"
 #include <windowsx.h>
 #include <sstream>
@@ -20,6 +23,7 @@ MainWindow::MainWindow()
     , editButton_(nullptr)
     , aboutButton_(nullptr)
     , configManager_(nullptr)
+    , configWatcher_(nullptr)
     , mouseHook_(nullptr)
     , trayIcon_(nullptr) {
 }
@@ -213,13 +217,22 @@ void MainWindow::LoadConfigToUI() {
     SendMessage(configListBox_, LB_RESETCONTENT, 0, 0);
 
     // 添加配置项
+    auto buttonName = [](MouseButton button) -> std::wstring {
+        switch (button) {
+            case MouseButton::BUTTON_4: return L"按钮4";
+            case MouseButton::BUTTON_5: return L"按钮5";
+            case MouseButton::BUTTON_MIDDLE: return L"中键";
+            case MouseButton::BUTTON_LEFT: return L"左键";
+            case MouseButton::BUTTON_RIGHT: return L"右键";
+            default: return L"按钮";
+        }
+    };
     const auto& configs = configManager_->GetGestureConfigs();
     for (const auto& config : configs) {
-        std::wstring buttonStr = L"按钮";
-        if (config.triggerButton == MouseButton::BUTTON_4) {
-            buttonStr += L"4";
-        } else if (config.triggerButton == MouseButton::BUTTON_5) {
-            buttonStr += L"5";
+        // 组合键显示为 "按钮4+左键"
+        std::wstring buttonStr = buttonName(config.triggerButton);
+        if (config.holdButton != MouseButton::UNKNOWN) {
+            buttonStr = buttonName(config.holdButton) + L"+" + buttonStr;
         }
 
         std::wstring gestureStr;
@@ -228,7 +241,21 @@ void MainWindow::LoadConfigToUI() {
             case GestureType::SWIPE_DOWN: gestureStr = L"向下滑动"; break;
             case GestureType::SWIPE_LEFT: gestureStr = L"向左滑动"; break;
             case GestureType::SWIPE_RIGHT: gestureStr = L"向右滑动"; break;
+            case GestureType::SWIPE_UP_LEFT: gestureStr = L"向左上滑动"; break;
+            case GestureType::SWIPE_UP_RIGHT: gestureStr = L"向右上滑动"; break;
+            case GestureType::SWIPE_DOWN_LEFT: gestureStr = L"向左下滑动"; break;
+            case GestureType::SWIPE_DOWN_RIGHT: gestureStr = L"向右下滑动"; break;
             case GestureType::TWO_FINGER_SCROLL: gestureStr = L"移动"; break;
+            case GestureType::SHAPE: gestureStr = L"形状 " + StringToWString(config.shapeName); break;
+            case GestureType::SEQUENCE: {
+                static const wchar_t kArrows[] = L"↑↓←→↖↗↙↘";
+                gestureStr = L"序列 ";
+                for (GestureType stroke : config.sequence) {
+                    int index = SequenceTrie::DirectionIndex(stroke);
+                    gestureStr += (index >= 0) ? kArrows[index] : L'?';
+                }
+                break;
+            }
             default: gestureStr = L"未知"; break;
         }
 
@@ -239,6 +266,8 @@ void MainWindow::LoadConfigToUI() {
             case ActionType::SWITCH_DESKTOP_LEFT: actionStr = L"切换到左边桌面"; break;
             case ActionType::SWITCH_DESKTOP_RIGHT: actionStr = L"切换到右边桌面"; break;
             case ActionType::SCROLL_SIMULATION: actionStr = L"滚动模拟"; break;
+            case ActionType::CUSTOM_HOTKEY: actionStr = L"热键 " + StringToWString(FormatHotkey(config.hotkey)); break;
+            case ActionType::MACRO: actionStr = L"宏 (" + std::to_wstring(config.macroSteps.size()) + L" 步)"; break;
             default: actionStr = L"未知"; break;
         }
 
@@ -247,6 +276,29 @@ void MainWindow::LoadConfigToUI() {
     }
 }
 
+void MainWindow::OnConfigReloaded() {
+    if (!configWatcher_) return;
+
+    ConfigWatcher::ReloadResult result = configWatcher_->GetLastResult();
+    wchar_t buf[512];
+    if (result.success) {
+        // 识别器已在监视线程中切换到新规则，这里只同步界面显示的副本
+        if (configManager_) {
+            configManager_->SetGestureConfigs(result.configs);
+        }
+        LoadConfigToUI();
+        swprintf_s(buf, L"配置已重新加载：%zu 条规则，解析 %.1f ms，生效 %.2f ms",
+                   result.configs.size(), result.parseMs, result.applyMs);
+    } else {
+        swprintf_s(buf, L"配置重新加载失败（仍使用之前的配置）：%s",
+                   StringToWString(result.error).c_str());
+    }
+
+    if (statusLabel_) {
+        SetWindowText(statusLabel_, buf);
+    }
+}
+
 void MainWindow::Show() {
     ShowWindow(hwnd_, SW_SHOW);
     UpdateWindow(hwnd_);
@@ -293,6 +345,10 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
             OnCommand(wParam);
             return 0;
         
+        case WM_CONFIG_RELOADED:
+            OnConfigReloaded();
+            return 0;
+
         case WM_TRAYICON:
             // 转发托盘消息到托盘图标处理
             if (trayIcon_) {
@@ -1,12 +1,13 @@
 ﻿#pragma once
 
-#include "Common.h"
+#include "WinCommon.h"
 #include <string>
 #include <vector>
 
 namespace WinMouseFix {
 
 class ConfigManager;
+class ConfigWatcher;
 class MouseHook;
 
 /**
@@ -44,6 +45,13 @@ public:
         configManager_ = configManager;
     }
 
+    /**
+     * @brief 设置配置文件监视器（用于显示热重载结果）
+     */
+    void SetConfigWatcher(ConfigWatcher* configWatcher) {
+        configWatcher_ = configWatcher;
+    }
+
     /**
      * @brief 设置鼠标钩子
      */
@@ -68,6 +76,11 @@ public:
      */
     static const UINT WM_TRAYICON = WM_USER + 1;
 
+    /**
+     * @brief 配置重新加载完成（由监视线程投递）
+     */
+    static const UINT WM_CONFIG_RELOADED = WM_USER + 2;
+
 private:
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
     LRESULT HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -78,6 +91,7 @@ private:
     void OnDestroy();
     void LoadConfigToUI();
     void SaveConfigFromUI();
+    void OnConfigReloaded();
     
     // 开机自启相关
     bool IsAutoStartEnabled();
@@ -96,6 +110,7 @@ private:
     HWND aboutButton_;
     
     ConfigManager* configManager_;
+    ConfigWatcher* configWatcher_;
     MouseHook* mouseHook_;
     class TrayIcon* trayIcon_;
     
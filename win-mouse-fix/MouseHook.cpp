@@ -1,5 +1,6 @@
 ﻿#include "MouseHook.h"
 #include "GestureRecognizer.h"
+#include "LatencyTrace.h"
 #include <iostream>
 
 namespace WinMouseFix {
@@ -9,12 +10,14 @@ MouseHook* MouseHook::instance_ = nullptr;
 
 MouseHook::MouseHook() 
     : hook_(nullptr)
-    , gestureRecognizer_(nullptr) {
+    , gestureRecognizer_(nullptr)
+    , hookEntryUs_(0) {
     instance_ = this;
 }
 
 MouseHook::~MouseHook() {
     Uninstall();
+    StopRecording();
     instance_ = nullptr;
 }
 
@@ -49,6 +52,25 @@ Point MouseHook::GetCurrentMousePosition() const {
     return Point(pt.x, pt.y);
 }
 
+bool MouseHook::StartRecording(const std::string& path) {
+    // 钩子回调与本方法都运行在安装钩子的 UI 线程上，无需同步
+    StopRecording();
+    
+    std::unique_ptr<TraceRecorder> recorder(new TraceRecorder());
+    if (!recorder->Start(path)) {
+        return false;
+    }
+    recorder_ = std::move(recorder);
+    return true;
+}
+
+void MouseHook::StopRecording() {
+    if (recorder_) {
+        recorder_->Stop();
+        recorder_.reset();
+    }
+}
+
 LRESULT CALLBACK MouseHook::HookProc(int nCode, WPARAM wParam, LPARAM lParam) {
     if (instance_) {
         return instance_->HandleHook(nCode, wParam, lParam);
@@ -57,10 +79,32 @@ LRESULT CALLBACK MouseHook::HookProc(int nCode, WPARAM wParam, LPARAM lParam) {
 }
 
 LRESULT MouseHook::HandleHook(int nCode, WPARAM wParam, LPARAM lParam) {
+    // 事件时间在回调入口处取得，之后的排队延迟不影响时长和速度的计算
+    hookEntryUs_ = MonotonicMicros();
+    LatencyScope hookScope(LatencyStage::HOOK_CALLBACK);
+    
+    if (nCode >= 0 && recorder_) {
+        // 录制原始事件：只是一次无锁入队，编码和写文件在后台线程
+        const MSLLHOOKSTRUCT* raw = reinterpret_cast<const MSLLHOOKSTRUCT*>(lParam);
+        TraceRecord record;
+        record.message = static_cast<uint32_t>(wParam);
+        record.x = static_cast<int32_t>(raw->pt.x);
+        record.y = static_cast<int32_t>(raw->pt.y);
+        record.mouseData = static_cast<uint32_t>(raw->mouseData);
+        record.flags = static_cast<uint32_t>(raw->flags);
+        record.time = static_cast<uint32_t>(raw->time);
+        recorder_->Record(record);
+    }
+
     if (nCode < 0 || !gestureRecognizer_) {
         return CallNextHookEx(hook_, nCode, wParam, lParam);
     }
 
+    // 宏注入的点击直接放行，不参与手势识别
+    if (reinterpret_cast<const MSLLHOOKSTRUCT*>(lParam)->dwExtraInfo == kInjectedSignature) {
+        return CallNextHookEx(hook_, nCode, wParam, lParam);
+    }
+
     MSLLHOOKSTRUCT* info = reinterpret_cast<MSLLHOOKSTRUCT*>(lParam);
     bool blockEvent = false;
 
@@ -89,19 +133,19 @@ LRESULT MouseHook::HandleHook(int nCode, WPARAM wParam, LPARAM lParam) {
             break;
         }
 
-        case WM_MBUTTONDOWN: {
-            // 中键按下
-            Point pos(info->pt.x, info->pt.y);
-            blockEvent = HandleMouseButtonDown(MouseButton::BUTTON_MIDDLE, info);
+        case WM_MBUTTONDOWN:
+        case WM_LBUTTONDOWN:
+        case WM_RBUTTONDOWN:
+            // 中键/左键/右键按下：全部转发以跟踪按钮状态和组合键，
+            // 只有配置了手势的按钮才会被阻止
+            blockEvent = HandleMouseButtonDown(GetMouseButtonFromMessage(wParam), info);
             break;
-        }
 
-        case WM_MBUTTONUP: {
-            // 中键释放
-            Point pos(info->pt.x, info->pt.y);
-            blockEvent = HandleMouseButtonUp(MouseButton::BUTTON_MIDDLE, info);
+        case WM_MBUTTONUP:
+        case WM_LBUTTONUP:
+        case WM_RBUTTONUP:
+            blockEvent = HandleMouseButtonUp(GetMouseButtonFromMessage(wParam), info);
             break;
-        }
 
         default:
             break;
@@ -116,22 +160,30 @@ LRESULT MouseHook::HandleHook(int nCode, WPARAM wParam, LPARAM lParam) {
     return CallNextHookEx(hook_, nCode, wParam, lParam);
 }
 
+InputEvent MouseHook::MakeInputEvent(InputEvent::Type type, MouseButton button, const MSLLHOOKSTRUCT* info) const {
+    InputEvent event;
+    event.type = type;
+    event.button = button;
+    event.position = Point(info->pt.x, info->pt.y);
+    event.timestamp = info->time;
+    event.flags = (info->flags & LLMHF_INJECTED) ? InputEvent::FLAG_INJECTED : 0;
+    event.hookTimeUs = hookEntryUs_;
+    return event;
+}
+
 void MouseHook::HandleMouseMove(const MSLLHOOKSTRUCT* info) {
-    Point currentPos(info->pt.x, info->pt.y);
-    gestureRecognizer_->OnMouseMove(currentPos);
+    gestureRecognizer_->OnInputEvent(MakeInputEvent(InputEvent::MOVE, MouseButton::UNKNOWN, info));
 }
 
 bool MouseHook::HandleMouseButtonDown(MouseButton button, const MSLLHOOKSTRUCT* info) {
-    Point pos(info->pt.x, info->pt.y);
-    bool handled = gestureRecognizer_->OnButtonDown(button, pos);
+    bool handled = gestureRecognizer_->OnInputEvent(MakeInputEvent(InputEvent::BUTTON_DOWN, button, info));
     
     // 如果手势识别器接管了这个按钮，阻止默认行为
     return handled;
 }
 
 bool MouseHook::HandleMouseButtonUp(MouseButton button, const MSLLHOOKSTRUCT* info) {
-    Point pos(info->pt.x, info->pt.y);
-    bool handled = gestureRecognizer_->OnButtonUp(button, pos);
+    bool handled = gestureRecognizer_->OnInputEvent(MakeInputEvent(InputEvent::BUTTON_UP, button, info));
     
     // 如果发生了手势，阻止默认行为（前进/后退）
     return handled;
@@ -1,7 +1,9 @@
 ﻿#pragma once
 
-#include "Common.h"
+#include "WinCommon.h"
+#include "InputTrace.h"
 #include <functional>
+#include <memory>
 
 namespace WinMouseFix {
 
@@ -49,6 +51,22 @@ public:
      */
     Point GetCurrentMousePosition() const;
 
+    /**
+     * @brief 开始把所有原始鼠标事件录制到二进制轨迹文件
+     * @return 文件无法创建时返回 false
+     */
+    bool StartRecording(const std::string& path);
+
+    /**
+     * @brief 停止录制并写出剩余记录
+     */
+    void StopRecording();
+
+    /**
+     * @brief 检查是否正在录制
+     */
+    bool IsRecording() const { return recorder_ != nullptr; }
+
 private:
     /**
      * @brief 静态钩子过程回调
@@ -60,6 +78,11 @@ private:
      */
     LRESULT HandleHook(int nCode, WPARAM wParam, LPARAM lParam);
 
+    /**
+     * @brief 由钩子数据构造可移植的输入事件（时间取本次回调入口的高精度时间）
+     */
+    InputEvent MakeInputEvent(InputEvent::Type type, MouseButton button, const MSLLHOOKSTRUCT* info) const;
+
     /**
      * @brief 处理鼠标移动事件
      */
@@ -83,6 +106,8 @@ private:
 private:
     HHOOK hook_;                          // 钩子句柄
     GestureRecognizer* gestureRecognizer_; // 手势识别器
+    std::unique_ptr<TraceRecorder> recorder_; // 轨迹录制器（未录制时为空）
+    int64_t hookEntryUs_;                  // 当前回调入口的 MonotonicMicros()
     
     static MouseHook* instance_;          // 单例实例（用于静态回调）
 };
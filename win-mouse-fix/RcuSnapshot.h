@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief RCU 风格的只读快照（基于静止状态的延迟回收）
+ *
+ * 读者（钩子线程、工作线程等固定的 Readers 个线程）通过 Get() 一次原子加载拿到
+ * 当前快照，无锁、无等待；在不再持有快照指针的时刻调用 Quiesce() 报告静止状态。
+ * 写者用 Publish() 原子替换快照，旧快照在所有读者都报告过之后才被释放。
+ *
+ * 长时间休眠的读者应先调用 Offline()，醒来后调用 Online() 再读取快照，
+ * 否则旧快照会一直保留到它下一次报告。
+ */
+template <typename T, size_t Readers>
+class RcuSnapshot {
+public:
+    explicit RcuSnapshot(std::unique_ptr<T> initial)
+        : current_(initial.release())
+        , epoch_(0) {
+        for (auto& reader : readers_) {
+            reader.epoch.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ~RcuSnapshot() {
+        delete current_.load(std::memory_order_relaxed);
+        for (auto& item : retired_) {
+            delete item.second;
+        }
+    }
+
+    RcuSnapshot(const RcuSnapshot&) = delete;
+    RcuSnapshot& operator=(const RcuSnapshot&) = delete;
+
+    /**
+     * @brief 读取当前快照（读者线程）
+     */
+    const T* Get() const {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 报告静止状态：此前读取的快照指针不再使用（读者线程）
+     */
+    void Quiesce(size_t reader) {
+        readers_[reader].epoch.store(epoch_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    /**
+     * @brief 进入长时间休眠前调用，不再阻止任何回收（读者线程）
+     */
+    void Offline(size_t reader) {
+        readers_[reader].epoch.store(kOffline, std::memory_order_release);
+    }
+
+    /**
+     * @brief 休眠结束、读取快照之前调用（读者线程）
+     */
+    void Online(size_t reader) {
+        // 与 Publish 中的栅栏配对：要么这里之后读到新快照，要么写者看到本读者仍在线
+        readers_[reader].epoch.store(epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief 发布新快照，旧快照延迟回收（任意线程，写者之间互斥）
+     */
+    void Publish(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> lock(writerMutex_);
+        T* previous = current_.exchange(next.release(), std::memory_order_acq_rel);
+        uint64_t retireEpoch = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        retired_.push_back(std::make_pair(retireEpoch, previous));
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ReclaimLocked();
+    }
+
+    /**
+     * @brief 释放所有读者都已不再引用的旧快照，返回仍待回收的数量
+     */
+    size_t Reclaim() {
+        std::lock_guard<std::mutex> lock(writerMutex_);
+        ReclaimLocked();
+        return retired_.size();
+    }
+
+private:
+    static const uint64_t kOffline = UINT64_MAX;
+
+    void ReclaimLocked() {
+        uint64_t safeEpoch = kOffline;
+        for (auto& reader : readers_) {
+            uint64_t epoch = reader.epoch.load(std::memory_order_acquire);
+            if (epoch < safeEpoch) {
+                safeEpoch = epoch;
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < retired_.size(); ++i) {
+            if (retired_[i].first <= safeEpoch) {
+                delete retired_[i].second;
+            } else {
+                retired_[kept++] = retired_[i];
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    struct alignas(kCacheLineSize) ReaderSlot {
+        std::atomic<uint64_t> epoch;
+    };
+
+    std::atomic<T*> current_;
+    std::atomic<uint64_t> epoch_;
+    ReaderSlot readers_[Readers];
+
+    std::mutex writerMutex_;
+    std::vector<std::pair<uint64_t, T*>> retired_;  // (退役时的纪元, 旧快照)
+};
+
+} // namespace WinMouseFix
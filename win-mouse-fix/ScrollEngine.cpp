@@ -0,0 +1,210 @@
+﻿#include "ScrollEngine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace WinMouseFix {
+
+namespace {
+
+// 速度估计的平滑系数（每个采样向瞬时速度靠近的比例）
+const double kSpeedSmoothing = 0.5;
+
+// 轴锁定：判断主方向的时间窗口、锁定所需的优势比例、解除锁定的比例和最小净位移（像素）
+const int64_t kAxisWindowUs = 30000;
+const double kAxisLockRatio = 2.0;
+const double kAxisUnlockRatio = 0.5;
+const double kAxisLockTravel = 4.0;
+
+// 死区：速度每 1000 像素/秒增加 1 像素，最大 3 像素；只作用于明显偏向另一方向的采样
+const double kDeadZonePerSpeed = 0.001;
+const double kDeadZoneMax = 3.0;
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// ScrollProfile
+// ---------------------------------------------------------------------------
+
+ScrollProfile::ScrollProfile() {
+    Build(GestureConfig());
+}
+
+void ScrollProfile::Build(const GestureConfig& config) {
+    // 倍率随速度线性增加：速度每增加 1000 像素/秒，倍率增加 scrollAcceleration
+    double acceleration = std::max(0.0, config.scrollAcceleration);
+    for (int i = 0; i < kTableSize; ++i) {
+        factors_[i] = static_cast<float>(1.0 + acceleration * (i * kSpeedStep) / 1000.0);
+    }
+
+    // 自然滚动：垂直方向滚轮量与鼠标位移同号，水平方向反号（与原先的 SimulateScroll 一致）
+    double sign = config.scrollNatural ? 1.0 : -1.0;
+    scaleX_ = -sign * kUnitsPerPixel * config.scrollGainX;
+    scaleY_ = sign * kUnitsPerPixel * config.scrollGainY;
+    friction_ = std::max(0.0, config.scrollFriction);
+    outputIntervalUs_ = config.scrollOutputRate > 0 ? 1000000 / config.scrollOutputRate : 0;
+    axisLock_ = config.scrollAxisLock;
+}
+
+double ScrollProfile::Factor(double speed) const {
+    double position = speed / kSpeedStep;
+    if (!(position > 0)) {
+        return factors_[0];
+    }
+    if (position >= kTableSize - 1) {
+        return factors_[kTableSize - 1];
+    }
+    int index = static_cast<int>(position);
+    double fraction = position - index;
+    return factors_[index] + (factors_[index + 1] - factors_[index]) * fraction;
+}
+
+// ---------------------------------------------------------------------------
+// ScrollEngine
+// ---------------------------------------------------------------------------
+
+ScrollEngine::ScrollEngine()
+    : remainderX_(0)
+    , remainderY_(0)
+    , speed_(0)
+    , lastTimeUs_(0)
+    , windowX_(0)
+    , windowY_(0)
+    , axis_(AXIS_FREE) {
+}
+
+void ScrollEngine::Reset(int64_t timeUs) {
+    remainderX_ = 0;
+    remainderY_ = 0;
+    speed_ = 0;
+    lastTimeUs_ = timeUs;
+    windowX_ = 0;
+    windowY_ = 0;
+    axis_ = AXIS_FREE;
+}
+
+int ScrollEngine::Emit(double& remainder, double amount) {
+    // 反向移动时丢弃旧方向的余量，避免回头时先抵消一段
+    if ((remainder > 0 && amount < 0) || (remainder < 0 && amount > 0)) {
+        remainder = 0;
+    }
+    remainder += amount;
+    int units = static_cast<int>(remainder);
+    remainder -= units;
+    return units;
+}
+
+Point ScrollEngine::FilterAxis(const Point& delta, int64_t dt) {
+    // 窗口内的净位移按时间线性衰减；来回抖动相互抵消，持续的移动不断累积
+    double keep = dt > 0 ? std::max(0.0, 1.0 - static_cast<double>(dt) / kAxisWindowUs) : 1.0;
+    windowX_ = windowX_ * keep + delta.x;
+    windowY_ = windowY_ * keep + delta.y;
+    double travelX = std::fabs(windowX_);
+    double travelY = std::fabs(windowY_);
+
+    // 另一方向的净位移达到主方向的一半时解除锁定，再按新的主方向重新判断
+    if ((axis_ == AXIS_Y && travelX >= kAxisLockTravel && travelX >= travelY * kAxisUnlockRatio) ||
+        (axis_ == AXIS_X && travelY >= kAxisLockTravel && travelY >= travelX * kAxisUnlockRatio)) {
+        axis_ = AXIS_FREE;
+    }
+    if (axis_ == AXIS_FREE) {
+        if (travelY >= kAxisLockTravel && travelY >= travelX * kAxisLockRatio) {
+            axis_ = AXIS_Y;
+        } else if (travelX >= kAxisLockTravel && travelX >= travelY * kAxisLockRatio) {
+            axis_ = AXIS_X;
+        }
+    }
+
+    Point filtered = delta;
+    if (axis_ == AXIS_FREE) {
+        // 明显偏向一个方向的采样，另一方向的小分量视为手抖
+        double deadZone = std::min(kDeadZoneMax, speed_ * kDeadZonePerSpeed);
+        int ax = std::abs(delta.x);
+        int ay = std::abs(delta.y);
+        if (ax <= deadZone && ax * 2 <= ay) {
+            filtered.x = 0;
+        } else if (ay <= deadZone && ay * 2 <= ax) {
+            filtered.y = 0;
+        }
+    } else if (axis_ == AXIS_Y) {
+        filtered.x = 0;
+    } else {
+        filtered.y = 0;
+    }
+
+    // 被过滤的方向连同不足一个单位的余量一起丢弃，之后不会再零星地发出
+    if (filtered.x == 0) {
+        remainderX_ = 0;
+    }
+    if (filtered.y == 0) {
+        remainderY_ = 0;
+    }
+    return filtered;
+}
+
+Point ScrollEngine::AddSample(const Point& delta, int64_t timeUs, const ScrollProfile& profile) {
+    int64_t dt = timeUs - lastTimeUs_;
+    if (dt > 0) {
+        double instant = delta.length() * 1e6 / static_cast<double>(dt);
+        speed_ += (instant - speed_) * kSpeedSmoothing;
+        lastTimeUs_ = timeUs;
+    }
+
+    Point motion = profile.HasAxisLock() ? FilterAxis(delta, dt) : delta;
+    double factor = profile.Factor(speed_);
+    return Point(Emit(remainderX_, motion.x * profile.GetScaleX() * factor),
+                 Emit(remainderY_, motion.y * profile.GetScaleY() * factor));
+}
+
+// ---------------------------------------------------------------------------
+// ScrollMomentum
+// ---------------------------------------------------------------------------
+
+ScrollMomentum::ScrollMomentum()
+    : vx_(0)
+    , vy_(0)
+    , friction_(0)
+    , remainderX_(0)
+    , remainderY_(0)
+    , lastTimeUs_(0)
+    , active_(false) {
+}
+
+bool ScrollMomentum::Start(double vx, double vy, double friction, int64_t timeUs) {
+    active_ = friction > 0 && vx * vx + vy * vy >= kMinStartSpeed * kMinStartSpeed;
+    vx_ = vx;
+    vy_ = vy;
+    friction_ = friction;
+    remainderX_ = 0;
+    remainderY_ = 0;
+    lastTimeUs_ = timeUs;
+    return active_;
+}
+
+int ScrollMomentum::TakeWhole(double& remainder) {
+    int whole = static_cast<int>(remainder);
+    remainder -= whole;
+    return whole;
+}
+
+Point ScrollMomentum::Step(int64_t timeUs) {
+    if (!active_ || timeUs <= lastTimeUs_) {
+        return Point();
+    }
+
+    // 这段时间内的位移为速度的积分：v0 * (1 - e^(-k*dt)) / k
+    double dt = static_cast<double>(timeUs - lastTimeUs_) / 1e6;
+    double decay = exp(-friction_ * dt);
+    double travel = (1.0 - decay) / friction_;
+    remainderX_ += vx_ * travel;
+    remainderY_ += vy_ * travel;
+    vx_ *= decay;
+    vy_ *= decay;
+    lastTimeUs_ = timeUs;
+
+    if (vx_ * vx_ + vy_ * vy_ < kStopSpeed * kStopSpeed) {
+        active_ = false;
+    }
+    return Point(TakeWhole(remainderX_), TakeWhole(remainderY_));
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,173 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 滚动曲线 - 规则加载时预先计算的加速查找表、方向和各轴增益
+ *
+ * 倍率按输入速度查表（相邻两项线性插值），每个采样不做 pow/exp 之类的计算。
+ * 慢速时每像素对应 kUnitsPerPixel 个滚轮单位（WHEEL_DELTA 为 120），
+ * 高分辨率滚轮量使慢速移动也能逐像素滚动。
+ * 启用轴锁定时，ScrollEngine 在换算前先过滤另一方向的抖动。
+ */
+class ScrollProfile {
+public:
+    static const int kUnitsPerPixel = 6;     // 与原先每 5 像素一次 30 的滚动量相同
+    static const int kSpeedStep = 64;        // 查找表相邻两项的速度间隔（像素/秒）
+    static const int kTableSize = 65;        // 覆盖 0 ~ 4096 像素/秒，更快时取最后一项
+
+    /**
+     * @brief 默认曲线：线性、自然方向、增益 1
+     */
+    ScrollProfile();
+
+    /**
+     * @brief 由滚动规则生成查找表
+     */
+    void Build(const GestureConfig& config);
+
+    /**
+     * @brief 输入速度（像素/秒）对应的加速倍率
+     */
+    double Factor(double speed) const;
+
+    /**
+     * @brief 每像素的滚轮单位（含方向与增益，不含加速）
+     */
+    double GetScaleX() const { return scaleX_; }
+    double GetScaleY() const { return scaleY_; }
+
+    /**
+     * @brief 惯性滚动的衰减率（每秒），0 表示不启用
+     */
+    double GetFriction() const { return friction_; }
+    bool HasMomentum() const { return friction_ > 0; }
+
+    /**
+     * @brief 批量输出的间隔（微秒），0 表示每个采样立即输出
+     */
+    int64_t GetOutputIntervalUs() const { return outputIntervalUs_; }
+
+    /**
+     * @brief 是否锁定主方向并过滤另一方向的抖动
+     */
+    bool HasAxisLock() const { return axisLock_; }
+
+private:
+    float factors_[kTableSize];
+    double scaleX_;
+    double scaleY_;
+    double friction_;
+    int64_t outputIntervalUs_;
+    bool axisLock_;
+};
+
+/**
+ * @brief 平滑滚动 - 把鼠标位移换算为高分辨率滚轮量，不足一个单位的部分留到下次
+ *
+ * 轴锁定：按最近约 30 毫秒的净位移判断主方向，一个方向明显占优时锁定到该方向，
+ * 另一方向的位移连同累积的余量一起丢弃，直到它的净位移达到主方向的一半为止。未锁定时，
+ * 斜向分量低于随速度增大的死区也被丢弃，手抖不会产生另一方向的滚轮消息。
+ */
+class ScrollEngine {
+public:
+    ScrollEngine();
+
+    /**
+     * @brief 进入滚动前清除余量与速度估计
+     */
+    void Reset(int64_t timeUs);
+
+    /**
+     * @brief 切换采样的时钟，保留余量与速度估计（惯性滚动的帧按实际时间推进）
+     */
+    void Rebase(int64_t timeUs) { lastTimeUs_ = timeUs; }
+
+    /**
+     * @brief 添加一个移动采样，返回本次应发出的滚轮量（水平，垂直）
+     */
+    Point AddSample(const Point& delta, int64_t timeUs, const ScrollProfile& profile);
+
+    enum Axis {
+        AXIS_FREE,   // 两个方向都滚动
+        AXIS_X,      // 只滚动水平方向
+        AXIS_Y,      // 只滚动垂直方向
+    };
+
+    /**
+     * @brief 当前锁定的方向
+     */
+    Axis GetLockedAxis() const { return axis_; }
+
+    /**
+     * @brief 平滑后的输入速度（像素/秒）
+     */
+    double GetSpeed() const { return speed_; }
+
+private:
+    static int Emit(double& remainder, double amount);
+
+    /**
+     * @brief 更新主方向判断，返回过滤抖动后的位移
+     */
+    Point FilterAxis(const Point& delta, int64_t dt);
+
+    double remainderX_;
+    double remainderY_;
+    double speed_;
+    int64_t lastTimeUs_;
+    double windowX_;    // 最近一小段时间内的带符号位移（按时间衰减）
+    double windowY_;
+    Axis axis_;
+};
+
+/**
+ * @brief 惯性滚动 - 松开滚动按钮后按指数衰减的速度继续产生位移
+ *
+ * 由工作线程按帧调用 Step()，位移为鼠标像素（含方向），再交给 ScrollEngine 换算为滚轮量；
+ * 不足一个像素的部分留到下一帧。速度降到 kStopSpeed 以下时自动停止。
+ */
+class ScrollMomentum {
+public:
+    static constexpr double kMinStartSpeed = 200.0;  // 松开时低于此速度（像素/秒）不启动
+    static constexpr double kStopSpeed = 20.0;       // 低于此速度停止
+
+    ScrollMomentum();
+
+    /**
+     * @brief 以松开时的速度（像素/秒）开始惯性滚动，速度太低时不启动
+     * @return 是否启动
+     */
+    bool Start(double vx, double vy, double friction, int64_t timeUs);
+
+    void Stop() { active_ = false; }
+
+    bool IsActive() const { return active_; }
+
+    /**
+     * @brief 推进到 timeUs，返回这段时间的位移（像素）
+     */
+    Point Step(int64_t timeUs);
+
+    /**
+     * @brief 位移是否与惯性方向相反（用于取消）
+     */
+    bool IsOpposite(const Point& delta) const {
+        return delta.x * vx_ + delta.y * vy_ < 0;
+    }
+
+private:
+    static int TakeWhole(double& remainder);
+
+    double vx_;
+    double vy_;
+    double friction_;
+    double remainderX_;
+    double remainderY_;
+    int64_t lastTimeUs_;
+    bool active_;
+};
+
+} // namespace WinMouseFix
@@ -0,0 +1,138 @@
+﻿#include "SectorClassifier.h"
+#include <cstdlib>
+
+namespace WinMouseFix {
+
+namespace {
+
+// kAtanTable[i] = atan(i / 256) 换算为角度单位（45 度 = 256）
+const int kRatioBits = 8;
+const uint16_t kAtanTable[(1 << kRatioBits) + 1] = {
+    0, 1, 3, 4, 5, 6, 8, 9, 10, 11, 13, 14, 15, 17, 18, 19,
+    20, 22, 23, 24, 25, 27, 28, 29, 30, 32, 33, 34, 36, 37, 38, 39,
+    41, 42, 43, 44, 46, 47, 48, 49, 51, 52, 53, 54, 55, 57, 58, 59,
+    60, 62, 63, 64, 65, 67, 68, 69, 70, 71, 73, 74, 75, 76, 77, 79,
+    80, 81, 82, 83, 85, 86, 87, 88, 89, 91, 92, 93, 94, 95, 96, 98,
+    99, 100, 101, 102, 103, 104, 106, 107, 108, 109, 110, 111, 112, 114, 115, 116,
+    117, 118, 119, 120, 121, 122, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133,
+    134, 135, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 150,
+    151, 152, 153, 154, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164, 165, 166,
+    167, 168, 169, 170, 171, 172, 173, 174, 175, 176, 177, 177, 178, 179, 180, 181,
+    182, 183, 184, 185, 186, 187, 188, 188, 189, 190, 191, 192, 193, 194, 195, 195,
+    196, 197, 198, 199, 200, 201, 201, 202, 203, 204, 205, 206, 206, 207, 208, 209,
+    210, 211, 211, 212, 213, 214, 215, 215, 216, 217, 218, 219, 219, 220, 221, 222,
+    222, 223, 224, 225, 225, 226, 227, 228, 228, 229, 230, 231, 231, 232, 233, 234,
+    234, 235, 236, 236, 237, 238, 239, 239, 240, 241, 241, 242, 243, 243, 244, 245,
+    245, 246, 247, 248, 248, 249, 250, 250, 251, 251, 252, 253, 253, 254, 255, 255,
+    256,
+};
+
+// 按扇区编号（从向右开始逆时针）排列的方向
+const GestureType kEightWay[8] = {
+    GestureType::SWIPE_RIGHT, GestureType::SWIPE_UP_RIGHT, GestureType::SWIPE_UP, GestureType::SWIPE_UP_LEFT,
+    GestureType::SWIPE_LEFT, GestureType::SWIPE_DOWN_LEFT, GestureType::SWIPE_DOWN, GestureType::SWIPE_DOWN_RIGHT,
+};
+const GestureType kFourWay[4] = {
+    GestureType::SWIPE_RIGHT, GestureType::SWIPE_UP, GestureType::SWIPE_LEFT, GestureType::SWIPE_DOWN,
+};
+
+/**
+ * @brief 两个角度之间的最小夹角
+ */
+inline int AngleBetween(int a, int b) {
+    int d = abs(a - b) & (SectorClassifier::kFullCircle - 1);
+    return d > SectorClassifier::kFullCircle / 2 ? SectorClassifier::kFullCircle - d : d;
+}
+
+} // namespace
+
+int SectorClassifier::Angle(const Point& delta) {
+    uint32_t ax = static_cast<uint32_t>(abs(delta.x));
+    uint32_t ay = static_cast<uint32_t>(abs(delta.y));
+    if (ax == 0 && ay == 0) {
+        return -1;
+    }
+    // 32 位除法比 64 位快得多；位移超过 2^23 像素时先缩小（比值不变）
+    while ((ax | ay) >= (1u << (32 - kRatioBits - 1))) {
+        ax >>= 1;
+        ay >>= 1;
+    }
+
+    // 第一象限内的角度（0 ~ 512）
+    int angle;
+    if (ax >= ay) {
+        angle = kAtanTable[(ay << kRatioBits) / ax];
+    } else {
+        angle = kFullCircle / 4 - kAtanTable[(ax << kRatioBits) / ay];
+    }
+
+    // 按象限还原；屏幕坐标 y 向下，向上为正角度
+    bool left = delta.x < 0;
+    bool down = delta.y > 0;
+    if (left && !down) {
+        angle = kFullCircle / 2 - angle;
+    } else if (left && down) {
+        angle = kFullCircle / 2 + angle;
+    } else if (down) {
+        angle = (kFullCircle - angle) & (kFullCircle - 1);
+    }
+    return angle;
+}
+
+SectorClassifier::Sector SectorClassifier::Classify(const Point& delta, bool eightWay, GestureType previous, int hysteresis) {
+    Sector result;
+    int angle = Angle(delta);
+    if (angle < 0) {
+        return result;
+    }
+
+    // 扇区宽度是 2 的幂，用移位代替除法
+    const int shift = eightWay ? 8 : 9;
+    const int count = kFullCircle >> shift;
+    const int width = 1 << shift;
+    const GestureType* sectors = eightWay ? kEightWay : kFourWay;
+
+    int index = ((angle + width / 2) >> shift) & (count - 1);
+    result.gesture = sectors[index];
+    result.offset = AngleBetween(angle, index * width);
+
+    // 滞回：仍在上一扇区边界外 hysteresis 以内时保持上一方向
+    if (hysteresis > 0 && previous != GestureType::NONE && previous != result.gesture) {
+        for (int i = 0; i < count; ++i) {
+            if (sectors[i] == previous) {
+                int offset = AngleBetween(angle, i * width);
+                if (offset <= width / 2 + hysteresis) {
+                    result.gesture = previous;
+                    result.offset = offset;
+                }
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+Point SectorClassifier::Axis(GestureType gesture) {
+    switch (gesture) {
+        case GestureType::SWIPE_UP:         return Point(0, -1);
+        case GestureType::SWIPE_DOWN:       return Point(0, 1);
+        case GestureType::SWIPE_LEFT:       return Point(-1, 0);
+        case GestureType::SWIPE_RIGHT:      return Point(1, 0);
+        case GestureType::SWIPE_UP_LEFT:    return Point(-1, -1);
+        case GestureType::SWIPE_UP_RIGHT:   return Point(1, -1);
+        case GestureType::SWIPE_DOWN_LEFT:  return Point(-1, 1);
+        case GestureType::SWIPE_DOWN_RIGHT: return Point(1, 1);
+        default:                            return Point(0, 0);
+    }
+}
+
+GestureType SectorClassifier::Opposite(GestureType gesture) {
+    for (int i = 0; i < 8; ++i) {
+        if (kEightWay[i] == gesture) {
+            return kEightWay[(i + 4) & 7];
+        }
+    }
+    return GestureType::NONE;
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "Common.h"
+
+namespace WinMouseFix {
+
+/**
+ * @brief 定点角度扇区分类 - 用查找表代替 atan2/sqrt，每个采样只有整数运算
+ *
+ * 角度单位为 1/2048 圈（约 0.176 度），0 为向右，逆时针增加（屏幕向上为正）。
+ * 位移折叠到第一个八分区后，以 短边/长边 的 8 位定点比值查表得到角度，再按象限还原。
+ * 4 方向模式每个扇区 90 度（与按主轴比较的结果一致，45 度时判为垂直方向），
+ * 8 方向模式每个扇区 45 度。
+ */
+class SectorClassifier {
+public:
+    static const int kFullCircle = 2048;
+
+    /**
+     * @brief 扇区与角度偏移
+     */
+    struct Sector {
+        GestureType gesture;  // 扇区对应的滑动方向，没有位移时为 NONE
+        int offset;           // 与扇区中心的夹角（角度单位）
+
+        Sector() : gesture(GestureType::NONE), offset(0) {}
+    };
+
+    /**
+     * @brief 位移的角度（0 ~ kFullCircle - 1），没有位移时返回 -1
+     */
+    static int Angle(const Point& delta);
+
+    /**
+     * @brief 度转换为角度单位
+     */
+    static int DegreesToUnits(int degrees) { return degrees * kFullCircle / 360; }
+
+    /**
+     * @brief 按扇区分类
+     * @param eightWay   8 方向（含斜向）或 4 方向
+     * @param previous   上一次的方向：角度仍在其扇区边界外 hysteresis 以内时保持不变
+     * @param hysteresis 滞回角度（角度单位），0 表示不启用
+     */
+    static Sector Classify(const Point& delta, bool eightWay, GestureType previous, int hysteresis);
+
+    /**
+     * @brief 滑动方向的屏幕坐标方向轴（分量为 -1/0/1），不是滑动方向时为 (0, 0)
+     */
+    static Point Axis(GestureType gesture);
+
+    /**
+     * @brief 相反的滑动方向，不是滑动方向时返回 NONE
+     */
+    static GestureType Opposite(GestureType gesture);
+
+    /**
+     * @brief 是否为斜向滑动
+     */
+    static bool IsDiagonal(GestureType gesture) {
+        return gesture == GestureType::SWIPE_UP_LEFT || gesture == GestureType::SWIPE_UP_RIGHT ||
+               gesture == GestureType::SWIPE_DOWN_LEFT || gesture == GestureType::SWIPE_DOWN_RIGHT;
+    }
+};
+
+} // namespace WinMouseFix
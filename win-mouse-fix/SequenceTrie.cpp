@@ -0,0 +1,103 @@
+﻿#include "SequenceTrie.h"
+#include "SectorClassifier.h"
+
+namespace WinMouseFix {
+
+namespace {
+
+inline int64_t LengthSquared(const Point& v) {
+    return static_cast<int64_t>(v.x) * v.x + static_cast<int64_t>(v.y) * v.y;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SequenceTrie
+// ---------------------------------------------------------------------------
+
+SequenceTrie::SequenceTrie() {
+    Clear();
+}
+
+void SequenceTrie::Clear() {
+    nodes_.clear();
+    Node root;
+    for (int d = 0; d < kDirections; ++d) {
+        root.next[d] = kDead;
+    }
+    root.rule = -1;
+    nodes_.push_back(root);
+}
+
+bool SequenceTrie::Insert(const std::vector<GestureType>& strokes, int rule) {
+    int node = kRoot;
+    for (GestureType stroke : strokes) {
+        int direction = DirectionIndex(stroke);
+        if (direction < 0) {
+            return false;
+        }
+        if (nodes_[node].next[direction] == kDead) {
+            Node child;
+            for (int d = 0; d < kDirections; ++d) {
+                child.next[d] = kDead;
+            }
+            child.rule = -1;
+            nodes_.push_back(child);
+            nodes_[node].next[direction] = static_cast<int32_t>(nodes_.size() - 1);
+        }
+        node = nodes_[node].next[direction];
+    }
+
+    if (node == kRoot || nodes_[node].rule >= 0) {
+        return false;
+    }
+    nodes_[node].rule = rule;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// StrokeSegmenter
+// ---------------------------------------------------------------------------
+
+StrokeSegmenter::StrokeSegmenter() {
+    Reset(Point(0, 0));
+}
+
+void StrokeSegmenter::Reset(const Point& start) {
+    start_ = start;
+    pivot_ = start;
+    direction_ = GestureType::NONE;
+    strokeCount_ = 0;
+}
+
+GestureType StrokeSegmenter::AddSample(const Point& position, int64_t minLengthSquared, bool eightWay) {
+    if (direction_ == GestureType::NONE) {
+        Point v = position - start_;
+        if (LengthSquared(v) >= minLengthSquared && LengthSquared(v) > 0) {
+            direction_ = SectorClassifier::Classify(v, eightWay, GestureType::NONE, 0).gesture;
+            pivot_ = position;
+        }
+        return GestureType::NONE;
+    }
+
+    Point w = position - pivot_;
+    if (LengthSquared(w) < minLengthSquared || LengthSquared(w) == 0) {
+        return GestureType::NONE;
+    }
+
+    GestureType direction = SectorClassifier::Classify(w, eightWay, GestureType::NONE, 0).gesture;
+    if (direction == direction_) {
+        pivot_ = position;
+        return GestureType::NONE;
+    }
+
+    // 方向改变：当前笔画在确认点结束
+    GestureType finished = direction_;
+    start_ = pivot_;
+    pivot_ = position;
+    direction_ = direction;
+    ++strokeCount_;
+    return finished;
+}
+
+} // namespace WinMouseFix
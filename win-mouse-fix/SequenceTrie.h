@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include "Common.h"
+#include <cstdint>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 多笔画序列的前缀树
+ *
+ * 每个节点对 8 个滑动方向各有一个子节点下标，LoadConfig 时把序列规则插入树中；
+ * 识别时每结束一个笔画前进一步（一次数组访问），与序列长度和规则数无关。
+ */
+class SequenceTrie {
+public:
+    static const int kRoot = 0;
+    static const int kDead = -1;    // 没有任何序列以当前笔画为前缀
+
+    SequenceTrie();
+
+    void Clear();
+
+    /**
+     * @brief 插入序列，已存在相同序列时返回 false（保留第一条）
+     */
+    bool Insert(const std::vector<GestureType>& strokes, int rule);
+
+    /**
+     * @brief 从 node 沿笔画方向前进一步
+     */
+    int Advance(int node, GestureType stroke) const {
+        int direction = DirectionIndex(stroke);
+        if (node < 0 || direction < 0) {
+            return kDead;
+        }
+        return nodes_[node].next[direction];
+    }
+
+    /**
+     * @brief 节点对应的规则下标，不是某条序列的终点时返回 -1
+     */
+    int GetRule(int node) const {
+        return node < 0 ? -1 : nodes_[node].rule;
+    }
+
+    size_t GetNodeCount() const { return nodes_.size(); }
+
+    /**
+     * @brief 滑动方向在子节点数组中的下标，不是滑动方向时返回 -1
+     */
+    static int DirectionIndex(GestureType stroke) {
+        int index = static_cast<int>(stroke) - static_cast<int>(GestureType::SWIPE_UP);
+        return (index >= 0 && index < kDirections) ? index : -1;
+    }
+
+private:
+    static const int kDirections = 8;
+
+    struct Node {
+        int32_t next[kDirections];
+        int32_t rule;
+    };
+
+    std::vector<Node> nodes_;
+};
+
+/**
+ * @brief 笔画分段 - 根据方向变化把一次拖动切分为多个直线笔画
+ *
+ * 当前笔画的方向在离开起点 minLength 之后确定；此后记录沿该方向的最远确认点，
+ * 从该点出发又移动了 minLength 且方向不同时，当前笔画结束，新笔画从该点开始。
+ * 只有整数运算。
+ */
+class StrokeSegmenter {
+public:
+    StrokeSegmenter();
+
+    void Reset(const Point& start);
+
+    /**
+     * @brief 添加一个移动采样，返回刚结束的笔画方向（没有结束时为 NONE）
+     */
+    GestureType AddSample(const Point& position, int64_t minLengthSquared, bool eightWay);
+
+    /**
+     * @brief 当前未结束笔画的方向（尚未确定时为 NONE）
+     */
+    GestureType GetDirection() const { return direction_; }
+
+    /**
+     * @brief 已结束的笔画数
+     */
+    int GetStrokeCount() const { return strokeCount_; }
+
+private:
+    Point start_;
+    Point pivot_;                // 沿当前方向最远的确认点
+    GestureType direction_;
+    int strokeCount_;
+};
+
+} // namespace WinMouseFix
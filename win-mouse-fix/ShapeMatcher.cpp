@@ -0,0 +1,278 @@
+﻿#include "ShapeMatcher.h"
+#include <algorithm>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WMF_SHAPE_SSE2 1
+#endif
+
+namespace WinMouseFix {
+
+namespace {
+
+const int kN = ShapeMatcher::kPointCount;
+static_assert((kN & (kN - 1)) == 0 && kN % 8 == 0, "点下标放在尾数低位，点数须为 2 的幂且是 8 的倍数");
+
+// 已匹配点的距离惩罚，保证不会再被选中
+const float kMatched = 1e30f;
+
+// 每隔 sqrt(n) 个点尝试一个起点（$P 的 epsilon = 0.5）
+const int kStartStep = 5;
+
+// 相似度 = 1 - 距离 / kScoreScale
+const double kScoreScale = 4.0;
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// ShapeStroke
+// ---------------------------------------------------------------------------
+
+ShapeStroke::ShapeStroke() {
+    Reset(Point(0, 0));
+}
+
+void ShapeStroke::Reset(const Point& start) {
+    points_[0] = start;
+    count_ = 1;
+    spacing_ = 2;
+    length_ = 0;
+}
+
+void ShapeStroke::Add(const Point& position) {
+    const Point& last = points_[count_ - 1];
+    double step = distance(last, position);
+    if (step < spacing_) {
+        return;
+    }
+    length_ += step;
+
+    if (count_ == kCapacity) {
+        // 隔点抽稀，保留首尾轮廓
+        size_t kept = 0;
+        for (size_t i = 0; i < count_; i += 2) {
+            points_[kept++] = points_[i];
+        }
+        count_ = kept;
+        spacing_ *= 2;
+    }
+    points_[count_++] = position;
+}
+
+// ---------------------------------------------------------------------------
+// ShapeMatcher
+// ---------------------------------------------------------------------------
+
+bool ShapeMatcher::Normalize(const Point* points, size_t count, float* xs, float* ys) {
+    if (count < 2) {
+        return false;
+    }
+
+    double pathLength = 0;
+    for (size_t i = 1; i < count; ++i) {
+        pathLength += distance(points[i - 1], points[i]);
+    }
+    if (pathLength <= 0) {
+        return false;
+    }
+
+    // 等距重采样
+    const double interval = pathLength / (kN - 1);
+    double px = points[0].x;
+    double py = points[0].y;
+    xs[0] = static_cast<float>(px);
+    ys[0] = static_cast<float>(py);
+    int n = 1;
+    double accumulated = 0;
+    for (size_t i = 1; i < count && n < kN; ++i) {
+        double qx = points[i].x;
+        double qy = points[i].y;
+        double d = sqrt((qx - px) * (qx - px) + (qy - py) * (qy - py));
+        while (d > 0 && accumulated + d >= interval && n < kN) {
+            double t = (interval - accumulated) / d;
+            px += t * (qx - px);
+            py += t * (qy - py);
+            xs[n] = static_cast<float>(px);
+            ys[n] = static_cast<float>(py);
+            ++n;
+            d = sqrt((qx - px) * (qx - px) + (qy - py) * (qy - py));
+            accumulated = 0;
+        }
+        accumulated += d;
+        px = qx;
+        py = qy;
+    }
+    // 浮点误差可能少最后一个点
+    for (; n < kN; ++n) {
+        xs[n] = static_cast<float>(points[count - 1].x);
+        ys[n] = static_cast<float>(points[count - 1].y);
+    }
+
+    // 按最大边长等比缩放，重心移到原点
+    float minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
+    for (int i = 1; i < kN; ++i) {
+        minX = std::min(minX, xs[i]);
+        maxX = std::max(maxX, xs[i]);
+        minY = std::min(minY, ys[i]);
+        maxY = std::max(maxY, ys[i]);
+    }
+    float size = std::max(maxX - minX, maxY - minY);
+    if (size <= 0) {
+        return false;
+    }
+    float cx = 0;
+    float cy = 0;
+    for (int i = 0; i < kN; ++i) {
+        xs[i] = (xs[i] - minX) / size;
+        ys[i] = (ys[i] - minY) / size;
+        cx += xs[i];
+        cy += ys[i];
+    }
+    cx /= kN;
+    cy /= kN;
+    for (int i = 0; i < kN; ++i) {
+        xs[i] -= cx;
+        ys[i] -= cy;
+    }
+    return true;
+}
+
+int ShapeMatcher::AddTemplate(const Point* points, size_t count) {
+    float xs[kN];
+    float ys[kN];
+    if (!Normalize(points, count, xs, ys)) {
+        return -1;
+    }
+    xs_.insert(xs_.end(), xs, xs + kN);
+    ys_.insert(ys_.end(), ys, ys + kN);
+    return static_cast<int>(templateCount_++);
+}
+
+void ShapeMatcher::Clear() {
+    xs_.clear();
+    ys_.clear();
+    templateCount_ = 0;
+}
+
+float ShapeMatcher::CloudDistance(const float* ax, const float* ay, const float* bx, const float* by,
+                                  int start, float best) {
+    alignas(16) float penalty[kN] = {};
+    float sum = 0;
+    int i = start;
+    for (int k = 0; k < kN; ++k) {
+        // 非负浮点数的位模式与数值同序：把点下标放进尾数低 5 位，一次取最小值同时得到下标
+        float minD2;
+        int minIndex;
+
+#ifdef WMF_SHAPE_SSE2
+        const __m128 px = _mm_set1_ps(ax[i]);
+        const __m128 py = _mm_set1_ps(ay[i]);
+        const __m128 highBits = _mm_castsi128_ps(_mm_set1_epi32(~(kN - 1)));
+        __m128i index = _mm_set_epi32(3, 2, 1, 0);
+        const __m128i four = _mm_set1_epi32(4);
+        __m128 min0 = _mm_set1_ps(FLT_MAX);
+        __m128 min1 = _mm_set1_ps(FLT_MAX);
+        for (int j = 0; j < kN; j += 8) {
+            __m128 dx0 = _mm_sub_ps(_mm_loadu_ps(bx + j), px);
+            __m128 dy0 = _mm_sub_ps(_mm_loadu_ps(by + j), py);
+            __m128 dx1 = _mm_sub_ps(_mm_loadu_ps(bx + j + 4), px);
+            __m128 dy1 = _mm_sub_ps(_mm_loadu_ps(by + j + 4), py);
+            __m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx0, dx0), _mm_mul_ps(dy0, dy0)), _mm_load_ps(penalty + j));
+            __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx1, dx1), _mm_mul_ps(dy1, dy1)), _mm_load_ps(penalty + j + 4));
+            __m128 key0 = _mm_or_ps(_mm_and_ps(d0, highBits), _mm_castsi128_ps(index));
+            index = _mm_add_epi32(index, four);
+            __m128 key1 = _mm_or_ps(_mm_and_ps(d1, highBits), _mm_castsi128_ps(index));
+            index = _mm_add_epi32(index, four);
+            min0 = _mm_min_ps(min0, key0);
+            min1 = _mm_min_ps(min1, key1);
+        }
+        __m128 m = _mm_min_ps(min0, min1);
+        m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        int bits = _mm_cvtsi128_si32(_mm_castps_si128(m));
+        minIndex = bits & (kN - 1);
+        minD2 = _mm_cvtss_f32(m);
+#else
+        minD2 = FLT_MAX;
+        minIndex = 0;
+        for (int j = 0; j < kN; ++j) {
+            float dx = bx[j] - ax[i];
+            float dy = by[j] - ay[i];
+            float d2 = dx * dx + dy * dy + penalty[j];
+            if (d2 < minD2) {
+                minD2 = d2;
+                minIndex = j;
+            }
+        }
+#endif
+
+        penalty[minIndex] = kMatched;
+        // 越早匹配的点权重越大
+        float weight = 1.0f - static_cast<float>(k) / kN;
+        sum += weight * sqrtf(minD2);
+        if (sum >= best) {
+            return sum;
+        }
+        i = (i + 1) % kN;
+    }
+    return sum;
+}
+
+float ShapeMatcher::GreedyCloudMatch(const float* cx, const float* cy, const float* tx, const float* ty, float best) {
+    for (int start = 0; start < kN; start += kStartStep) {
+        best = std::min(best, CloudDistance(cx, cy, tx, ty, start, best));
+        best = std::min(best, CloudDistance(tx, ty, cx, cy, start, best));
+    }
+    return best;
+}
+
+ShapeMatcher::Result ShapeMatcher::Match(const Point* points, size_t count) const {
+    Result result;
+    float cx[kN];
+    float cy[kN];
+    if (templateCount_ == 0 || !Normalize(points, count, cx, cy)) {
+        return result;
+    }
+
+    // 先用每个模板的单次匹配得到上界，后续的完整匹配可以更早放弃
+    float best = FLT_MAX;
+    for (size_t t = 0; t < templateCount_; ++t) {
+        best = std::min(best, CloudDistance(cx, cy, xs_.data() + t * kN, ys_.data() + t * kN, 0, best));
+    }
+    best = std::nextafter(best, FLT_MAX);
+    for (size_t t = 0; t < templateCount_; ++t) {
+        float d = GreedyCloudMatch(cx, cy, xs_.data() + t * kN, ys_.data() + t * kN, best);
+        if (d < best) {
+            best = d;
+            result.index = static_cast<int>(t);
+        }
+    }
+
+    result.distance = best;
+    result.score = std::max(0.0, 1.0 - best / kScoreScale);
+    return result;
+}
+
+bool ShapeMatcher::GetBuiltinTemplate(const std::string& name, std::vector<Point>& points) {
+    points.clear();
+    if (name == "L") {
+        points = {Point(0, 0), Point(0, 100), Point(60, 100)};
+    } else if (name == "V") {
+        points = {Point(0, 0), Point(40, 100), Point(80, 0)};
+    } else if (name == "CARET") {
+        points = {Point(0, 100), Point(40, 0), Point(80, 100)};
+    } else if (name == "ZIGZAG") {
+        points = {Point(0, 0), Point(100, 0), Point(0, 100), Point(100, 100)};
+    } else if (name == "CIRCLE") {
+        // 从顶部开始顺时针一圈
+        const double kPi = 3.14159265358979323846;
+        for (int i = 0; i <= 32; ++i) {
+            double angle = 2 * kPi * i / 32 - kPi / 2;
+            points.push_back(Point(static_cast<int>(50 + 50 * cos(angle)), static_cast<int>(50 + 50 * sin(angle))));
+        }
+    }
+    return !points.empty();
+}
+
+} // namespace WinMouseFix
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include "Common.h"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace WinMouseFix {
+
+/**
+ * @brief 按住按钮期间记录的笔画（定长缓冲区，不分配内存）
+ *
+ * 与上一点距离小于采样间距的点被忽略；缓冲区满时隔点抽稀并把间距加倍，
+ * 因此任意长的笔画都能完整保留轮廓。
+ */
+class ShapeStroke {
+public:
+    static const size_t kCapacity = 512;
+
+    ShapeStroke();
+
+    /**
+     * @brief 以按下位置开始新的笔画
+     */
+    void Reset(const Point& start);
+
+    /**
+     * @brief 添加一个移动采样
+     */
+    void Add(const Point& position);
+
+    const Point* GetPoints() const { return points_.data(); }
+    size_t GetCount() const { return count_; }
+
+    /**
+     * @brief 笔画的累计长度（像素）
+     */
+    double GetLength() const { return length_; }
+
+private:
+    std::array<Point, kCapacity> points_;
+    size_t count_;
+    int spacing_;     // 采样间距（像素）
+    double length_;
+};
+
+/**
+ * @brief 形状模板匹配器（$P 点云识别）
+ *
+ * 笔画和模板都重采样为 kPointCount 个等距点，按最大边长缩放并把重心移到原点，
+ * 然后用贪心点云匹配计算距离：与笔画顺序、方向无关，只比较形状。
+ * 模板以 SoA 布局连续存放，最近点搜索用 SSE2 每次比较 4 个模板点；
+ * 累计距离超过当前最优值时提前放弃。
+ */
+class ShapeMatcher {
+public:
+    static const int kPointCount = 32;
+
+    struct Result {
+        int index;        // 最匹配的模板，-1 表示没有模板或笔画无效
+        double distance;  // 点云距离
+        double score;     // 相似度（0~1），1 表示完全一致
+
+        Result() : index(-1), distance(0), score(0) {}
+    };
+
+    /**
+     * @brief 添加模板，返回模板下标；点数不足或没有长度时返回 -1
+     */
+    int AddTemplate(const Point* points, size_t count);
+
+    void Clear();
+
+    size_t GetTemplateCount() const { return templateCount_; }
+
+    /**
+     * @brief 将笔画与所有模板匹配（不分配内存）
+     */
+    Result Match(const Point* points, size_t count) const;
+
+    /**
+     * @brief 内置模板（L、V、CARET、CIRCLE、ZIGZAG），名称未知时返回 false
+     */
+    static bool GetBuiltinTemplate(const std::string& name, std::vector<Point>& points);
+
+private:
+    /**
+     * @brief 重采样并归一化到 kPointCount 个点
+     */
+    static bool Normalize(const Point* points, size_t count, float* xs, float* ys);
+
+    /**
+     * @brief 从 a 的第 start 个点开始逐点贪心匹配 b 中最近的未匹配点，返回加权距离和
+     */
+    static float CloudDistance(const float* ax, const float* ay, const float* bx, const float* by,
+                               int start, float best);
+
+    static float GreedyCloudMatch(const float* cx, const float* cy, const float* tx, const float* ty, float best);
+
+    std::vector<float> xs_;    // 模板 i 的点位于 [i * kPointCount, (i + 1) * kPointCount)
+    std::vector<float> ys_;
+    size_t templateCount_ = 0;
+};
+
+} // namespace WinMouseFix
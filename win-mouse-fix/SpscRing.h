@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace WinMouseFix {
+
+// 缓存行大小（x86/x64 与主流 ARM 均为 64 字节）
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief 单生产者/单消费者无锁环形队列
+ *
+ * 固定容量、槽位预分配，生产者（钩子线程）与消费者（工作线程）的索引
+ * 分别独占一个缓存行，避免伪共享。TryPush/TryPop 都是无等待、无内存分配的。
+ * Capacity 必须是 2 的幂。
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head_(0), cachedTail_(0), highWater_(0), tail_(0), cachedHead_(0), drops_(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief 入队（仅生产者线程调用）
+     * @return 队列已满时返回 false 并累加丢弃计数
+     */
+    bool TryPush(const T& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ >= Capacity) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ >= Capacity) {
+                drops_.store(drops_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 查看队首元素（仅消费者线程调用）
+     * @return 队列为空时返回 nullptr
+     */
+    const T* Front() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return nullptr;
+            }
+
+            // 高水位由消费者在刷新 tail 时更新，生产者路径不读取对方的缓存行
+            const size_t depth = cachedTail_ - head;
+            if (depth > highWater_.load(std::memory_order_relaxed)) {
+                highWater_.store(depth, std::memory_order_relaxed);
+            }
+        }
+        return &slots_[head & (Capacity - 1)];
+    }
+
+    /**
+     * @brief 查看队首之后第 index 个元素（仅消费者线程调用，0 即队首）
+     * @return 队列中没有这么多元素时返回 nullptr
+     *
+     * 弹出之前槽位只归消费者所有，可以就地修改。
+     */
+    T* PeekAt(size_t index) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (cachedTail_ - head <= index) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (cachedTail_ - head <= index) {
+                return nullptr;
+            }
+        }
+        return &slots_[(head + index) & (Capacity - 1)];
+    }
+
+    /**
+     * @brief 弹出队首元素（仅消费者线程调用，须先 Front() 非空）
+     */
+    void Pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 出队（仅消费者线程调用）
+     */
+    bool TryPop(T& out) {
+        const T* front = Front();
+        if (!front) {
+            return false;
+        }
+        out = *front;
+        Pop();
+        return true;
+    }
+
+    /**
+     * @brief 当前队列深度（任意线程，近似值）
+     */
+    size_t Size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    static constexpr size_t GetCapacity() { return Capacity; }
+
+    /**
+     * @brief 因队列已满而被拒绝的入队次数
+     */
+    uint64_t GetDrops() const { return drops_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 观测到的最大队列深度
+     */
+    size_t GetHighWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+    // 消费者独占
+    alignas(kCacheLineSize) std::atomic<size_t> head_;
+    size_t cachedTail_;
+    std::atomic<size_t> highWater_;
+
+    // 生产者独占
+    alignas(kCacheLineSize) std::atomic<size_t> tail_;
+    size_t cachedHead_;
+    std::atomic<uint64_t> drops_;
+
+    alignas(kCacheLineSize) std::array<T, Capacity> slots_;
+};
+
+} // namespace WinMouseFix
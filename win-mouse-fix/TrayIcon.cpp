@@ -1,4 +1,5 @@
 ﻿#include "TrayIcon.h"
+#include "LatencyTrace.h"
 #include "MainWindow.h"
 
 #include "resource.h"
@@ -86,6 +87,9 @@ void TrayIcon::ShowContextMenu() {
     if (!hMenu) return;
     
     AppendMenu(hMenu, MF_STRING, ID_TRAY_SHOW, L"显示主窗口");
+#if WMF_LATENCY_TRACE
+    AppendMenu(hMenu, MF_STRING, ID_TRAY_LATENCY, L"导出延迟统计");
+#endif
     AppendMenu(hMenu, MF_SEPARATOR, 0, nullptr);
     AppendMenu(hMenu, MF_STRING, ID_TRAY_EXIT, L"退出");
 
@@ -112,6 +116,13 @@ void TrayIcon::ShowContextMenu() {
         if (mainWindow_) {
             mainWindow_->Show();
         }
+    } else if (cmd == ID_TRAY_LATENCY) {
+        // 写到程序目录（启动时已设为工作目录）
+        if (LatencyTrace::DumpToFile("latency.txt")) {
+            MessageBox(hwnd_, StringToWString(LatencyTrace::Format()).c_str(), L"延迟统计 (已写入 latency.txt)", MB_OK);
+        } else {
+            MessageBox(hwnd_, L"无法写入 latency.txt", L"延迟统计", MB_OK | MB_ICONERROR);
+        }
     } else if (cmd == ID_TRAY_EXIT) {
         DestroyWindow(hwnd_);
     }
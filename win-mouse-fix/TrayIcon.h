@@ -1,6 +1,6 @@
 ﻿#pragma once
 
-#include "Common.h"
+#include "WinCommon.h"
 
 namespace WinMouseFix {
 
@@ -57,6 +57,7 @@ private:
     
     static const int ID_TRAY_SHOW = 2001;
     static const int ID_TRAY_EXIT = 2002;
+    static const int ID_TRAY_LATENCY = 2003;
 };
 
 } // namespace WinMouseFix
@@ -0,0 +1,310 @@
+﻿#include "UinputSink.h"
+#include "ActionProgram.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace WinMouseFix {
+
+namespace {
+
+// 'A' ~ 'Z' 对应的 Linux 键码（Linux 键码按键盘布局排列，不连续）
+const uint16_t kLetterKeys[26] = {
+    KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M,
+    KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z,
+};
+
+// F1 ~ F24
+const uint16_t kFunctionKeys[24] = {
+    KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_F10, KEY_F11, KEY_F12,
+    KEY_F13, KEY_F14, KEY_F15, KEY_F16, KEY_F17, KEY_F18, KEY_F19, KEY_F20, KEY_F21, KEY_F22, KEY_F23, KEY_F24,
+};
+
+struct KeyMapping {
+    uint16_t virtualKey;
+    uint16_t linuxKey;
+};
+
+const KeyMapping kKeyMappings[] = {
+    {VirtualKey::BACK, KEY_BACKSPACE},
+    {VirtualKey::TAB, KEY_TAB},
+    {VirtualKey::RETURN, KEY_ENTER},
+    {VirtualKey::SHIFT, KEY_LEFTSHIFT},
+    {VirtualKey::CONTROL, KEY_LEFTCTRL},
+    {VirtualKey::MENU, KEY_LEFTALT},
+    {VirtualKey::ESCAPE, KEY_ESC},
+    {VirtualKey::SPACE, KEY_SPACE},
+    {VirtualKey::PRIOR, KEY_PAGEUP},
+    {VirtualKey::NEXT, KEY_PAGEDOWN},
+    {VirtualKey::END, KEY_END},
+    {VirtualKey::HOME, KEY_HOME},
+    {VirtualKey::LEFT, KEY_LEFT},
+    {VirtualKey::UP, KEY_UP},
+    {VirtualKey::RIGHT, KEY_RIGHT},
+    {VirtualKey::DOWN, KEY_DOWN},
+    {VirtualKey::SNAPSHOT, KEY_SYSRQ},
+    {VirtualKey::INSERT, KEY_INSERT},
+    {VirtualKey::DEL, KEY_DELETE},
+    {VirtualKey::LWIN, KEY_LEFTMETA},
+};
+
+// 文本中的 ASCII 标点（美式键盘布局），shift 表示需要按住 Shift
+struct CharMapping {
+    char ch;
+    uint16_t linuxKey;
+    bool shift;
+};
+
+const CharMapping kCharMappings[] = {
+    {' ', KEY_SPACE, false}, {'\n', KEY_ENTER, false}, {'\t', KEY_TAB, false},
+    {'-', KEY_MINUS, false}, {'_', KEY_MINUS, true}, {'=', KEY_EQUAL, false}, {'+', KEY_EQUAL, true},
+    {'[', KEY_LEFTBRACE, false}, {'{', KEY_LEFTBRACE, true}, {']', KEY_RIGHTBRACE, false}, {'}', KEY_RIGHTBRACE, true},
+    {';', KEY_SEMICOLON, false}, {':', KEY_SEMICOLON, true}, {'\'', KEY_APOSTROPHE, false}, {'"', KEY_APOSTROPHE, true},
+    {',', KEY_COMMA, false}, {'<', KEY_COMMA, true}, {'.', KEY_DOT, false}, {'>', KEY_DOT, true},
+    {'/', KEY_SLASH, false}, {'?', KEY_SLASH, true}, {'`', KEY_GRAVE, false}, {'~', KEY_GRAVE, true},
+    {'\\', KEY_BACKSLASH, false}, {'|', KEY_BACKSLASH, true},
+    {'!', KEY_1, true}, {'@', KEY_2, true}, {'#', KEY_3, true}, {'$', KEY_4, true}, {'%', KEY_5, true},
+    {'^', KEY_6, true}, {'&', KEY_7, true}, {'*', KEY_8, true}, {'(', KEY_9, true}, {')', KEY_0, true},
+};
+
+// 鼠标按钮，下标为 MouseButton
+const uint16_t kButtonKeys[] = {BTN_SIDE, BTN_EXTRA, BTN_MIDDLE, BTN_LEFT, BTN_RIGHT};
+
+const int kWheelDelta = 120;
+
+/**
+ * @brief 文本字符对应的按键，无法输入的字符返回 false
+ */
+bool MapChar(uint16_t unit, uint16_t& key, bool& shift) {
+    if (unit >= 'a' && unit <= 'z') {
+        key = kLetterKeys[unit - 'a'];
+        shift = false;
+        return true;
+    }
+    if (unit >= 'A' && unit <= 'Z') {
+        key = kLetterKeys[unit - 'A'];
+        shift = true;
+        return true;
+    }
+    if (unit >= '0' && unit <= '9') {
+        key = UinputSink::ToLinuxKey(unit);
+        shift = false;
+        return true;
+    }
+    for (const auto& mapping : kCharMappings) {
+        if (static_cast<uint16_t>(mapping.ch) == unit) {
+            key = mapping.linuxKey;
+            shift = mapping.shift;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline input_event MakeEvent(uint16_t type, uint16_t code, int32_t value) {
+    input_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+} // namespace
+
+UinputSink::UinputSink()
+    : fd_(-1)
+    , wheelRemainderX_(0)
+    , wheelRemainderY_(0) {
+}
+
+UinputSink::~UinputSink() {
+    Close();
+}
+
+uint16_t UinputSink::ToLinuxKey(uint16_t virtualKey) {
+    if (virtualKey >= 'A' && virtualKey <= 'Z') {
+        return kLetterKeys[virtualKey - 'A'];
+    }
+    if (virtualKey >= '1' && virtualKey <= '9') {
+        return static_cast<uint16_t>(KEY_1 + (virtualKey - '1'));
+    }
+    if (virtualKey == '0') {
+        return KEY_0;
+    }
+    if (virtualKey >= VirtualKey::F1 && virtualKey < VirtualKey::F1 + 24) {
+        return kFunctionKeys[virtualKey - VirtualKey::F1];
+    }
+    for (const auto& mapping : kKeyMappings) {
+        if (mapping.virtualKey == virtualKey) {
+            return mapping.linuxKey;
+        }
+    }
+    return 0;
+}
+
+bool UinputSink::Open(const char* path) {
+    Close();
+    fd_ = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        lastError_ = std::string("open ") + path + ": " + strerror(errno);
+        return false;
+    }
+
+    // 声明设备能发出的事件：所有可换算的按键与文本字符、鼠标按钮、两个方向的（高分辨率）滚轮
+    bool ok = ioctl(fd_, UI_SET_EVBIT, EV_KEY) == 0 && ioctl(fd_, UI_SET_EVBIT, EV_REL) == 0 &&
+              ioctl(fd_, UI_SET_EVBIT, EV_SYN) == 0;
+    for (uint16_t key : kLetterKeys) {
+        ok = ok && ioctl(fd_, UI_SET_KEYBIT, key) == 0;
+    }
+    for (uint16_t key : kFunctionKeys) {
+        ok = ok && ioctl(fd_, UI_SET_KEYBIT, key) == 0;
+    }
+    for (int key = KEY_1; key <= KEY_0; ++key) {
+        ok = ok && ioctl(fd_, UI_SET_KEYBIT, key) == 0;
+    }
+    for (const auto& mapping : kKeyMappings) {
+        ok = ok && ioctl(fd_, UI_SET_KEYBIT, mapping.linuxKey) == 0;
+    }
+    for (const auto& mapping : kCharMappings) {
+        ok = ok && ioctl(fd_, UI_SET_KEYBIT, mapping.linuxKey) == 0;
+    }
+    for (uint16_t key : kButtonKeys) {
+        ok = ok && ioctl(fd_, UI_SET_KEYBIT, key) == 0;
+    }
+    const int relCodes[] = {REL_WHEEL, REL_HWHEEL, REL_WHEEL_HI_RES, REL_HWHEEL_HI_RES};
+    for (int code : relCodes) {
+        ok = ok && ioctl(fd_, UI_SET_RELBIT, code) == 0;
+    }
+
+    uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1209;
+    setup.id.product = 0x574D;  // "WM"
+    strncpy(setup.name, "win-mouse-fix virtual input", UINPUT_MAX_NAME_SIZE - 1);
+    ok = ok && ioctl(fd_, UI_DEV_SETUP, &setup) == 0 && ioctl(fd_, UI_DEV_CREATE) == 0;
+
+    if (!ok) {
+        lastError_ = std::string("uinput setup: ") + strerror(errno);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    wheelRemainderX_ = 0;
+    wheelRemainderY_ = 0;
+    return true;
+}
+
+void UinputSink::Close() {
+    if (fd_ >= 0) {
+        ioctl(fd_, UI_DEV_DESTROY);
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+void UinputSink::SendKeys(const KeyEvent* events, size_t count) {
+    if (fd_ < 0) {
+        return;
+    }
+
+    // 一批按键加一个 SYN_REPORT，一次 write() 写入
+    input_event buffer[ActionProgram::kMaxEvents + 1];
+    size_t n = 0;
+    for (size_t i = 0; i < count && n < ActionProgram::kMaxEvents; ++i) {
+        uint16_t key = ToLinuxKey(events[i].key);
+        if (key != 0) {
+            buffer[n++] = MakeEvent(EV_KEY, key, events[i].down ? 1 : 0);
+        }
+    }
+    if (n == 0) {
+        return;
+    }
+    buffer[n++] = MakeEvent(EV_SYN, SYN_REPORT, 0);
+    ssize_t written = write(fd_, buffer, sizeof(input_event) * n);
+    (void)written;
+}
+
+void UinputSink::SendScroll(int deltaX, int deltaY) {
+    if (fd_ < 0) {
+        return;
+    }
+
+    // Windows 与 Linux 的滚轮方向相同：垂直正值向前（向上），水平正值向右
+    input_event buffer[5];
+    size_t n = 0;
+    if (deltaY != 0) {
+        buffer[n++] = MakeEvent(EV_REL, REL_WHEEL_HI_RES, deltaY);
+        wheelRemainderY_ += deltaY;
+        if (wheelRemainderY_ / kWheelDelta != 0) {
+            buffer[n++] = MakeEvent(EV_REL, REL_WHEEL, wheelRemainderY_ / kWheelDelta);
+            wheelRemainderY_ %= kWheelDelta;
+        }
+    }
+    if (deltaX != 0) {
+        buffer[n++] = MakeEvent(EV_REL, REL_HWHEEL_HI_RES, deltaX);
+        wheelRemainderX_ += deltaX;
+        if (wheelRemainderX_ / kWheelDelta != 0) {
+            buffer[n++] = MakeEvent(EV_REL, REL_HWHEEL, wheelRemainderX_ / kWheelDelta);
+            wheelRemainderX_ %= kWheelDelta;
+        }
+    }
+    if (n == 0) {
+        return;
+    }
+    buffer[n++] = MakeEvent(EV_SYN, SYN_REPORT, 0);
+    ssize_t written = write(fd_, buffer, sizeof(input_event) * n);
+    (void)written;
+}
+
+void UinputSink::SendText(const uint16_t* units, size_t count) {
+    if (fd_ < 0) {
+        return;
+    }
+
+    // 只能输入美式键盘上的 ASCII 字符，其余字符跳过；每个字符一个 SYN_REPORT，按块写入
+    const size_t kChunk = 16;
+    input_event buffer[kChunk * 5];
+    for (size_t offset = 0; offset < count; offset += kChunk) {
+        size_t n = 0;
+        for (size_t i = offset; i < count && i < offset + kChunk; ++i) {
+            uint16_t key = 0;
+            bool shift = false;
+            if (!MapChar(units[i], key, shift)) {
+                continue;
+            }
+            if (shift) {
+                buffer[n++] = MakeEvent(EV_KEY, KEY_LEFTSHIFT, 1);
+            }
+            buffer[n++] = MakeEvent(EV_KEY, key, 1);
+            buffer[n++] = MakeEvent(EV_KEY, key, 0);
+            if (shift) {
+                buffer[n++] = MakeEvent(EV_KEY, KEY_LEFTSHIFT, 0);
+            }
+            buffer[n++] = MakeEvent(EV_SYN, SYN_REPORT, 0);
+        }
+        if (n > 0) {
+            ssize_t written = write(fd_, buffer, sizeof(input_event) * n);
+            (void)written;
+        }
+    }
+}
+
+void UinputSink::SendButton(MouseButton button, bool down) {
+    const int index = static_cast<int>(button);
+    if (fd_ < 0 || index < 0 || index >= static_cast<int>(sizeof(kButtonKeys) / sizeof(kButtonKeys[0]))) {
+        return;
+    }
+    input_event buffer[2] = {
+        MakeEvent(EV_KEY, kButtonKeys[index], down ? 1 : 0),
+        MakeEvent(EV_SYN, SYN_REPORT, 0),
+    };
+    ssize_t written = write(fd_, buffer, sizeof(buffer));
+    (void)written;
+}
+
+} // namespace WinMouseFix
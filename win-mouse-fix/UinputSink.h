@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "InputSink.h"
+#include <string>
+
+namespace WinMouseFix {
+
+/**
+ * @brief Linux 输出端 - 通过 /dev/uinput 创建虚拟键盘/滚轮设备注入事件
+ *
+ * 虚拟键码在这里换算为 Linux 键码；一批按键与随后的 SYN_REPORT 合并为一次 write()。
+ * 滚动同时发送高分辨率滚轮事件（REL_WHEEL_HI_RES，120 为一格）和累积满一格时的传统滚轮事件。
+ * 需要 /dev/uinput 的写权限（通常是 input 组或 root）。
+ */
+class UinputSink : public InputSink {
+public:
+    UinputSink();
+    ~UinputSink() override;
+
+    UinputSink(const UinputSink&) = delete;
+    UinputSink& operator=(const UinputSink&) = delete;
+
+    /**
+     * @brief 打开 /dev/uinput 并创建虚拟设备
+     * @return 失败时返回 false，原因见 GetLastError()
+     */
+    bool Open(const char* path = "/dev/uinput");
+
+    void Close();
+
+    bool IsOpen() const { return fd_ >= 0; }
+
+    const std::string& GetLastError() const { return lastError_; }
+
+    void SendKeys(const KeyEvent* events, size_t count) override;
+    void SendScroll(int deltaX, int deltaY) override;
+
+    /**
+     * @brief 输入文本：只支持美式键盘布局上的 ASCII 字符，其余字符跳过
+     */
+    void SendText(const uint16_t* units, size_t count) override;
+
+    void SendButton(MouseButton button, bool down) override;
+
+    /**
+     * @brief 虚拟键码对应的 Linux 键码，无法换算时返回 0
+     */
+    static uint16_t ToLinuxKey(uint16_t virtualKey);
+
+private:
+    int fd_;
+    int wheelRemainderX_;   // 不足一格的高分辨率滚动量，用于生成传统滚轮事件
+    int wheelRemainderY_;
+    std::string lastError_;
+};
+
+} // namespace WinMouseFix
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+// Windows 专用公共定义：只由依赖 Win32 API 的模块（钩子、动作、界面）包含，
+// 可移植的识别核心只包含 Common.h
+
+#include <windows.h>
+#include "Common.h"
+
+namespace WinMouseFix {
+
+// 本程序注入的鼠标事件的 dwExtraInfo 标记（"WMFX"），钩子据此放行自己注入的点击
+const ULONG_PTR kInjectedSignature = 0x574D4658;
+
+inline std::wstring StringToWString(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring wstr(size, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &wstr[0], size);
+    return wstr;
+}
+
+inline std::string WStringToString(const std::wstring& wstr) {
+    if (wstr.empty()) return std::string();
+    int size = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
+    std::string str(size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &str[0], size, nullptr, nullptr);
+    return str;
+}
+
+} // namespace WinMouseFix
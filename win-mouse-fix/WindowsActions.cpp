@@ -1,5 +1,4 @@
 ﻿#include "WindowsActions.h"
-#include <iostream>
 
 namespace WinMouseFix {
 
@@ -15,136 +14,90 @@ WindowsActions::~WindowsActions() {
     }
 }
 
-void WindowsActions::ShowTaskView() {
-    // 移除日志输出以提高性能
-    SendKeySequence({VK_LWIN, VK_TAB});
-}
-
-void WindowsActions::ShowDesktop() {
-    SendKeySequence({VK_LWIN, 'D'});
-}
-
-void WindowsActions::SwitchDesktopLeft() {
-    SendKeySequence({VK_CONTROL, VK_LWIN, VK_LEFT});
-}
-
-void WindowsActions::SwitchDesktopRight() {
-    SendKeySequence({VK_CONTROL, VK_LWIN, VK_RIGHT});
+void WindowsActions::SendKeys(const KeyEvent* events, size_t count) {
+    // 一段最多 ActionProgram::kMaxEvents 个按键，在栈上转换，不分配内存
+    INPUT inputs[ActionProgram::kMaxEvents] = {};
+    if (count > ActionProgram::kMaxEvents) {
+        count = ActionProgram::kMaxEvents;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        inputs[i].type = INPUT_KEYBOARD;
+        inputs[i].ki.wVk = events[i].key;
+        inputs[i].ki.dwFlags = events[i].down ? 0 : KEYEVENTF_KEYUP;
+    }
+    if (count > 0) {
+        SendInput(static_cast<UINT>(count), inputs, sizeof(INPUT));
+    }
 }
 
-void WindowsActions::SimulateScroll(int deltaX, int deltaY) {
-    // 自然滚动：鼠标向上移动，页面向下滚动
+void WindowsActions::SendScroll(int deltaX, int deltaY) {
+    // 滚动量已是高分辨率滚轮单位（方向、增益与加速由 ScrollEngine 处理），直接作为 mouseData 发送；
+    // 两个方向放在同一个 SendInput 批次中
+    INPUT inputs[2] = {};
+    UINT count = 0;
     
     // 垂直滚动
     if (deltaY != 0) {
-        INPUT input = {};
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_WHEEL;
-        // 自然滚动：鼠标向上（deltaY < 0），页面向下滚（正值）
-        input.mi.mouseData = deltaY * 30;
-        SendInput(1, &input, sizeof(INPUT));
+        inputs[count].type = INPUT_MOUSE;
+        inputs[count].mi.dwFlags = MOUSEEVENTF_WHEEL;
+        inputs[count].mi.mouseData = static_cast<DWORD>(deltaY);
+        ++count;
     }
     
     // 水平滚动
     if (deltaX != 0) {
-        INPUT input = {};
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_HWHEEL;
-        // 自然滚动：鼠标向左（deltaX < 0），页面向右滚（正值）
-        input.mi.mouseData = -deltaX * 30;
-        SendInput(1, &input, sizeof(INPUT));
+        inputs[count].type = INPUT_MOUSE;
+        inputs[count].mi.dwFlags = MOUSEEVENTF_HWHEEL;
+        inputs[count].mi.mouseData = static_cast<DWORD>(deltaX);
+        ++count;
+    }
+    
+    if (count > 0) {
+        SendInput(count, inputs, sizeof(INPUT));
     }
 }
 
-void WindowsActions::ExecuteHotkey(DWORD modifiers, DWORD key) {
-    std::vector<WORD> keys;
-    
-    // 添加修饰键
-    if (modifiers & MOD_CONTROL) keys.push_back(VK_CONTROL);
-    if (modifiers & MOD_SHIFT) keys.push_back(VK_SHIFT);
-    if (modifiers & MOD_ALT) keys.push_back(VK_MENU);
-    if (modifiers & MOD_WIN) keys.push_back(VK_LWIN);
-    
-    // 添加主键
-    keys.push_back(static_cast<WORD>(key));
-    
-    SendKeySequence(keys);
+void WindowsActions::SendText(const uint16_t* units, size_t count) {
+    // 每个码元按下、释放两个事件；按块在栈上转换，不分配内存
+    const size_t kChunk = 32;
+    INPUT inputs[kChunk * 2];
+    for (size_t offset = 0; offset < count; offset += kChunk) {
+        const size_t n = (count - offset < kChunk) ? count - offset : kChunk;
+        ZeroMemory(inputs, sizeof(inputs));
+        for (size_t i = 0; i < n; ++i) {
+            inputs[i * 2].type = INPUT_KEYBOARD;
+            inputs[i * 2].ki.wScan = units[offset + i];
+            inputs[i * 2].ki.dwFlags = KEYEVENTF_UNICODE;
+            inputs[i * 2 + 1] = inputs[i * 2];
+            inputs[i * 2 + 1].ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
+        }
+        SendInput(static_cast<UINT>(n * 2), inputs, sizeof(INPUT));
+    }
 }
 
-void WindowsActions::ExecuteAction(ActionType action) {
-    switch (action) {
-        case ActionType::TASK_VIEW:
-            ShowTaskView();
-            break;
-        
-        case ActionType::SHOW_DESKTOP:
-            ShowDesktop();
+void WindowsActions::SendButton(MouseButton button, bool down) {
+    INPUT input = {};
+    input.type = INPUT_MOUSE;
+    input.mi.dwExtraInfo = kInjectedSignature;
+    switch (button) {
+        case MouseButton::BUTTON_LEFT:
+            input.mi.dwFlags = down ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
             break;
-        
-        case ActionType::SWITCH_DESKTOP_LEFT:
-            SwitchDesktopLeft();
+        case MouseButton::BUTTON_RIGHT:
+            input.mi.dwFlags = down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
             break;
-        
-        case ActionType::SWITCH_DESKTOP_RIGHT:
-            SwitchDesktopRight();
+        case MouseButton::BUTTON_MIDDLE:
+            input.mi.dwFlags = down ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
             break;
-        
-        case ActionType::SCROLL_SIMULATION:
-            // 滚动由 GestureRecognizer 直接处理
+        case MouseButton::BUTTON_4:
+        case MouseButton::BUTTON_5:
+            input.mi.dwFlags = down ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+            input.mi.mouseData = (button == MouseButton::BUTTON_4) ? XBUTTON1 : XBUTTON2;
             break;
-        
         default:
-            break;
-    }
-}
-
-void WindowsActions::SendKeyCombo(const std::vector<WORD>& keys, bool keyDown) {
-    std::vector<INPUT> inputs;
-    
-    for (WORD key : keys) {
-        INPUT input = {};
-        input.type = INPUT_KEYBOARD;
-        input.ki.wVk = key;
-        input.ki.dwFlags = keyDown ? 0 : KEYEVENTF_KEYUP;
-        inputs.push_back(input);
-    }
-    
-    if (!inputs.empty()) {
-        SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
+            return;
     }
-}
-
-void WindowsActions::PressKey(WORD key) {
-    INPUT input = {};
-    input.type = INPUT_KEYBOARD;
-    input.ki.wVk = key;
-    input.ki.dwFlags = 0; // Key down
     SendInput(1, &input, sizeof(INPUT));
 }
 
-void WindowsActions::ReleaseKey(WORD key) {
-    INPUT input = {};
-    input.type = INPUT_KEYBOARD;
-    input.ki.wVk = key;
-    input.ki.dwFlags = KEYEVENTF_KEYUP;
-    SendInput(1, &input, sizeof(INPUT));
-}
-
-void WindowsActions::SendKeySequence(const std::vector<WORD>& keys) {
-    // 按下所有键
-    for (WORD key : keys) {
-        PressKey(key);
-        Sleep(20); // 增加延迟确保按键被识别
-    }
-    
-    Sleep(50); // 所有键按下后等待
-    
-    // 释放所有键（逆序）
-    for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
-        ReleaseKey(*it);
-        Sleep(20);
-    }
-}
-
 } // namespace WinMouseFix
-
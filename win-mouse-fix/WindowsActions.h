@@ -1,78 +1,44 @@
 ﻿#pragma once
 
-#include "Common.h"
+#include "WinCommon.h"
+#include "InputSink.h"
 
 namespace WinMouseFix {
 
 /**
- * @brief Windows 系统动作执行类
+ * @brief Windows 输入注入
  * 
- * 负责执行各种 Windows 系统操作，如切换虚拟桌面、显示任务视图等
+ * 通过 SendInput 发出按键、滚轮、文本和鼠标按钮事件，每次调用只有一次 SendInput。
+ * 按键程序的分段与段间间隔由 ActionExecutor 在执行线程中调度，这里的方法都不阻塞。
  */
-class WindowsActions {
+class WindowsActions : public InputSink {
 public:
     WindowsActions();
-    ~WindowsActions();
+    ~WindowsActions() override;
 
     /**
-     * @brief 显示任务视图 (Win+Tab)
+     * @brief 批量发出按键事件（一次 SendInput）
      */
-    void ShowTaskView();
-
-    /**
-     * @brief 显示/隐藏桌面 (Win+D)
-     */
-    void ShowDesktop();
-
-    /**
-     * @brief 切换到左边的虚拟桌面 (Ctrl+Win+Left)
-     */
-    void SwitchDesktopLeft();
-
-    /**
-     * @brief 切换到右边的虚拟桌面 (Ctrl+Win+Right)
-     */
-    void SwitchDesktopRight();
+    void SendKeys(const KeyEvent* events, size_t count) override;
 
     /**
      * @brief 模拟鼠标滚轮滚动
      * @param deltaX 水平滚动量
      * @param deltaY 垂直滚动量
      */
-    void SimulateScroll(int deltaX, int deltaY);
-
-    /**
-     * @brief 执行自定义热键
-     * @param modifiers 修饰键 (VK_CONTROL, VK_SHIFT, VK_MENU, VK_LWIN)
-     * @param key 主键
-     */
-    void ExecuteHotkey(DWORD modifiers, DWORD key);
-
-    /**
-     * @brief 执行指定的动作类型
-     */
-    void ExecuteAction(ActionType action);
-
-private:
-    /**
-     * @brief 发送键盘输入
-     */
-    void SendKeyCombo(const std::vector<WORD>& keys, bool keyDown);
-
-    /**
-     * @brief 按下键
-     */
-    void PressKey(WORD key);
+    void SendScroll(int deltaX, int deltaY) override;
 
     /**
-     * @brief 释放键
+     * @brief 输入文本（KEYEVENTF_UNICODE，每个码元按下、释放各一次）
      */
-    void ReleaseKey(WORD key);
+    void SendText(const uint16_t* units, size_t count) override;
 
     /**
-     * @brief 发送完整的按键序列（按下+释放）
+     * @brief 按下或释放鼠标按钮
+     *
+     * 注入的事件带 kInjectedSignature 标记，MouseHook 直接放行，不会再触发手势。
      */
-    void SendKeySequence(const std::vector<WORD>& keys);
+    void SendButton(MouseButton button, bool down) override;
 
 private:
     bool initialized_;
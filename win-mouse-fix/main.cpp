@@ -1,10 +1,13 @@
 ﻿#include "MouseHook.h"
 #include "GestureRecognizer.h"
+#include "ActionExecutor.h"
 #include "WindowsActions.h"
 #include "ConfigManager.h"
+#include "ConfigWatcher.h"
 #include "MainWindow.h"
 #include "TrayIcon.h"
 #include <windows.h>
+#include <cstring>
 
 #ifdef _UNICODE
 #if defined _M_IX86
@@ -52,9 +55,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         }
     }
     
-    // 创建核心组件
+    // 创建核心组件：识别器只提交动作请求，按键注入在执行器线程中按时间表进行
     WindowsActions actions;
-    GestureRecognizer gestureRecognizer(&actions);
+    ActionExecutor actionExecutor(&actions);
+    GestureRecognizer gestureRecognizer(&actionExecutor);
     MouseHook mouseHook;
     g_mouseHook = &mouseHook;
     
@@ -67,6 +71,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     }
     
     gestureRecognizer.LoadConfig(configManager.GetGestureConfigs());
+    gestureRecognizer.SetBlockDecisionTimeout(std::chrono::microseconds(configManager.GetBlockDecisionTimeoutUs()));
+    
+    // 惯性滚动按显示器刷新率逐帧输出（0 和 1 表示硬件默认值，保持 60）
+    DEVMODEW displayMode = {};
+    displayMode.dmSize = sizeof(displayMode);
+    if (EnumDisplaySettingsW(NULL, ENUM_CURRENT_SETTINGS, &displayMode) && displayMode.dmDisplayFrequency > 1) {
+        gestureRecognizer.SetFrameRate(static_cast<int>(displayMode.dmDisplayFrequency));
+    }
     mouseHook.SetGestureRecognizer(&gestureRecognizer);
     
     // 创建主窗口
@@ -91,6 +103,33 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         return 1;
     }
     
+    // 录制模式：win-mouse-fix.exe --record <trace 文件>
+    std::string cmdLine = lpCmdLine ? lpCmdLine : "";
+    size_t recordPos = cmdLine.find("--record");
+    if (recordPos != std::string::npos) {
+        std::string tracePath = cmdLine.substr(recordPos + strlen("--record"));
+        size_t first = tracePath.find_first_not_of(" \t\"");
+        size_t last = tracePath.find_last_not_of(" \t\"");
+        tracePath = (first == std::string::npos) ? "trace.wmft" : tracePath.substr(first, last - first + 1);
+        
+        if (!mouseHook.StartRecording(tracePath)) {
+            MessageBox(nullptr, L"Failed to create trace file!", L"Error", MB_OK | MB_ICONERROR);
+        }
+    }
+    
+    // 配置文件变化后自动重新加载（解析在监视线程中进行，识别器无锁切换规则）
+    ConfigWatcher configWatcher;
+    HWND mainHwnd = mainWindow.GetHWND();
+    configWatcher.Start(
+        configPath,
+        [&gestureRecognizer](const std::vector<GestureConfig>& configs) {
+            gestureRecognizer.LoadConfig(configs);
+        },
+        [mainHwnd]() {
+            PostMessage(mainHwnd, MainWindow::WM_CONFIG_RELOADED, 0, 0);
+        });
+    mainWindow.SetConfigWatcher(&configWatcher);
+    
     // 显示主窗口
     mainWindow.Show();
     
@@ -102,7 +141,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     }
     
     // 清理
+    configWatcher.Stop();
     mouseHook.Uninstall();
+    mouseHook.StopRecording();
     trayIcon.Remove();
     
     // 释放互斥锁